@@ -20,7 +20,10 @@
 #include <ctype.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <math.h>
+#include <signal.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -34,6 +37,24 @@
 #include <tidesdb/tidesdb_version.h>
 #include <tidesdb/xxhash.h>
 
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <fnmatch.h>
+#include <glob.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#endif
+
 #if defined(_MSC_VER) && !defined(__MINGW32__) && !defined(__MINGW64__)
 #ifndef close
 #define close _close
@@ -50,6 +71,12 @@
 #define S_ISREG(m) (((m)&S_IFMT) == S_IFREG)
 #endif
 
+#if defined(_MSC_VER) && !defined(__clang__)
+#define ADMINTOOL_THREAD_LOCAL __declspec(thread)
+#else
+#define ADMINTOOL_THREAD_LOCAL _Thread_local
+#endif
+
 #define TDB_KV_FLAG_TOMBSTONE 0x01
 #define TDB_KV_FLAG_HAS_TTL 0x02
 #define TDB_KV_FLAG_HAS_VLOG 0x04
@@ -63,13 +90,211 @@ static inline uint32_t compute_block_checksum(const void *data,
   return XXH32(data, size, 0);
 }
 
-#define ADMINTOOL_MAX_INPUT 4096
-#define ADMINTOOL_MAX_ARGS 64
 #define ADMINTOOL_PROMPT "admintool> "
 #define ADMINTOOL_PROMPT_DB "admintool(%s)> "
 
+#define ADMINTOOL_METRICS_DEFAULT_INTERVAL_MS 5000
+#define ADMINTOOL_POLL_INTERVAL_US 100000
+#define ADMINTOOL_WAIT_START_TIMEOUT_US (10ULL * 1000 * 1000)
+#define ADMINTOOL_METRICS_MAX_REQUEST 4096
+#define ADMINTOOL_METRICS_IO_TIMEOUT_MS 1000
+#define ADMINTOOL_SERVE_MAX_CLIENTS 1024
+#define ADMINTOOL_SERVE_MAX_ARGS (1024 * 1024)
+#define ADMINTOOL_SERVE_MAX_BULK (512LL * 1024 * 1024)
+#define ADMINTOOL_SERVE_MAX_INLINE (64 * 1024)
+#define ADMINTOOL_SERVE_READ_CHUNK (64 * 1024)
+#define ADMINTOOL_SERVE_SEND_TIMEOUT_MS 5000
+
 static tidesdb_t *g_db = NULL;
 static char g_db_path[1024] = {0};
+static tidesdb_config_t g_db_config;
+static char g_shadow_dir[4096] = {0};
+static int g_db_shadow = 0;
+static volatile sig_atomic_t g_interrupted = 0;
+
+static void handle_interrupt(const int sig) {
+  (void)sig;
+  g_interrupted = 1;
+}
+
+/* command output goes to the calling thread's g_cmd_out when one is set;
+ * serve points it at a per-call buffer, so an admin command run on a worker
+ * is captured without touching the process's stdout */
+static ADMINTOOL_THREAD_LOCAL FILE *g_cmd_out = NULL;
+
+static FILE *cmd_out(void) { return g_cmd_out != NULL ? g_cmd_out : stdout; }
+
+#define printf(...) fprintf(cmd_out(), __VA_ARGS__)
+
+static uint64_t now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+typedef struct {
+  char *data;
+  size_t len;
+  size_t cap;
+} strbuf_t;
+
+static int strbuf_reserve(strbuf_t *sb, const size_t extra) {
+  if (sb->len + extra + 1 <= sb->cap)
+    return 0;
+  size_t new_cap = sb->cap ? sb->cap : 256;
+  while (new_cap < sb->len + extra + 1)
+    new_cap *= 2;
+  char *grown = realloc(sb->data, new_cap);
+  if (!grown)
+    return -1;
+  sb->data = grown;
+  sb->cap = new_cap;
+  return 0;
+}
+
+static int strbuf_append(strbuf_t *sb, const char *data, const size_t size) {
+  if (strbuf_reserve(sb, size) != 0)
+    return -1;
+  if (size > 0)
+    memcpy(sb->data + sb->len, data, size);
+  sb->len += size;
+  sb->data[sb->len] = '\0';
+  return 0;
+}
+
+static int strbuf_printf(strbuf_t *sb, const char *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  const int needed = vsnprintf(NULL, 0, fmt, ap);
+  va_end(ap);
+  if (needed < 0 || strbuf_reserve(sb, (size_t)needed) != 0)
+    return -1;
+  va_start(ap, fmt);
+  vsnprintf(sb->data + sb->len, (size_t)needed + 1, fmt, ap);
+  va_end(ap);
+  sb->len += (size_t)needed;
+  return 0;
+}
+
+static void strbuf_free(strbuf_t *sb) {
+  free(sb->data);
+  sb->data = NULL;
+  sb->len = 0;
+  sb->cap = 0;
+}
+
+/* reads one whole line of any length into sb (without the newline); returns
+ * 1 for a line, 0 at end of input and -1 when out of memory */
+static int strbuf_read_line(strbuf_t *sb, FILE *in) {
+  sb->len = 0;
+  if (strbuf_reserve(sb, 4096) != 0)
+    return -1;
+  sb->data[0] = '\0';
+  int got = 0;
+  while (fgets(sb->data + sb->len, (int)(sb->cap - sb->len), in) != NULL) {
+    got = 1;
+    sb->len += strlen(sb->data + sb->len);
+    if (sb->len > 0 && sb->data[sb->len - 1] == '\n') {
+      sb->data[--sb->len] = '\0';
+      return 1;
+    }
+    if (strbuf_reserve(sb, sb->cap) != 0)
+      return -1;
+  }
+  return got;
+}
+
+static FILE *g_trace_file = NULL;
+static pthread_mutex_t g_trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t g_trace_origin_us = 0;
+static uint64_t g_trace_events = 0;
+static int g_trace_next_tid = 1;
+static _Thread_local int t_trace_tid = 0;
+
+static void json_write_escaped(FILE *fp, const char *str) {
+  for (const unsigned char *p = (const unsigned char *)str; *p; p++) {
+    if (*p == '"' || *p == '\\') {
+      fprintf(fp, "\\%c", *p);
+    } else if (*p < 0x20) {
+      fprintf(fp, "\\u%04x", *p);
+    } else {
+      fputc(*p, fp);
+    }
+  }
+}
+
+static int trace_start(const char *path) {
+  FILE *fp = fopen(path, "w");
+  if (!fp)
+    return -1;
+
+  pthread_mutex_lock(&g_trace_lock);
+  g_trace_file = fp;
+  g_trace_origin_us = now_us();
+  g_trace_events = 0;
+  fprintf(fp, "[\n");
+  fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+              "\"args\":{\"name\":\"admintool\"}}");
+  pthread_mutex_unlock(&g_trace_lock);
+  return 0;
+}
+
+static void trace_stop(void) {
+  pthread_mutex_lock(&g_trace_lock);
+  if (g_trace_file) {
+    fprintf(g_trace_file, "\n]\n");
+    fclose(g_trace_file);
+    g_trace_file = NULL;
+  }
+  pthread_mutex_unlock(&g_trace_lock);
+}
+
+static uint64_t trace_now(void) { return g_trace_file ? now_us() : 0; }
+
+static void trace_span(const char *cat, const char *name,
+                       const uint64_t start_us, const char *detail_fmt, ...) {
+  if (!g_trace_file || start_us == 0)
+    return;
+
+  const uint64_t end_us = now_us();
+  char detail[512] = {0};
+  if (detail_fmt) {
+    va_list ap;
+    va_start(ap, detail_fmt);
+    vsnprintf(detail, sizeof(detail), detail_fmt, ap);
+    va_end(ap);
+  }
+
+  pthread_mutex_lock(&g_trace_lock);
+  if (g_trace_file) {
+    if (t_trace_tid == 0)
+      t_trace_tid = g_trace_next_tid++;
+    const uint64_t ts = start_us > g_trace_origin_us
+                            ? start_us - g_trace_origin_us
+                            : 0;
+    fprintf(g_trace_file, ",\n{\"name\":\"");
+    json_write_escaped(g_trace_file, name);
+    fprintf(g_trace_file,
+            "\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+            "\"ts\":%" PRIu64 ",\"dur\":%" PRIu64,
+            cat, t_trace_tid, ts, end_us - start_us);
+    if (detail[0]) {
+      fprintf(g_trace_file, ",\"args\":{\"detail\":\"");
+      json_write_escaped(g_trace_file, detail);
+      fprintf(g_trace_file, "\"}");
+    }
+    fprintf(g_trace_file, "}");
+    g_trace_events++;
+  }
+  pthread_mutex_unlock(&g_trace_lock);
+}
+
+static void trace_flush(void) {
+  pthread_mutex_lock(&g_trace_lock);
+  if (g_trace_file)
+    fflush(g_trace_file);
+  pthread_mutex_unlock(&g_trace_lock);
+}
 
 static void print_usage(void) {
   printf("Usage: admintool [options]\n\n");
@@ -77,9 +302,20 @@ static void print_usage(void) {
   printf("  -h, --help              Show this help message\n");
   printf("  -v, --version           Show version\n");
   printf("  -d, --directory <path>  Open database at path\n");
-  printf("  -c, --command <cmd>     Execute command and exit\n\n");
+  printf("  --cache-bytes <N>, --flush-threads <N>, "
+         "--compaction-threads <N>,\n"
+         "  --max-open-sstables <N>, --log-level <L>, --config <file>\n"
+         "                          Tune the database opened with -d\n");
+  printf("  --shadow, --no-wal-replay, --shadow-dir <dir>\n"
+         "                          Open a shadow copy of the -d database\n");
+  printf("  -c, --command <cmd>     Execute command and exit\n");
+  printf("  -f, --file <script>     Run commands from file ('-' = stdin)\n");
+  printf("  --batch                 Run commands from stdin, no prompt\n");
+  printf("  --stop-on-error         Stop a script at the first failure\n");
+  printf("  --metrics-port <port>   Serve OpenMetrics on port (with -d)\n");
+  printf("  --trace <file>          Write Chrome trace-event JSON to file\n\n");
   printf("Interactive Commands:\n");
-  printf("  open <path>             Open/create database at path\n");
+  printf("  open <path> [options]   Open/create database at path\n");
   printf("  close                   Close current database\n");
   printf("  info                    Show database information\n\n");
   printf("  cf-list                 List all column families\n");
@@ -94,25 +330,65 @@ static void print_usage(void) {
   printf("  delete <cf> <key>       Delete key\n");
   printf("  scan <cf> [limit]       Scan all keys (default limit: 100)\n");
   printf("  range <cf> <start> <end> [limit]  Scan keys in range\n");
-  printf("  prefix <cf> <prefix> [limit]      Scan keys with prefix\n\n");
+  printf("  prefix <cf> <prefix> [limit]      Scan keys with prefix\n");
+  printf("    keys and values: text, hex:<digits>, b64:<base64>, @<file>, "
+         "raw:<text>\n\n");
   printf("  sstable-list <cf>       List SSTables in column family\n");
   printf("  sstable-info <path>     Inspect SSTable file\n");
-  printf("  sstable-dump <path> [limit]       Dump SSTable entries\n");
+  printf("  sstable-dump <path> [limit] [filters]  Dump SSTable entries\n");
   printf("  sstable-dump-full <klog> [vlog] [limit]  Dump with vlog values\n");
   printf("  sstable-stats <path>    Show SSTable statistics\n");
   printf("  sstable-keys <path> [limit]       List SSTable keys only\n");
   printf("  sstable-checksum <path> Verify block checksums\n");
-  printf("  bloom-stats <path>      Show bloom filter statistics\n\n");
+  printf("  bloom-stats <path>      Show bloom filter statistics\n");
+  printf("  bloom-audit <path>      Check the bloom filter has every "
+         "key\n\n");
+  printf("  vlog-stats <vlog|cf> [-j N]       Block count and value size "
+         "histogram\n");
+  printf("  vlog-dump <path> [limit]          Dump vlog blocks\n");
+  printf("  vlog-checksum <vlog|cf> [-j N]    Verify vlog block checksums\n\n");
   printf("  wal-list <cf>           List WAL files in column family\n");
   printf("  wal-info <path>         Inspect WAL file\n");
-  printf("  wal-dump <path> [limit] Dump WAL entries\n");
-  printf("  wal-verify <path>       Verify WAL integrity\n");
-  printf("  wal-checksum <path>     Verify WAL block checksums\n\n");
+  printf("  wal-dump <path> [limit] [filters]  Dump WAL entries\n");
+  printf("    filters: --prefix P, --key-range A B, --seq-min N, --seq-max N,\n"
+         "             --only-deletes, --only-ttl\n");
+  printf("  wal-tail <path|cf> [--from-seq N]  Follow a WAL as it is "
+         "written\n");
+  printf("  wal-verify <path|dir|glob>... [-j N]  Verify WAL structure and "
+         "checksums\n");
+  printf("  wal-checksum <path>     Verify WAL block checksums\n");
+  printf("  wal-repair <path> [--dry-run]     Truncate WAL after last valid "
+         "block\n");
+  printf("  wal-stats <path|dir|glob>... [--top K]  Traffic mix and hot "
+         "keys\n");
+  printf("  bench-recovery <wal...> [--into dir] [--batch N]  Time WAL "
+         "replay\n\n");
   printf("  level-info <cf>         Show per-level SSTable details\n");
-  printf("  verify <cf>             Verify column family integrity\n\n");
-  printf("  compact <cf>            Trigger compaction\n");
-  printf("  flush <cf>              Flush memtable to disk\n");
-  printf("  backup <path>           Create database backup\n\n");
+  printf("  verify <cf> [--deep [--full]|--bloom] [-j N]  Verify column "
+         "family integrity\n");
+  printf("  fingerprint <path|cf|db> [-j N] [-o file]  XXH3-128 file "
+         "manifest\n");
+  printf("  read-amp-map <cf> [key...]        Map SSTable overlap and "
+         "lookup cost\n");
+  printf("  gc-debt <cf> [-j N]     Tombstone/TTL/shadowed debt and compaction "
+         "targets\n");
+  printf("  space-amp <cf-dir>      Offline merge to measure space "
+         "amplification\n");
+  printf("  vlog-gc-report <cf> [-j N]  Live and dead bytes per vlog\n");
+  printf("  ttl-forecast <cf> [--bucket hour|day]  Bytes expiring over "
+         "time\n");
+  printf("  seq-timeline <cf> [-j N]          Seq ranges, overlaps, gaps and "
+         "write-amp\n\n");
+  printf("  compact <cf> [--wait]   Trigger compaction\n");
+  printf("  flush <cf> [--wait]     Flush memtable to disk\n");
+  printf("  backup <path>           Create database backup\n");
+  printf("  serve-metrics [--metrics-port <port>] [--socket <path>] "
+         "[--interval <ms>]\n");
+  printf("                          Export OpenMetrics from cached "
+         "snapshots\n");
+  printf("  serve --socket <path> --cf <cf> [--threads N]  RESP server for "
+         "many clients\n\n");
+  printf("  trace <file>|off        Start or stop trace-event output\n");
   printf("  version                 Show TidesDB version\n");
   printf("  help                    Show this help\n");
   printf("  quit, exit              Exit admintool\n");
@@ -132,16 +408,31 @@ static char *trim_whitespace(char *str) {
   return str;
 }
 
-static int parse_args(char *line, char **argv) {
+/* splits line in place; *argv_out is grown as needed and must be freed by
+ * the caller. returns the argument count, or -1 when out of memory */
+static int parse_args(char *line, char ***argv_out) {
   int argc = 0;
+  int cap = 16;
+  char **argv = malloc(sizeof(char *) * (size_t)cap);
+  if (argv == NULL)
+    return -1;
   char *p = line;
   char quote_char = 0;
 
-  while (*p && argc < ADMINTOOL_MAX_ARGS) {
+  while (*p) {
     while (isspace((unsigned char)*p))
       p++;
     if (*p == '\0')
       break;
+    if (argc + 1 >= cap) {
+      char **grown = realloc(argv, sizeof(char *) * (size_t)cap * 2);
+      if (grown == NULL) {
+        free(argv);
+        return -1;
+      }
+      argv = grown;
+      cap *= 2;
+    }
 
     if (*p == '"' || *p == '\'') {
       quote_char = *p;
@@ -165,9 +456,174 @@ static int parse_args(char *line, char **argv) {
       }
     }
   }
+  argv[argc] = NULL;
+  *argv_out = argv;
   return argc;
 }
 
+/* a key or value argument after decoding: plain text, "hex:<digits>",
+ * "b64:<base64>", "@<file>" (mapped, not copied) or "raw:<text>" to pass a
+ * literal that would otherwise look like one of the encodings */
+typedef struct {
+  const uint8_t *data;
+  size_t size;
+  uint8_t *owned;
+  void *map;
+  size_t map_size;
+} arg_bytes_t;
+
+static int hex_digit(const char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+static int b64_digit(const char c) {
+  if (c >= 'A' && c <= 'Z')
+    return c - 'A';
+  if (c >= 'a' && c <= 'z')
+    return c - 'a' + 26;
+  if (c >= '0' && c <= '9')
+    return c - '0' + 52;
+  if (c == '+' || c == '-')
+    return 62;
+  if (c == '/' || c == '_')
+    return 63;
+  return -1;
+}
+
+static int arg_bytes_decode(const char *arg, arg_bytes_t *out) {
+  memset(out, 0, sizeof(*out));
+
+  if (strncmp(arg, "hex:", 4) == 0) {
+    const char *hex = arg + 4;
+    const size_t len = strlen(hex);
+    if (len % 2 != 0) {
+      printf("Invalid hex argument: odd number of digits\n");
+      return -1;
+    }
+    out->owned = malloc(len / 2 + 1);
+    if (out->owned == NULL) {
+      printf("Out of memory\n");
+      return -1;
+    }
+    for (size_t i = 0; i < len / 2; i++) {
+      const int hi = hex_digit(hex[2 * i]);
+      const int lo = hex_digit(hex[2 * i + 1]);
+      if (hi < 0 || lo < 0) {
+        printf("Invalid hex argument at offset %zu\n", 2 * i);
+        free(out->owned);
+        out->owned = NULL;
+        return -1;
+      }
+      out->owned[i] = (uint8_t)(hi << 4 | lo);
+    }
+    out->data = out->owned;
+    out->size = len / 2;
+    return 0;
+  }
+
+  if (strncmp(arg, "b64:", 4) == 0) {
+    const char *b64 = arg + 4;
+    size_t len = strlen(b64);
+    while (len > 0 && b64[len - 1] == '=')
+      len--;
+    out->owned = malloc(len * 3 / 4 + 1);
+    if (out->owned == NULL) {
+      printf("Out of memory\n");
+      return -1;
+    }
+    uint32_t acc = 0;
+    int bits = 0;
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+      const int d = b64_digit(b64[i]);
+      if (d < 0) {
+        printf("Invalid base64 argument at offset %zu\n", i);
+        free(out->owned);
+        out->owned = NULL;
+        return -1;
+      }
+      acc = acc << 6 | (uint32_t)d;
+      bits += 6;
+      if (bits >= 8) {
+        bits -= 8;
+        out->owned[n++] = (uint8_t)(acc >> bits);
+      }
+    }
+    out->data = out->owned;
+    out->size = n;
+    return 0;
+  }
+
+  if (arg[0] == '@') {
+    const char *path = arg + 1;
+    const int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+      printf("Cannot read '%s': %s\n", path, strerror(errno));
+      if (fd >= 0)
+        close(fd);
+      return -1;
+    }
+    out->size = (size_t)st.st_size;
+    if (out->size == 0) {
+      close(fd);
+      out->data = (const uint8_t *)"";
+      return 0;
+    }
+#ifndef _WIN32
+    void *map = mmap(NULL, out->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+      printf("Cannot map '%s': %s\n", path, strerror(errno));
+      return -1;
+    }
+    out->map = map;
+    out->map_size = out->size;
+    out->data = map;
+#else
+    out->owned = malloc(out->size);
+    if (out->owned == NULL ||
+        read(fd, out->owned, (unsigned)out->size) != (int)out->size) {
+      printf("Cannot read '%s'\n", path);
+      free(out->owned);
+      out->owned = NULL;
+      close(fd);
+      return -1;
+    }
+    close(fd);
+    out->data = out->owned;
+#endif
+    return 0;
+  }
+
+  if (strncmp(arg, "raw:", 4) == 0)
+    arg += 4;
+  out->data = (const uint8_t *)arg;
+  out->size = strlen(arg);
+  return 0;
+}
+
+static void arg_bytes_free(arg_bytes_t *a) {
+#ifndef _WIN32
+  if (a->map != NULL)
+    munmap(a->map, a->map_size);
+#endif
+  free(a->owned);
+  memset(a, 0, sizeof(*a));
+}
+
+static void arg_bytes_free_array(arg_bytes_t *a, const int count) {
+  for (int i = 0; a != NULL && i < count; i++)
+    arg_bytes_free(&a[i]);
+  free(a);
+}
+
 static const char *error_to_string(const int err) {
   switch (err) {
   case TDB_SUCCESS:
@@ -248,9 +704,234 @@ static const char *isolation_level_to_string(const int level) {
   }
 }
 
+/* parses "64M", "2G", "1048576" (binary multiples) into bytes */
+static int parse_byte_size(const char *text, uint64_t *out) {
+  char *end;
+  const double value = strtod(text, &end);
+  if (end == text || !isfinite(value) || value < 0)
+    return -1;
+  double scale = 1;
+  switch (toupper((unsigned char)*end)) {
+  case 'K':
+    scale = 1024.0;
+    break;
+  case 'M':
+    scale = 1024.0 * 1024;
+    break;
+  case 'G':
+    scale = 1024.0 * 1024 * 1024;
+    break;
+  case 'T':
+    scale = 1024.0 * 1024 * 1024 * 1024;
+    break;
+  case '\0':
+    break;
+  default:
+    return -1;
+  }
+  if (*end != '\0' && end[1] != '\0' && strcasecmp(end + 1, "B") != 0 &&
+      strcasecmp(end + 1, "iB") != 0)
+    return -1;
+  /* 2^64 itself does not fit */
+  if (value * scale >= 18446744073709551616.0)
+    return -1;
+  *out = (uint64_t)(value * scale);
+  return 0;
+}
+
+/* parses a whole decimal count in [1, max]; trailing text is an error */
+static int parse_count(const char *text, const long max, long *out) {
+  char *end;
+  errno = 0;
+  const long value = strtol(text, &end, 10);
+  if (end == text || *end != '\0' || errno == ERANGE || value < 1 ||
+      value > max)
+    return -1;
+  *out = value;
+  return 0;
+}
+
+static const char *const k_log_levels[] = {"debug", "info",  "warn",
+                                           "error", "fatal", "none"};
+
+/* sets one open option by name; names are accepted with '-' or '_' and with
+ * or without the leading "--", so the same keys work on the command line
+ * and in a --config file */
+static int open_config_set(tidesdb_config_t *config, const char *name,
+                           const char *value) {
+  char key[64];
+  while (*name == '-')
+    name++;
+  size_t n = 0;
+  for (; name[n] && n < sizeof(key) - 1; n++)
+    key[n] = name[n] == '_' ? '-' : (char)tolower((unsigned char)name[n]);
+  key[n] = '\0';
+
+  if (strcmp(key, "cache-bytes") == 0 ||
+      strcmp(key, "block-cache-size") == 0) {
+    uint64_t bytes;
+    if (parse_byte_size(value, &bytes) != 0)
+      return -1;
+    config->block_cache_size = (size_t)bytes;
+  } else if (strcmp(key, "flush-threads") == 0 ||
+             strcmp(key, "num-flush-threads") == 0) {
+    long threads;
+    if (parse_count(value, INT_MAX, &threads) != 0)
+      return -1;
+    config->num_flush_threads = (int)threads;
+  } else if (strcmp(key, "compaction-threads") == 0 ||
+             strcmp(key, "num-compaction-threads") == 0) {
+    long threads;
+    if (parse_count(value, INT_MAX, &threads) != 0)
+      return -1;
+    config->num_compaction_threads = (int)threads;
+  } else if (strcmp(key, "max-open-sstables") == 0) {
+    long count;
+    if (parse_count(value, LONG_MAX, &count) != 0)
+      return -1;
+    config->max_open_sstables = (size_t)count;
+  } else if (strcmp(key, "log-level") == 0) {
+    int level = -1;
+    for (int i = 0; i < 6; i++)
+      if (strcasecmp(value, k_log_levels[i]) == 0)
+        level = i;
+    if (level < 0)
+      return -1;
+    config->log_level = (tidesdb_log_level_t)(TDB_LOG_DEBUG + level);
+  } else {
+    return -2;
+  }
+  return 0;
+}
+
+/* reads "key = value" lines ('#' starts a comment) into config */
+static int open_config_load(tidesdb_config_t *config, const char *path) {
+  FILE *f = fopen(path, "r");
+  if (f == NULL) {
+    printf("Failed to read config '%s': %s\n", path, strerror(errno));
+    return -1;
+  }
+
+  strbuf_t line = {0};
+  int line_no = 0;
+  int rc = 0;
+  while (rc == 0 && strbuf_read_line(&line, f) == 1) {
+    line_no++;
+    char *hash = strchr(line.data, '#');
+    if (hash)
+      *hash = '\0';
+    char *text = trim_whitespace(line.data);
+    if (*text == '\0')
+      continue;
+    char *eq = strchr(text, '=');
+    if (eq == NULL) {
+      printf("%s:%d: expected 'key = value'\n", path, line_no);
+      rc = -1;
+      break;
+    }
+    *eq = '\0';
+    const char *key = trim_whitespace(text);
+    const char *value = trim_whitespace(eq + 1);
+    const int set = open_config_set(config, key, value);
+    if (set == -2)
+      printf("%s:%d: unknown option '%s'\n", path, line_no, key);
+    else if (set != 0)
+      printf("%s:%d: invalid value '%s' for '%s'\n", path, line_no, value,
+             key);
+    if (set != 0)
+      rc = -1;
+  }
+  strbuf_free(&line);
+  fclose(f);
+  return rc;
+}
+
+static int copy_file_cow(const char *src, const char *dst);
+static int remove_tree(const char *path);
+
+typedef struct {
+  uint64_t cloned;
+  uint64_t sstables_copied;
+  uint64_t sstable_copied_bytes;
+  uint64_t copied;
+  uint64_t dirs;
+  uint64_t wal_skipped;
+  uint64_t wal_skipped_bytes;
+} shadow_stats_t;
+
+/* mirrors a database directory for inspection: SSTable files are reflink
+ * clones where the filesystem supports them and full copies elsewhere, so
+ * no engine write can reach the originals; small metadata files are copied,
+ * and WALs are copied or, with skip_wal, left out so that opening does not
+ * replay them */
+static int shadow_populate(const char *src, const char *dst,
+                           const int skip_wal, shadow_stats_t *stats) {
+  DIR *dir = opendir(src);
+  if (dir == NULL) {
+    printf("Cannot read '%s': %s\n", src, strerror(errno));
+    return -1;
+  }
+
+  int rc = 0;
+  struct dirent *ent;
+  while (rc == 0 && (ent = readdir(dir)) != NULL) {
+    if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
+      continue;
+    char from[4096];
+    char to[4096];
+    snprintf(from, sizeof(from), "%s/%s", src, ent->d_name);
+    snprintf(to, sizeof(to), "%s/%s", dst, ent->d_name);
+    struct stat st;
+    if (stat(from, &st) != 0)
+      continue;
+
+    const char *ext = strrchr(ent->d_name, '.');
+    if (S_ISDIR(st.st_mode)) {
+      if (mkdir(to, 0755) != 0) {
+        printf("Cannot create '%s': %s\n", to, strerror(errno));
+        rc = -1;
+      } else {
+        stats->dirs++;
+        rc = shadow_populate(from, to, skip_wal, stats);
+      }
+    } else if (ext &&
+               (strcmp(ext, ".klog") == 0 || strcmp(ext, ".vlog") == 0)) {
+      const int cloned = copy_file_cow(from, to);
+      if (cloned < 0) {
+        printf("Cannot copy '%s' into the shadow directory: %s\n", from,
+               strerror(errno));
+        rc = -1;
+      } else if (cloned) {
+        stats->cloned++;
+      } else {
+        stats->sstables_copied++;
+        stats->sstable_copied_bytes += (uint64_t)st.st_size;
+      }
+    } else if (skip_wal && ext && strcmp(ext, ".log") == 0 &&
+               strncmp(ent->d_name, "wal_", 4) == 0) {
+      stats->wal_skipped++;
+      stats->wal_skipped_bytes += (uint64_t)st.st_size;
+    } else if (S_ISREG(st.st_mode)) {
+      if (copy_file_cow(from, to) < 0) {
+        printf("Cannot copy '%s': %s\n", from, strerror(errno));
+        rc = -1;
+      } else {
+        stats->copied++;
+      }
+    }
+  }
+  closedir(dir);
+  return rc;
+}
+
 static int cmd_open(const int argc, char **argv) {
   if (argc < 2) {
-    printf("Usage: open <path>\n");
+    printf("Usage: open <path> [--cache-bytes N] [--flush-threads N] "
+           "[--compaction-threads N]\n"
+           "            [--max-open-sstables N] [--log-level L] "
+           "[--config file]\n"
+           "            [--shadow] [--no-wal-replay] "
+           "[--shadow-dir dir]\n");
     return -1;
   }
 
@@ -263,15 +944,153 @@ static int cmd_open(const int argc, char **argv) {
   config.db_path = argv[1];
   config.log_level = TDB_LOG_NONE;
 
+  int shadow_open = 0;
+  int no_wal_replay = 0;
+  const char *shadow_parent = NULL;
+
+  /* a --config file is applied first so flags on the command line win */
+  for (int i = 2; i + 1 < argc; i++) {
+    if (strcmp(argv[i], "--config") == 0 &&
+        open_config_load(&config, argv[i + 1]) != 0)
+      return -1;
+  }
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--config") == 0) {
+      i++;
+      continue;
+    }
+    if (strcmp(argv[i], "--shadow") == 0) {
+      shadow_open = 1;
+      continue;
+    }
+    if (strcmp(argv[i], "--no-wal-replay") == 0) {
+      /* skipped WAL entries would make any write meaningless */
+      shadow_open = 1;
+      no_wal_replay = 1;
+      continue;
+    }
+    if (strcmp(argv[i], "--shadow-dir") == 0 && i + 1 < argc) {
+      shadow_parent = argv[++i];
+      continue;
+    }
+    if (strncmp(argv[i], "--", 2) != 0 || i + 1 >= argc) {
+      printf("Unexpected argument '%s'\n", argv[i]);
+      return -1;
+    }
+    const int set = open_config_set(&config, argv[i], argv[i + 1]);
+    if (set == -2) {
+      printf("Unknown option '%s'\n", argv[i]);
+      return -1;
+    }
+    if (set != 0) {
+      printf("Invalid value '%s' for %s\n", argv[i + 1], argv[i]);
+      return -1;
+    }
+    i++;
+  }
+
+  const uint64_t shadow_start = now_us();
+  shadow_stats_t shadow = {0};
+  char shadow_dir[4096] = {0};
+  if (shadow_open) {
+#ifndef _WIN32
+    const tidesdb_config_t defaults = tidesdb_default_config();
+    if (config.num_flush_threads != defaults.num_flush_threads ||
+        config.num_compaction_threads != defaults.num_compaction_threads) {
+      printf("--flush-threads and --compaction-threads cannot be combined "
+             "with --shadow\n");
+      return -1;
+    }
+    struct stat st;
+    if (stat(argv[1], &st) != 0 || !S_ISDIR(st.st_mode)) {
+      printf("No database at '%s'\n", argv[1]);
+      return -1;
+    }
+    char source[4096];
+    if (realpath(argv[1], source) == NULL) {
+      printf("Cannot resolve '%s': %s\n", argv[1], strerror(errno));
+      return -1;
+    }
+    const char *tmp = shadow_parent ? shadow_parent : getenv("TMPDIR");
+    snprintf(shadow_dir, sizeof(shadow_dir), "%s/admintool-inspect-XXXXXX",
+             tmp && *tmp ? tmp : "/tmp");
+    if (mkdtemp(shadow_dir) == NULL) {
+      printf("Failed to create shadow directory: %s\n", strerror(errno));
+      return -1;
+    }
+    if (shadow_populate(source, shadow_dir, no_wal_replay, &shadow) != 0) {
+      remove_tree(shadow_dir);
+      return -1;
+    }
+    /* the engine needs at least one of each; with writes refused only WAL
+     * recovery flushes, and a compaction it starts rewrites shadow files */
+    config.db_path = shadow_dir;
+    config.num_flush_threads = 1;
+    config.num_compaction_threads = 1;
+#else
+    printf("--shadow is not supported on this platform\n");
+    return -1;
+#endif
+  }
+  const uint64_t engine_start = now_us();
+
   const int ret = tidesdb_open(&config, &g_db);
   if (ret != TDB_SUCCESS) {
     printf("Failed to open database: %s\n", error_to_string(ret));
+    if (shadow_open)
+      remove_tree(shadow_dir);
     return ret;
   }
+  const uint64_t open_end = now_us();
 
   strncpy(g_db_path, argv[1], sizeof(g_db_path) - 1);
   g_db_path[sizeof(g_db_path) - 1] = '\0';
-  printf("Opened database at '%s'\n", g_db_path);
+  g_db_config = config;
+  g_db_config.db_path = g_db_path;
+  g_db_shadow = shadow_open;
+  snprintf(g_shadow_dir, sizeof(g_shadow_dir), "%s", shadow_dir);
+  if (!shadow_open) {
+    printf("Opened database at '%s'\n", g_db_path);
+    return 0;
+  }
+
+  printf("Opened shadow copy of '%s' (%s)\n", g_db_path,
+         no_wal_replay ? "WAL not replayed" : "WAL replayed in the shadow");
+  printf("  Open Latency: %.1f ms\n",
+         (double)(open_end - shadow_start) / 1000.0);
+  printf("    Shadow directory: %8.1f ms (%" PRIu64
+         " SSTable files cloned, %" PRIu64 " files copied)\n",
+         (double)(engine_start - shadow_start) / 1000.0, shadow.cloned,
+         shadow.sstables_copied + shadow.copied);
+  printf("    Engine open:      %8.1f ms\n",
+         (double)(open_end - engine_start) / 1000.0);
+  if (shadow.sstables_copied > 0)
+    printf("  SSTables Copied: %" PRIu64 " (%.2f MB); the shadow's "
+           "filesystem has no reflinks\n",
+           shadow.sstables_copied,
+           (double)shadow.sstable_copied_bytes / (1024 * 1024));
+  if (no_wal_replay)
+    printf("  WALs Skipped: %" PRIu64 " (%.2f MB); recent writes are not "
+           "visible\n",
+           shadow.wal_skipped,
+           (double)shadow.wal_skipped_bytes / (1024 * 1024));
+  return 0;
+}
+
+/* closes g_db and removes the shadow directory of a shadow open */
+static int close_database(void) {
+  if (g_db == NULL)
+    return 0;
+  const int ret = tidesdb_close(g_db);
+  if (ret != TDB_SUCCESS)
+    return ret;
+  g_db = NULL;
+  g_db_path[0] = '\0';
+  g_db_shadow = 0;
+  if (g_shadow_dir[0] != '\0') {
+    remove_tree(g_shadow_dir);
+    g_shadow_dir[0] = '\0';
+  }
   return 0;
 }
 
@@ -284,15 +1103,13 @@ static int cmd_close(int argc, char **argv) {
     return -1;
   }
 
-  const int ret = tidesdb_close(g_db);
+  const int ret = close_database();
   if (ret != TDB_SUCCESS) {
     printf("Failed to close database: %s\n", error_to_string(ret));
     return ret;
   }
 
-  g_db = NULL;
   printf("Database closed.\n");
-  g_db_path[0] = '\0';
   return 0;
 }
 
@@ -307,6 +1124,18 @@ static int cmd_info(int argc, char **argv) {
 
   printf("Database Information:\n");
   printf("  Path: %s\n", g_db_path);
+  if (g_db_shadow)
+    printf("  Mode: shadow copy (engine files in %s)\n", g_shadow_dir);
+  printf("  Configuration:\n");
+  printf("    Block Cache Size: %zu bytes (%.2f MB)\n",
+         g_db_config.block_cache_size,
+         (double)g_db_config.block_cache_size / (1024 * 1024));
+  printf("    Flush Threads: %d\n", g_db_config.num_flush_threads);
+  printf("    Compaction Threads: %d\n", g_db_config.num_compaction_threads);
+  printf("    Max Open SSTables: %zu\n", g_db_config.max_open_sstables);
+  const int level = (int)g_db_config.log_level - (int)TDB_LOG_DEBUG;
+  printf("    Log Level: %s\n",
+         level >= 0 && level < 6 ? k_log_levels[level] : "unknown");
 
   char **cf_names = NULL;
   int cf_count = 0;
@@ -603,15 +1432,28 @@ static int cmd_put(const int argc, char **argv) {
     return -1;
   }
 
+  arg_bytes_t key;
+  arg_bytes_t value;
+  if (arg_bytes_decode(argv[2], &key) != 0)
+    return -1;
+  if (arg_bytes_decode(argv[3], &value) != 0) {
+    arg_bytes_free(&key);
+    return -1;
+  }
+
   tidesdb_txn_t *txn = NULL;
   int ret = tidesdb_txn_begin(g_db, &txn);
   if (ret != TDB_SUCCESS) {
     printf("Failed to begin transaction: %s\n", error_to_string(ret));
+    arg_bytes_free(&key);
+    arg_bytes_free(&value);
     return ret;
   }
 
-  ret = tidesdb_txn_put(txn, cf, (const uint8_t *)argv[2], strlen(argv[2]),
-                        (const uint8_t *)argv[3], strlen(argv[3]), 0);
+  ret = tidesdb_txn_put(txn, cf, key.data, key.size, value.data, value.size,
+                        0);
+  arg_bytes_free(&key);
+  arg_bytes_free(&value);
   if (ret != TDB_SUCCESS) {
     printf("Failed to put: %s\n", error_to_string(ret));
     tidesdb_txn_rollback(txn);
@@ -648,17 +1490,22 @@ static int cmd_get(const int argc, char **argv) {
     return -1;
   }
 
+  arg_bytes_t key;
+  if (arg_bytes_decode(argv[2], &key) != 0)
+    return -1;
+
   tidesdb_txn_t *txn = NULL;
   int ret = tidesdb_txn_begin(g_db, &txn);
   if (ret != TDB_SUCCESS) {
     printf("Failed to begin transaction: %s\n", error_to_string(ret));
+    arg_bytes_free(&key);
     return ret;
   }
 
   uint8_t *value = NULL;
   size_t value_size = 0;
-  ret = tidesdb_txn_get(txn, cf, (const uint8_t *)argv[2], strlen(argv[2]),
-                        &value, &value_size);
+  ret = tidesdb_txn_get(txn, cf, key.data, key.size, &value, &value_size);
+  arg_bytes_free(&key);
   if (ret != TDB_SUCCESS) {
     if (ret == TDB_ERR_NOT_FOUND) {
       printf("(nil)\n");
@@ -670,7 +1517,8 @@ static int cmd_get(const int argc, char **argv) {
     return ret;
   }
 
-  printf("%.*s\n", (int)value_size, (char *)value);
+  fwrite(value, 1, value_size, cmd_out());
+  printf("\n");
   free(value);
   tidesdb_txn_rollback(txn);
   tidesdb_txn_free(txn);
@@ -694,14 +1542,20 @@ static int cmd_delete(const int argc, char **argv) {
     return -1;
   }
 
+  arg_bytes_t key;
+  if (arg_bytes_decode(argv[2], &key) != 0)
+    return -1;
+
   tidesdb_txn_t *txn = NULL;
   int ret = tidesdb_txn_begin(g_db, &txn);
   if (ret != TDB_SUCCESS) {
     printf("Failed to begin transaction: %s\n", error_to_string(ret));
+    arg_bytes_free(&key);
     return ret;
   }
 
-  ret = tidesdb_txn_delete(txn, cf, (const uint8_t *)argv[2], strlen(argv[2]));
+  ret = tidesdb_txn_delete(txn, cf, key.data, key.size);
+  arg_bytes_free(&key);
   if (ret != TDB_SUCCESS) {
     printf("Failed to delete: %s\n", error_to_string(ret));
     tidesdb_txn_rollback(txn);
@@ -747,6 +1601,7 @@ static int cmd_scan(const int argc, char **argv) {
     return -1;
   }
 
+  const uint64_t query_start = trace_now();
   tidesdb_txn_t *txn = NULL;
   int ret = tidesdb_txn_begin(g_db, &txn);
   if (ret != TDB_SUCCESS) {
@@ -795,6 +1650,8 @@ static int cmd_scan(const int argc, char **argv) {
   } else {
     printf("(%d entries)\n", count);
   }
+  trace_span("query", "scan", query_start, "cf=%s limit=%d returned=%d",
+             argv[1], limit, count);
 
   tidesdb_iter_free(iter);
   tidesdb_txn_rollback(txn);
@@ -828,15 +1685,25 @@ static int cmd_range(const int argc, char **argv) {
     return -1;
   }
 
+  arg_bytes_t start_arg;
+  arg_bytes_t end_arg;
+  if (arg_bytes_decode(argv[2], &start_arg) != 0)
+    return -1;
+  if (arg_bytes_decode(argv[3], &end_arg) != 0) {
+    arg_bytes_free(&start_arg);
+    return -1;
+  }
   const char *start_key = argv[2];
   const char *end_key = argv[3];
-  const size_t start_key_size = strlen(start_key);
-  const size_t end_key_size = strlen(end_key);
+  const size_t end_key_size = end_arg.size;
 
+  const uint64_t query_start = trace_now();
   tidesdb_txn_t *txn = NULL;
   int ret = tidesdb_txn_begin(g_db, &txn);
   if (ret != TDB_SUCCESS) {
     printf("Failed to begin transaction: %s\n", error_to_string(ret));
+    arg_bytes_free(&start_arg);
+    arg_bytes_free(&end_arg);
     return ret;
   }
 
@@ -846,15 +1713,19 @@ static int cmd_range(const int argc, char **argv) {
     printf("Failed to create iterator: %s\n", error_to_string(ret));
     tidesdb_txn_rollback(txn);
     tidesdb_txn_free(txn);
+    arg_bytes_free(&start_arg);
+    arg_bytes_free(&end_arg);
     return ret;
   }
 
-  ret = tidesdb_iter_seek(iter, (const uint8_t *)start_key, start_key_size);
+  ret = tidesdb_iter_seek(iter, start_arg.data, start_arg.size);
+  arg_bytes_free(&start_arg);
   if (ret != TDB_SUCCESS) {
     printf("(empty range)\n");
     tidesdb_iter_free(iter);
     tidesdb_txn_rollback(txn);
     tidesdb_txn_free(txn);
+    arg_bytes_free(&end_arg);
     return 0;
   }
 
@@ -867,7 +1738,7 @@ static int cmd_range(const int argc, char **argv) {
 
     if (tidesdb_iter_key(iter, &key, &key_size) == TDB_SUCCESS) {
       if (key_size > end_key_size ||
-          memcmp(key, end_key,
+          memcmp(key, end_arg.data,
                  key_size < end_key_size ? key_size : end_key_size) > 0) {
         break;
       }
@@ -888,7 +1759,10 @@ static int cmd_range(const int argc, char **argv) {
   } else {
     printf("(%d entries in range)\n", count);
   }
+  trace_span("query", "range", query_start, "cf=%s start=%s end=%s returned=%d",
+             argv[1], start_key, end_key, count);
 
+  arg_bytes_free(&end_arg);
   tidesdb_iter_free(iter);
   tidesdb_txn_rollback(txn);
   tidesdb_txn_free(txn);
@@ -921,13 +1795,19 @@ static int cmd_prefix(const int argc, char **argv) {
     return -1;
   }
 
+  arg_bytes_t prefix_arg;
+  if (arg_bytes_decode(argv[2], &prefix_arg) != 0)
+    return -1;
   const char *prefix = argv[2];
-  const size_t prefix_size = strlen(prefix);
+  const uint8_t *prefix_bytes = prefix_arg.data;
+  const size_t prefix_size = prefix_arg.size;
 
+  const uint64_t query_start = trace_now();
   tidesdb_txn_t *txn = NULL;
   int ret = tidesdb_txn_begin(g_db, &txn);
   if (ret != TDB_SUCCESS) {
     printf("Failed to begin transaction: %s\n", error_to_string(ret));
+    arg_bytes_free(&prefix_arg);
     return ret;
   }
 
@@ -937,15 +1817,17 @@ static int cmd_prefix(const int argc, char **argv) {
     printf("Failed to create iterator: %s\n", error_to_string(ret));
     tidesdb_txn_rollback(txn);
     tidesdb_txn_free(txn);
+    arg_bytes_free(&prefix_arg);
     return ret;
   }
 
-  ret = tidesdb_iter_seek(iter, (const uint8_t *)prefix, prefix_size);
+  ret = tidesdb_iter_seek(iter, prefix_bytes, prefix_size);
   if (ret != TDB_SUCCESS) {
     printf("(no keys with prefix)\n");
     tidesdb_iter_free(iter);
     tidesdb_txn_rollback(txn);
     tidesdb_txn_free(txn);
+    arg_bytes_free(&prefix_arg);
     return 0;
   }
 
@@ -957,7 +1839,8 @@ static int cmd_prefix(const int argc, char **argv) {
     size_t value_size = 0;
 
     if (tidesdb_iter_key(iter, &key, &key_size) == TDB_SUCCESS) {
-      if (key_size < prefix_size || memcmp(key, prefix, prefix_size) != 0) {
+      if (key_size < prefix_size ||
+          memcmp(key, prefix_bytes, prefix_size) != 0) {
         break;
       }
 
@@ -977,10 +1860,13 @@ static int cmd_prefix(const int argc, char **argv) {
   } else {
     printf("(%d entries with prefix)\n", count);
   }
+  trace_span("query", "prefix", query_start, "cf=%s prefix=%s returned=%d",
+             argv[1], prefix, count);
 
   tidesdb_iter_free(iter);
   tidesdb_txn_rollback(txn);
   tidesdb_txn_free(txn);
+  arg_bytes_free(&prefix_arg);
   return 0;
 }
 
@@ -1101,849 +1987,1238 @@ static int decode_varint_safe(const uint8_t *data, uint64_t *value,
   return -1;
 }
 
-static int cmd_sstable_dump(const int argc, char **argv) {
-  if (argc < 2) {
-    printf("Usage: sstable-dump <klog_path> [limit]\n");
+#define KLOG_TRAILER_BLOCKS 3
+
+typedef struct {
+  uint8_t flags;
+  uint64_t seq;
+  int64_t ttl;
+  uint64_t vlog_offset;
+  const uint8_t *key;
+  uint64_t key_size;
+  const uint8_t *value;
+  uint64_t value_size;
+  size_t encoded_size;
+  int partial; /* set by wal_decode_partial: 1 data cut, 2 TTL cut too */
+} klog_entry_t;
+
+/* WAL entries use the klog layout without delta sequences or vlog offsets */
+static int decode_kv_entry(const uint8_t **ptr, size_t *remaining,
+                           uint64_t *prev_seq, klog_entry_t *entry,
+                           const int wal) {
+  const uint8_t *p = *ptr;
+  size_t left = *remaining;
+
+  if (left < 1)
     return -1;
-  }
 
-  int limit = ADMINTOOL_DEFAULT_DUMP_LIMIT;
-  if (argc >= 3) {
-    char *endptr;
-    const long parsed = strtol(argv[2], &endptr, 10);
-    if (*endptr == '\0' && parsed > 0) {
-      limit = (int)parsed;
-    }
-  }
+  memset(entry, 0, sizeof(*entry));
+  entry->flags = *p++;
+  left--;
 
-  struct stat st;
-  if (stat(argv[1], &st) == 0 && st.st_size > ADMINTOOL_LARGE_FILE_THRESHOLD) {
-    printf("Warning: Large file (%" PRId64 " MB). ",
-           (int64_t)(st.st_size / (1024 * 1024)));
-    printf("Limiting to %d entries. Use explicit limit to override.\n", limit);
-  }
+  uint64_t seq_value;
+  int bytes_read = decode_varint_safe(p, &entry->key_size, left);
+  if (bytes_read < 0 || (size_t)bytes_read > left)
+    return -1;
+  p += bytes_read;
+  left -= bytes_read;
 
-  block_manager_t *bm = NULL;
-  if (block_manager_open(&bm, argv[1], BLOCK_MANAGER_SYNC_NONE) != 0) {
-    printf("Failed to open SSTable file: %s\n", argv[1]);
+  bytes_read = decode_varint_safe(p, &entry->value_size, left);
+  if (bytes_read < 0 || (size_t)bytes_read > left)
     return -1;
-  }
+  p += bytes_read;
+  left -= bytes_read;
 
-  block_manager_cursor_t *cursor = NULL;
-  if (block_manager_cursor_init(&cursor, bm) != 0) {
-    printf("Failed to create cursor\n");
-    block_manager_close(bm);
+  bytes_read = decode_varint_safe(p, &seq_value, left);
+  if (bytes_read < 0 || (size_t)bytes_read > left)
     return -1;
+  p += bytes_read;
+  left -= bytes_read;
+
+  entry->seq = seq_value;
+  if (!wal && (entry->flags & TDB_KV_FLAG_DELTA_SEQ))
+    entry->seq = *prev_seq + seq_value;
+
+  if (entry->flags & TDB_KV_FLAG_HAS_TTL) {
+    if (left < sizeof(int64_t))
+      return -1;
+    memcpy(&entry->ttl, p, sizeof(int64_t));
+    p += sizeof(int64_t);
+    left -= sizeof(int64_t);
   }
 
-  if (block_manager_cursor_goto_first(cursor) != 0) {
-    printf("(empty SSTable)\n");
-    block_manager_cursor_free(cursor);
-    block_manager_close(bm);
-    return 0;
+  if (!wal && (entry->flags & TDB_KV_FLAG_HAS_VLOG)) {
+    bytes_read = decode_varint_safe(p, &entry->vlog_offset, left);
+    if (bytes_read < 0 || (size_t)bytes_read > left)
+      return -1;
+    p += bytes_read;
+    left -= bytes_read;
   }
 
-  printf("SSTable Entries (limit: %d):\n", limit);
-  int total_entries = 0;
-  int block_num = 0;
+  if (left < entry->key_size)
+    return -1;
+  entry->key = p;
+  p += entry->key_size;
+  left -= entry->key_size;
+
+  if ((wal || !(entry->flags & TDB_KV_FLAG_HAS_VLOG)) &&
+      entry->value_size > 0) {
+    if (left < entry->value_size)
+      return -1;
+    entry->value = p;
+    p += entry->value_size;
+    left -= entry->value_size;
+  }
+
+  *prev_seq = entry->seq;
+  entry->encoded_size = (size_t)(p - *ptr);
+  *ptr = p;
+  *remaining = left;
+  return 0;
+}
 
-  while (total_entries < limit) {
-    block_manager_block_t *block = block_manager_cursor_read(cursor);
-    if (!block)
-      break;
+static int klog_decode_entry(const uint8_t **ptr, size_t *remaining,
+                             uint64_t *prev_seq, klog_entry_t *entry) {
+  return decode_kv_entry(ptr, remaining, prev_seq, entry, 0);
+}
 
-    if (block->size < 4) {
-      block_manager_block_release(block);
-      if (block_manager_cursor_next(cursor) != 0)
-        break;
-      block_num++;
-      continue;
-    }
+static int wal_decode_entry(const uint8_t *data, const size_t size,
+                            klog_entry_t *entry) {
+  const uint8_t *ptr = data;
+  size_t remaining = size;
+  uint64_t prev_seq = 0;
+  return decode_kv_entry(&ptr, &remaining, &prev_seq, entry, 1);
+}
 
-    const uint8_t *ptr = (const uint8_t *)block->data;
-    size_t remaining = block->size;
+/* decodes what is left of a WAL entry whose TTL or value runs past the end
+ * of the block, so a dump can still show it; the header must be intact */
+static int wal_decode_partial(const uint8_t *data, const size_t size,
+                              klog_entry_t *entry) {
+  const uint8_t *p = data;
+  size_t left = size;
+  if (left < 1)
+    return -1;
 
-    uint64_t prev_seq = 0;
-    int entry_in_block = 0;
+  memset(entry, 0, sizeof(*entry));
+  entry->flags = *p++;
+  left--;
+  entry->partial = 1;
 
-    while (remaining > 0 && total_entries < limit) {
-      if (remaining < 1)
-        break;
+  int bytes_read = decode_varint_safe(p, &entry->key_size, left);
+  if (bytes_read < 0 || (size_t)bytes_read > left)
+    return -1;
+  p += bytes_read;
+  left -= bytes_read;
 
-      const uint8_t flags = *ptr++;
-      remaining--;
+  bytes_read = decode_varint_safe(p, &entry->value_size, left);
+  if (bytes_read < 0 || (size_t)bytes_read > left)
+    return -1;
+  p += bytes_read;
+  left -= bytes_read;
 
-      uint64_t key_size, value_size, seq_value;
+  bytes_read = decode_varint_safe(p, &entry->seq, left);
+  if (bytes_read < 0 || (size_t)bytes_read > left)
+    return -1;
+  p += bytes_read;
+  left -= bytes_read;
 
-      int bytes_read = decode_varint_safe(ptr, &key_size, remaining);
-      if (bytes_read < 0 || (size_t)bytes_read > remaining)
-        break;
-      ptr += bytes_read;
-      remaining -= bytes_read;
+  if (entry->flags & TDB_KV_FLAG_HAS_TTL) {
+    if (left < sizeof(int64_t)) {
+      entry->partial = 2;
+      return 0;
+    }
+    memcpy(&entry->ttl, p, sizeof(int64_t));
+    p += sizeof(int64_t);
+    left -= sizeof(int64_t);
+  }
 
-      bytes_read = decode_varint_safe(ptr, &value_size, remaining);
-      if (bytes_read < 0 || (size_t)bytes_read > remaining)
-        break;
-      ptr += bytes_read;
-      remaining -= bytes_read;
+  if (left < entry->key_size)
+    return 0;
+  entry->key = p;
+  p += entry->key_size;
+  left -= entry->key_size;
 
-      bytes_read = decode_varint_safe(ptr, &seq_value, remaining);
-      if (bytes_read < 0 || (size_t)bytes_read > remaining)
-        break;
-      ptr += bytes_read;
-      remaining -= bytes_read;
+  if (entry->value_size > 0 && left >= entry->value_size)
+    entry->value = p;
+  return 0;
+}
 
-      uint64_t seq = seq_value;
-      if (flags & TDB_KV_FLAG_DELTA_SEQ) {
-        seq = prev_seq + seq_value;
-      }
-      prev_seq = seq;
+static int compare_keys(const uint8_t *a, const size_t a_size, const uint8_t *b,
+                        const size_t b_size) {
+  const size_t min_size = a_size < b_size ? a_size : b_size;
+  const int cmp = min_size > 0 ? memcmp(a, b, min_size) : 0;
+  if (cmp != 0)
+    return cmp;
+  if (a_size == b_size)
+    return 0;
+  return a_size < b_size ? -1 : 1;
+}
 
-      int64_t ttl = 0;
-      if (flags & TDB_KV_FLAG_HAS_TTL) {
-        if (remaining < sizeof(int64_t))
-          break;
-        memcpy(&ttl, ptr, sizeof(int64_t));
-        ptr += sizeof(int64_t);
-        remaining -= sizeof(int64_t);
-      }
+static double percent_of(const uint64_t part, const uint64_t whole) {
+  return whole > 0 ? (double)part * 100.0 / (double)whole : 0.0;
+}
 
-      uint64_t vlog_offset = 0;
-      if (flags & TDB_KV_FLAG_HAS_VLOG) {
-        bytes_read = decode_varint_safe(ptr, &vlog_offset, remaining);
-        if (bytes_read < 0 || (size_t)bytes_read > remaining)
-          break;
-        ptr += bytes_read;
-        remaining -= bytes_read;
-      }
+static int has_suffix(const char *name, const char *suffix) {
+  const size_t name_len = strlen(name);
+  const size_t suffix_len = strlen(suffix);
+  return name_len >= suffix_len &&
+         strcmp(name + name_len - suffix_len, suffix) == 0;
+}
 
-      if (remaining < key_size)
-        break;
-      const uint8_t *key = ptr;
-      ptr += key_size;
-      remaining -= key_size;
+static int resolve_cf_dir(const char *arg, char *out, const size_t out_size) {
+  struct stat st;
+  if (stat(arg, &st) == 0 && S_ISDIR(st.st_mode)) {
+    snprintf(out, out_size, "%s", arg);
+    return 0;
+  }
+  if (g_db != NULL) {
+    snprintf(out, out_size, "%s/%s", g_db_path, arg);
+    if (stat(out, &st) == 0 && S_ISDIR(st.st_mode))
+      return 0;
+  }
+  return -1;
+}
 
-      const uint8_t *value = NULL;
-      if (!(flags & TDB_KV_FLAG_HAS_VLOG) && value_size > 0) {
-        if (remaining < value_size)
-          break;
-        value = ptr;
-        ptr += value_size;
-        remaining -= value_size;
-      }
+typedef struct {
+  char path[4096];
+  char name[256];
+  int level;
+  uint64_t file_size;
+} cf_file_t;
 
-      total_entries++;
-      printf("%d) [blk:%d] ", total_entries, block_num);
+static int parse_level_from_name(const char *name) {
+  if (name[0] != 'L' || !isdigit((unsigned char)name[1]))
+    return 0;
+  return atoi(name + 1);
+}
 
-      if (flags & TDB_KV_FLAG_TOMBSTONE)
-        printf("[DEL] ");
-      if (flags & TDB_KV_FLAG_HAS_TTL)
-        printf("[TTL:%" PRId64 "] ", ttl);
-      if (flags & TDB_KV_FLAG_HAS_VLOG)
-        printf("[VLOG:%" PRIu64 "] ", vlog_offset);
+static int cf_file_compare(const void *a, const void *b) {
+  const cf_file_t *fa = a;
+  const cf_file_t *fb = b;
+  if (fa->level != fb->level)
+    return fa->level < fb->level ? -1 : 1;
+  return strcmp(fa->name, fb->name);
+}
 
-      printf("seq=%" PRIu64 " key=\"%.*s\"", seq, (int)key_size, (char *)key);
+static int list_cf_files(const char *cf_dir, const char *suffix,
+                         cf_file_t **files_out, int *count_out) {
+  *files_out = NULL;
+  *count_out = 0;
 
-      if (value && value_size > 0) {
-        if (value_size <= 64) {
-          printf(" value=\"%.*s\"", (int)value_size, (char *)value);
-        } else {
-          printf(" value=(%zu bytes)", (size_t)value_size);
-        }
-      } else if (flags & TDB_KV_FLAG_HAS_VLOG) {
-        printf(" value=(in vlog, %zu bytes)", (size_t)value_size);
-      }
-      printf("\n");
+  DIR *dir = opendir(cf_dir);
+  if (dir == NULL)
+    return -1;
+
+  cf_file_t *files = NULL;
+  int count = 0;
+  int capacity = 0;
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL) {
+    if (!has_suffix(entry->d_name, suffix))
+      continue;
 
-      entry_in_block++;
+    if (count == capacity) {
+      capacity = capacity ? capacity * 2 : 16;
+      cf_file_t *grown = realloc(files, (size_t)capacity * sizeof(*files));
+      if (!grown) {
+        free(files);
+        closedir(dir);
+        return -1;
+      }
+      files = grown;
     }
 
-    block_manager_block_release(block);
-    if (block_manager_cursor_next(cursor) != 0)
-      break;
-    block_num++;
+    cf_file_t *file = &files[count];
+    snprintf(file->path, sizeof(file->path), "%s/%s", cf_dir, entry->d_name);
+    snprintf(file->name, sizeof(file->name), "%s", entry->d_name);
+    file->level = parse_level_from_name(entry->d_name);
+
+    struct stat st;
+    if (stat(file->path, &st) != 0 || !S_ISREG(st.st_mode))
+      continue;
+    file->file_size = (uint64_t)st.st_size;
+    count++;
   }
+  closedir(dir);
 
-  printf("\n(%d entries dumped from %d blocks)\n", total_entries,
-         block_num + 1);
+  if (count > 1)
+    qsort(files, (size_t)count, sizeof(*files), cf_file_compare);
 
-  block_manager_cursor_free(cursor);
-  block_manager_close(bm);
+  *files_out = files;
+  *count_out = count;
   return 0;
 }
 
-static int cmd_sstable_stats(const int argc, char **argv) {
-  if (argc < 2) {
-    printf("Usage: sstable-stats <klog_path>\n");
-    return -1;
-  }
+typedef struct {
+  uint8_t *min_key;
+  size_t min_key_size;
+  uint8_t *max_key;
+  size_t max_key_size;
+  int data_blocks;
+} klog_bounds_t;
+
+static void klog_bounds_free(klog_bounds_t *bounds) {
+  free(bounds->min_key);
+  free(bounds->max_key);
+  memset(bounds, 0, sizeof(*bounds));
+}
+
+static int klog_read_bounds(const char *path, klog_bounds_t *bounds) {
+  memset(bounds, 0, sizeof(*bounds));
 
   block_manager_t *bm = NULL;
-  if (block_manager_open(&bm, argv[1], BLOCK_MANAGER_SYNC_NONE) != 0) {
-    printf("Failed to open SSTable file: %s\n", argv[1]);
+  if (block_manager_open(&bm, path, BLOCK_MANAGER_SYNC_NONE) != 0)
     return -1;
-  }
 
-  uint64_t file_size = 0;
-  block_manager_get_size(bm, &file_size);
+  bounds->data_blocks = block_manager_count_blocks(bm) - KLOG_TRAILER_BLOCKS;
+  if (bounds->data_blocks <= 0) {
+    bounds->data_blocks = 0;
+    block_manager_close(bm);
+    return 1;
+  }
 
   block_manager_cursor_t *cursor = NULL;
   if (block_manager_cursor_init(&cursor, bm) != 0) {
-    printf("Failed to create cursor\n");
     block_manager_close(bm);
     return -1;
   }
 
-  if (block_manager_cursor_goto_first(cursor) != 0) {
-    printf("(empty SSTable)\n");
-    block_manager_cursor_free(cursor);
-    block_manager_close(bm);
-    return 0;
+  int rc = -1;
+  if (block_manager_cursor_goto_first(cursor) == 0) {
+    block_manager_block_t *block = block_manager_cursor_read(cursor);
+    if (block) {
+      const uint8_t *ptr = block->data;
+      size_t remaining = block->size;
+      uint64_t prev_seq = 0;
+      klog_entry_t entry;
+      if (klog_decode_entry(&ptr, &remaining, &prev_seq, &entry) == 0) {
+        bounds->min_key = malloc(entry.key_size ? entry.key_size : 1);
+        if (bounds->min_key) {
+          memcpy(bounds->min_key, entry.key, entry.key_size);
+          bounds->min_key_size = entry.key_size;
+          rc = 0;
+        }
+      }
+      block_manager_block_release(block);
+    }
   }
 
-  uint64_t total_entries = 0;
-  uint64_t tombstone_count = 0;
-  uint64_t ttl_count = 0;
-  uint64_t vlog_count = 0;
-  uint64_t min_seq = UINT64_MAX;
-  uint64_t max_seq = 0;
-  uint64_t total_key_size = 0;
-  uint64_t total_value_size = 0;
-  uint64_t min_key_size = UINT64_MAX;
-  uint64_t max_key_size = 0;
-  uint64_t min_value_size = UINT64_MAX;
-  uint64_t max_value_size = 0;
-  int block_count = 0;
+  int positioned = rc == 0 && block_manager_cursor_goto_last(cursor) == 0;
+  for (int i = 0; positioned && i < KLOG_TRAILER_BLOCKS; i++) {
+    if (block_manager_cursor_prev(cursor) != 0)
+      positioned = 0;
+  }
 
-  while (1) {
+  rc = -1;
+  if (positioned) {
     block_manager_block_t *block = block_manager_cursor_read(cursor);
-    if (!block)
-      break;
-
-    block_count++;
-
-    if (block->size < 4) {
+    if (block) {
+      const uint8_t *ptr = block->data;
+      size_t remaining = block->size;
+      uint64_t prev_seq = 0;
+      const uint8_t *last_key = NULL;
+      uint64_t last_key_size = 0;
+      klog_entry_t entry;
+      while (klog_decode_entry(&ptr, &remaining, &prev_seq, &entry) == 0) {
+        last_key = entry.key;
+        last_key_size = entry.key_size;
+      }
+      if (last_key) {
+        bounds->max_key = malloc(last_key_size ? last_key_size : 1);
+        if (bounds->max_key) {
+          memcpy(bounds->max_key, last_key, last_key_size);
+          bounds->max_key_size = last_key_size;
+          rc = 0;
+        }
+      }
       block_manager_block_release(block);
-      if (block_manager_cursor_next(cursor) != 0)
-        break;
-      continue;
     }
+  }
 
-    const uint8_t *ptr = (const uint8_t *)block->data;
-    size_t remaining = block->size;
-    uint64_t prev_seq = 0;
+  block_manager_cursor_free(cursor);
+  block_manager_close(bm);
+  if (rc != 0)
+    klog_bounds_free(bounds);
+  return rc;
+}
 
-    while (remaining > 0) {
-      if (remaining < 1)
-        break;
+#define ADMINTOOL_MAX_THREADS 256
 
-      const uint8_t flags = *ptr++;
-      remaining--;
+typedef void (*parallel_fn)(void *ctx, int index);
 
-      uint64_t key_size, value_size, seq_value;
+typedef struct {
+  pthread_mutex_t lock;
+  int next;
+  int count;
+  parallel_fn fn;
+  void *ctx;
+} parallel_job_t;
 
-      int bytes_read = decode_varint_safe(ptr, &key_size, remaining);
-      if (bytes_read < 0 || (size_t)bytes_read > remaining)
-        break;
-      ptr += bytes_read;
-      remaining -= bytes_read;
+static int default_thread_count(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+  const long n = sysconf(_SC_NPROCESSORS_ONLN);
+  if (n > 0)
+    return n > ADMINTOOL_MAX_THREADS ? ADMINTOOL_MAX_THREADS : (int)n;
+#endif
+  return 4;
+}
 
-      bytes_read = decode_varint_safe(ptr, &value_size, remaining);
-      if (bytes_read < 0 || (size_t)bytes_read > remaining)
-        break;
-      ptr += bytes_read;
-      remaining -= bytes_read;
+static int parse_thread_count(const char *arg) {
+  const int n = atoi(arg);
+  if (n < 1)
+    return 1;
+  return n > ADMINTOOL_MAX_THREADS ? ADMINTOOL_MAX_THREADS : n;
+}
 
-      bytes_read = decode_varint_safe(ptr, &seq_value, remaining);
-      if (bytes_read < 0 || (size_t)bytes_read > remaining)
-        break;
-      ptr += bytes_read;
-      remaining -= bytes_read;
+static void *parallel_worker(void *arg) {
+  parallel_job_t *job = arg;
+  while (1) {
+    pthread_mutex_lock(&job->lock);
+    const int index = job->next < job->count ? job->next++ : -1;
+    pthread_mutex_unlock(&job->lock);
+    if (index < 0)
+      break;
+    job->fn(job->ctx, index);
+  }
+  return NULL;
+}
 
-      uint64_t seq = seq_value;
-      if (flags & TDB_KV_FLAG_DELTA_SEQ) {
-        seq = prev_seq + seq_value;
-      }
-      prev_seq = seq;
+static void run_parallel(const int count, int threads, parallel_fn fn,
+                         void *ctx) {
+  if (threads > count)
+    threads = count;
 
-      if (flags & TDB_KV_FLAG_HAS_TTL) {
-        if (remaining < sizeof(int64_t))
-          break;
-        ptr += sizeof(int64_t);
-        remaining -= sizeof(int64_t);
-        ttl_count++;
-      }
+  parallel_job_t job = {.next = 0, .count = count, .fn = fn, .ctx = ctx};
+  pthread_mutex_init(&job.lock, NULL);
 
-      if (flags & TDB_KV_FLAG_HAS_VLOG) {
-        uint64_t vlog_offset;
-        bytes_read = decode_varint_safe(ptr, &vlog_offset, remaining);
-        if (bytes_read < 0 || (size_t)bytes_read > remaining)
-          break;
-        ptr += bytes_read;
-        remaining -= bytes_read;
-        vlog_count++;
-      }
+  pthread_t workers[ADMINTOOL_MAX_THREADS];
+  int started = 0;
+  for (int i = 1; i < threads; i++) {
+    if (pthread_create(&workers[started], NULL, parallel_worker, &job) == 0)
+      started++;
+  }
+  parallel_worker(&job);
+  for (int i = 0; i < started; i++)
+    pthread_join(workers[i], NULL);
 
-      if (remaining < key_size)
-        break;
-      ptr += key_size;
-      remaining -= key_size;
+  pthread_mutex_destroy(&job.lock);
+}
 
-      if (!(flags & TDB_KV_FLAG_HAS_VLOG) && value_size > 0) {
-        if (remaining < value_size)
-          break;
-        ptr += value_size;
-        remaining -= value_size;
-      }
+#define ADMINTOOL_STREAM_BUFFER_SIZE (4 * 1024 * 1024)
+#define ADMINTOOL_HEADER_WALK_BUFFER_SIZE (128 * 1024)
+#define ADMINTOOL_VLOG_MIN_CHUNK (64ULL * 1024 * 1024)
+#define ADMINTOOL_VLOG_REPORTED_ERRORS 16
+#define ADMINTOOL_TOPK_KEY_MAX 128
+#define ADMINTOOL_TOPK_MAX 1000
+#define ADMINTOOL_SEQ_WINDOWS 32
+
+/* sequential block reader over [start, end) with a large buffer and kernel
+ * readahead hints, so a scan issues few large reads instead of two small
+ * preads per block */
+typedef struct {
+  int fd;
+  uint8_t *buf;
+  size_t cap;
+  size_t len;
+  uint64_t buf_pos;
+  uint64_t pos;
+  uint64_t end;
+  uint64_t file_size;
+  XXH3_state_t *hash; /* optional, fed with every byte read below hash_end */
+  uint64_t hashed;
+  uint64_t hash_end;
+} block_stream_t;
+
+typedef struct {
+  uint64_t offset;
+  uint32_t size;
+  uint32_t checksum;
+  const uint8_t *data;
+} stream_block_t;
+
+static int block_stream_open(block_stream_t *s, const char *path,
+                             const uint64_t start, const uint64_t end,
+                             const size_t buffer_size) {
+  memset(s, 0, sizeof(*s));
+  s->fd = open(path, O_RDONLY);
+  if (s->fd < 0)
+    return -1;
 
-      total_entries++;
-      if (flags & TDB_KV_FLAG_TOMBSTONE)
-        tombstone_count++;
+  struct stat st;
+  if (fstat(s->fd, &st) != 0) {
+    close(s->fd);
+    return -1;
+  }
+  s->file_size = (uint64_t)st.st_size;
+  s->end = end == 0 || end > s->file_size ? s->file_size : end;
+  s->pos = start;
+  s->buf_pos = start;
+  s->cap = buffer_size > 0 ? buffer_size : ADMINTOOL_STREAM_BUFFER_SIZE;
+  s->buf = malloc(s->cap);
+  if (!s->buf) {
+    close(s->fd);
+    return -1;
+  }
+#ifdef POSIX_FADV_SEQUENTIAL
+  posix_fadvise(s->fd, (off_t)start, (off_t)(s->end - start),
+                POSIX_FADV_SEQUENTIAL);
+#endif
+  return 0;
+}
 
-      if (seq < min_seq)
-        min_seq = seq;
-      if (seq > max_seq)
-        max_seq = seq;
+static int block_stream_fill(block_stream_t *s, const size_t need) {
+  const size_t consumed = (size_t)(s->pos - s->buf_pos);
+  if (consumed + need <= s->len)
+    return 0;
 
-      total_key_size += key_size;
-      total_value_size += value_size;
-      if (key_size < min_key_size)
-        min_key_size = key_size;
-      if (key_size > max_key_size)
-        max_key_size = key_size;
-      if (value_size < min_value_size)
-        min_value_size = value_size;
-      if (value_size > max_value_size)
-        max_value_size = value_size;
+  const size_t kept = s->len > consumed ? s->len - consumed : 0;
+  if (kept > 0)
+    memmove(s->buf, s->buf + consumed, kept);
+  s->buf_pos = s->pos;
+  s->len = kept;
+
+  if (need > s->cap) {
+    uint8_t *grown = realloc(s->buf, need);
+    if (!grown)
+      return -1;
+    s->buf = grown;
+    s->cap = need;
+  }
+
+  while (s->len < need) {
+    const uint64_t at = s->buf_pos + s->len;
+    if (at >= s->file_size)
+      return -1;
+    size_t want = s->cap - s->len;
+    if (want > s->file_size - at)
+      want = (size_t)(s->file_size - at);
+    const ssize_t n = pread(s->fd, s->buf + s->len, want, (off_t)at);
+    if (n <= 0)
+      return -1;
+    if (s->hash && at == s->hashed && at < s->hash_end) {
+      const uint64_t left = s->hash_end - at;
+      const size_t take = (uint64_t)n < left ? (size_t)n : (size_t)left;
+      XXH3_128bits_update(s->hash, s->buf + s->len, take);
+      s->hashed += take;
     }
-
-    block_manager_block_release(block);
-    if (block_manager_cursor_next(cursor) != 0)
-      break;
+    s->len += (size_t)n;
   }
-
-  printf("SSTable Statistics: %s\n", argv[1]);
-  printf("  File Size: %" PRIu64 " bytes (%.2f MB)\n", file_size,
-         (double)file_size / (1024 * 1024));
-  printf("  Block Count: %d\n", block_count);
-  printf("  Total Entries: %" PRIu64 "\n", total_entries);
-  printf("  Tombstones: %" PRIu64 " (%.1f%%)\n", tombstone_count,
-         total_entries > 0
-             ? (double)tombstone_count * 100.0 / (double)total_entries
-             : 0);
-  printf("  TTL Entries: %" PRIu64 "\n", ttl_count);
-  printf("  VLog References: %" PRIu64 "\n", vlog_count);
-  printf("  Sequence Range: %" PRIu64 " - %" PRIu64 "\n",
-         min_seq == UINT64_MAX ? 0 : min_seq, max_seq);
-  printf("  Key Sizes: min=%" PRIu64 " max=%" PRIu64 " avg=%.1f\n",
-         min_key_size == UINT64_MAX ? 0 : min_key_size, max_key_size,
-         total_entries > 0 ? (double)total_key_size / (double)total_entries
-                           : 0);
-  printf("  Value Sizes: min=%" PRIu64 " max=%" PRIu64 " avg=%.1f\n",
-         min_value_size == UINT64_MAX ? 0 : min_value_size, max_value_size,
-         total_entries > 0 ? (double)total_value_size / (double)total_entries
-                           : 0);
-
-  block_manager_cursor_free(cursor);
-  block_manager_close(bm);
+#ifdef POSIX_FADV_WILLNEED
+  const uint64_t ahead = s->buf_pos + s->len;
+  if (ahead < s->end)
+    posix_fadvise(s->fd, (off_t)ahead, (off_t)s->cap, POSIX_FADV_WILLNEED);
+#endif
   return 0;
 }
 
-static int cmd_sstable_keys(const int argc, char **argv) {
-  if (argc < 2) {
-    printf("Usage: sstable-keys <klog_path> [limit]\n");
+/* returns 1 with the next block, 0 at the end of the range, -1 on a
+ * truncated or implausible block; data stays valid until the next call */
+static int block_stream_next(block_stream_t *s, stream_block_t *block) {
+  if (s->pos >= s->end)
+    return 0;
+  if (block_stream_fill(s, 8) != 0)
     return -1;
-  }
 
-  int limit = ADMINTOOL_DEFAULT_DUMP_LIMIT;
-  if (argc >= 3) {
-    char *endptr;
-    const long parsed = strtol(argv[2], &endptr, 10);
-    if (*endptr == '\0' && parsed > 0) {
-      limit = (int)parsed;
-    }
-  }
+  const uint8_t *header = s->buf + (s->pos - s->buf_pos);
+  const uint32_t size = decode_uint32_le(header);
+  const uint32_t checksum = decode_uint32_le(header + 4);
+  if (size == 0 || size > 100 * 1024 * 1024 ||
+      s->pos + 16 + (uint64_t)size > s->file_size)
+    return -1;
+  if (block_stream_fill(s, 16 + (size_t)size) != 0)
+    return -1;
 
-  struct stat st;
-  if (stat(argv[1], &st) == 0 && st.st_size > ADMINTOOL_LARGE_FILE_THRESHOLD) {
-    printf("Warning: Large file (%" PRId64 " MB). Limiting to %d keys.\n",
-           (int64_t)(st.st_size / (1024 * 1024)), limit);
-  }
+  block->offset = s->pos;
+  block->size = size;
+  block->checksum = checksum;
+  block->data = s->buf + (s->pos - s->buf_pos) + 8;
+  s->pos += 16 + (uint64_t)size;
+  return 1;
+}
 
-  block_manager_t *bm = NULL;
-  if (block_manager_open(&bm, argv[1], BLOCK_MANAGER_SYNC_NONE) != 0) {
-    printf("Failed to open SSTable file: %s\n", argv[1]);
+/* reads a byte range the stream won't buffer itself into the hash */
+/* like block_stream_next but only the header is needed, so walking the
+ * block boundaries of a file takes one buffered read per many small blocks
+ * instead of one pread each; the buffer should be small, since a large
+ * block is skipped by refilling past it */
+static int block_stream_skip(block_stream_t *s, uint64_t *offset,
+                             uint32_t *size) {
+  if (s->pos >= s->end)
+    return 0;
+  if (block_stream_fill(s, 8) != 0)
     return -1;
-  }
 
-  block_manager_cursor_t *cursor = NULL;
-  if (block_manager_cursor_init(&cursor, bm) != 0) {
-    printf("Failed to create cursor\n");
-    block_manager_close(bm);
+  const uint32_t block_size =
+      decode_uint32_le(s->buf + (s->pos - s->buf_pos));
+  if (block_size == 0 || block_size > 100 * 1024 * 1024 ||
+      s->pos + 16 + (uint64_t)block_size > s->file_size)
     return -1;
+  *offset = s->pos;
+  *size = block_size;
+  s->pos += 16 + (uint64_t)block_size;
+  return 1;
+}
+
+static int block_stream_hash_range(block_stream_t *s, const uint64_t end) {
+  uint8_t buf[65536];
+  while (s->hashed < end) {
+    const uint64_t left = end - s->hashed;
+    const size_t want = left < sizeof(buf) ? (size_t)left : sizeof(buf);
+    const ssize_t n = pread(s->fd, buf, want, (off_t)s->hashed);
+    if (n <= 0)
+      return -1;
+    XXH3_128bits_update(s->hash, buf, (size_t)n);
+    s->hashed += (uint64_t)n;
   }
+  return 0;
+}
 
-  if (block_manager_cursor_goto_first(cursor) != 0) {
-    printf("(empty SSTable)\n");
-    block_manager_cursor_free(cursor);
-    block_manager_close(bm);
-    return 0;
+/* hashes the first hash_end bytes of the file as the stream reads them, so
+ * a verify pass also yields the file's XXH3-128 without reading it twice;
+ * the bytes before the stream's start are hashed here */
+static int block_stream_hash(block_stream_t *s, XXH3_state_t *state,
+                             const uint64_t hash_end) {
+  XXH3_128bits_reset(state);
+  s->hash = state;
+  s->hashed = 0;
+  s->hash_end = hash_end;
+  const uint64_t head = s->pos < hash_end ? s->pos : hash_end;
+  if (block_stream_hash_range(s, head) != 0) {
+    s->hash = NULL;
+    return -1;
   }
+  return 0;
+}
 
-  printf("SSTable Keys (limit: %d):\n", limit);
-  int total_keys = 0;
-  uint8_t *first_key = NULL;
-  size_t first_key_size = 0;
-  uint8_t *last_key = NULL;
-  size_t last_key_size = 0;
+/* hashes whatever the stream stopped short of (trailing bytes after the
+ * last block, or the rest after an error) and returns the digest */
+static int block_stream_hash_digest(block_stream_t *s, XXH128_hash_t *out) {
+  if (block_stream_hash_range(s, s->hash_end) != 0)
+    return -1;
+  *out = XXH3_128bits_digest(s->hash);
+  return 0;
+}
 
-  while (total_keys < limit) {
-    block_manager_block_t *block = block_manager_cursor_read(cursor);
-    if (!block)
-      break;
+static void block_stream_close(block_stream_t *s) {
+  free(s->buf);
+  if (s->fd >= 0)
+    close(s->fd);
+  s->buf = NULL;
+  s->fd = -1;
+}
 
-    if (block->size < 4) {
-      block_manager_block_release(block);
-      if (block_manager_cursor_next(cursor) != 0)
-        break;
-      continue;
+static int write_all(const int fd, const void *data, size_t size) {
+  const uint8_t *p = data;
+  while (size > 0) {
+    const ssize_t n = write(fd, p, size);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return -1;
     }
+    p += n;
+    size -= (size_t)n;
+  }
+  return 0;
+}
 
-    const uint8_t *ptr = (const uint8_t *)block->data;
-    size_t remaining = block->size;
-    uint64_t prev_seq = 0;
+typedef struct {
+  block_manager_t *bm;
+  block_manager_cursor_t *cursor;
+  block_manager_block_t *block;
+  const uint8_t *ptr;
+  size_t remaining;
+  uint64_t prev_seq;
+  int blocks_left;
+  int block_index;
+  klog_entry_t entry;
+} klog_iter_t;
+
+static int klog_iter_open(klog_iter_t *it, const char *path) {
+  memset(it, 0, sizeof(*it));
+  if (block_manager_open(&it->bm, path, BLOCK_MANAGER_SYNC_NONE) != 0)
+    return -1;
 
-    while (remaining > 0 && total_keys < limit) {
-      if (remaining < 1)
-        break;
+  it->blocks_left = block_manager_count_blocks(it->bm) - KLOG_TRAILER_BLOCKS;
+  if (block_manager_cursor_init(&it->cursor, it->bm) != 0) {
+    block_manager_close(it->bm);
+    it->bm = NULL;
+    return -1;
+  }
+  if (it->blocks_left <= 0 || block_manager_cursor_goto_first(it->cursor) != 0)
+    it->blocks_left = 0;
+  it->block_index = -1;
+  return 0;
+}
 
-      uint8_t flags = *ptr++;
-      remaining--;
+static int klog_iter_next(klog_iter_t *it) {
+  while (1) {
+    if (it->block &&
+        klog_decode_entry(&it->ptr, &it->remaining, &it->prev_seq,
+                          &it->entry) == 0)
+      return 1;
 
-      uint64_t key_size, value_size, seq_value;
+    if (it->block) {
+      block_manager_block_release(it->block);
+      it->block = NULL;
+      if (it->blocks_left <= 0 || block_manager_cursor_next(it->cursor) != 0) {
+        it->blocks_left = 0;
+        return 0;
+      }
+    }
+    if (it->blocks_left <= 0)
+      return 0;
 
-      int bytes_read = decode_varint_safe(ptr, &key_size, remaining);
-      if (bytes_read < 0 || (size_t)bytes_read > remaining)
-        break;
-      ptr += bytes_read;
-      remaining -= bytes_read;
+    it->block = block_manager_cursor_read(it->cursor);
+    if (!it->block)
+      return -1;
+    it->blocks_left--;
+    it->block_index++;
+    it->ptr = it->block->data;
+    it->remaining = it->block->size;
+    it->prev_seq = 0;
+  }
+}
 
-      bytes_read = decode_varint_safe(ptr, &value_size, remaining);
-      if (bytes_read < 0 || (size_t)bytes_read > remaining)
-        break;
-      ptr += bytes_read;
-      remaining -= bytes_read;
+static void klog_iter_close(klog_iter_t *it) {
+  if (it->block)
+    block_manager_block_release(it->block);
+  if (it->cursor)
+    block_manager_cursor_free(it->cursor);
+  if (it->bm)
+    block_manager_close(it->bm);
+  memset(it, 0, sizeof(*it));
+}
 
-      bytes_read = decode_varint_safe(ptr, &seq_value, remaining);
-      if (bytes_read < 0 || (size_t)bytes_read > remaining)
-        break;
-      ptr += bytes_read;
-      remaining -= bytes_read;
+static bloom_filter_t *klog_read_bloom(const char *path) {
+  block_manager_t *bm = NULL;
+  if (block_manager_open(&bm, path, BLOCK_MANAGER_SYNC_NONE) != 0)
+    return NULL;
 
-      if (flags & TDB_KV_FLAG_DELTA_SEQ) {
-        prev_seq = prev_seq + seq_value;
-      } else {
-        prev_seq = seq_value;
+  bloom_filter_t *bf = NULL;
+  block_manager_cursor_t *cursor = NULL;
+  if (block_manager_count_blocks(bm) >= KLOG_TRAILER_BLOCKS &&
+      block_manager_cursor_init(&cursor, bm) == 0) {
+    if (block_manager_cursor_goto_last(cursor) == 0 &&
+        block_manager_cursor_prev(cursor) == 0) {
+      block_manager_block_t *block = block_manager_cursor_read(cursor);
+      if (block) {
+        if (block->size > 0)
+          bf = bloom_filter_deserialize(block->data);
+        block_manager_block_release(block);
       }
+    }
+    block_manager_cursor_free(cursor);
+  }
+  block_manager_close(bm);
+  return bf;
+}
 
-      if (flags & TDB_KV_FLAG_HAS_TTL) {
-        if (remaining < sizeof(int64_t))
-          break;
-        ptr += sizeof(int64_t);
-        remaining -= sizeof(int64_t);
-      }
+static int parse_sstable_id(const char *name) {
+  const char *sep = strchr(name, '_');
+  return sep ? atoi(sep + 1) : 0;
+}
 
-      if (flags & TDB_KV_FLAG_HAS_VLOG) {
-        uint64_t vlog_offset;
-        bytes_read = decode_varint_safe(ptr, &vlog_offset, remaining);
-        if (bytes_read < 0 || (size_t)bytes_read > remaining)
-          break;
-        ptr += bytes_read;
-        remaining -= bytes_read;
-      }
+/* every klog of a column family with its key range and bloom filter, plus
+ * for each file the list of newer files whose range overlaps it */
+typedef struct {
+  cf_file_t *files;
+  int count;
+  klog_bounds_t *bounds;
+  bloom_filter_t **blooms;
+  int **newer;
+  int *newer_count;
+  int with_blooms;
+} sstable_set_t;
+
+static void sstable_set_load_worker(void *ctx, const int index) {
+  sstable_set_t *set = ctx;
+  klog_read_bounds(set->files[index].path, &set->bounds[index]);
+  if (set->with_blooms && set->bounds[index].min_key)
+    set->blooms[index] = klog_read_bloom(set->files[index].path);
+}
 
-      if (remaining < key_size)
-        break;
-      const uint8_t *key = ptr;
-      ptr += key_size;
-      remaining -= key_size;
+static int sstable_is_newer(const cf_file_t *candidate, const cf_file_t *file) {
+  if (candidate->level != file->level)
+    return candidate->level < file->level;
+  return parse_sstable_id(candidate->name) > parse_sstable_id(file->name);
+}
 
-      if (!(flags & TDB_KV_FLAG_HAS_VLOG) && value_size > 0) {
-        if (remaining < value_size)
-          break;
-        ptr += value_size;
-        remaining -= value_size;
-      }
+static int sstable_set_load(sstable_set_t *set, const char *cf_dir,
+                            const int threads, const int with_blooms) {
+  memset(set, 0, sizeof(*set));
+  if (list_cf_files(cf_dir, ".klog", &set->files, &set->count) != 0)
+    return -1;
 
-      total_keys++;
-      printf("%d) \"%.*s\"", total_keys, (int)key_size, (char *)key);
-      if (flags & TDB_KV_FLAG_TOMBSTONE)
-        printf(" [DEL]");
-      printf("\n");
+  const size_t n = (size_t)(set->count ? set->count : 1);
+  set->with_blooms = with_blooms;
+  set->bounds = calloc(n, sizeof(*set->bounds));
+  set->blooms = calloc(n, sizeof(*set->blooms));
+  set->newer = calloc(n, sizeof(*set->newer));
+  set->newer_count = calloc(n, sizeof(*set->newer_count));
+  if (!set->bounds || !set->blooms || !set->newer || !set->newer_count)
+    return -1;
 
-      if (first_key == NULL) {
-        first_key = malloc(key_size);
-        if (first_key) {
-          memcpy(first_key, key, key_size);
-          first_key_size = key_size;
-        }
-      }
+  run_parallel(set->count, threads, sstable_set_load_worker, set);
 
-      free(last_key);
-      last_key = malloc(key_size);
-      if (last_key) {
-        memcpy(last_key, key, key_size);
-        last_key_size = key_size;
-      }
+  for (int i = 0; i < set->count; i++) {
+    if (!set->bounds[i].min_key)
+      continue;
+    for (int j = 0; j < set->count; j++) {
+      if (i == j || !set->bounds[j].min_key ||
+          !sstable_is_newer(&set->files[j], &set->files[i]))
+        continue;
+      if (compare_keys(set->bounds[j].max_key, set->bounds[j].max_key_size,
+                       set->bounds[i].min_key,
+                       set->bounds[i].min_key_size) < 0 ||
+          compare_keys(set->bounds[j].min_key, set->bounds[j].min_key_size,
+                       set->bounds[i].max_key,
+                       set->bounds[i].max_key_size) > 0)
+        continue;
+      int *grown = realloc(set->newer[i],
+                           (size_t)(set->newer_count[i] + 1) * sizeof(int));
+      if (!grown)
+        return -1;
+      set->newer[i] = grown;
+      set->newer[i][set->newer_count[i]++] = j;
     }
-
-    block_manager_block_release(block);
-    if (block_manager_cursor_next(cursor) != 0)
-      break;
   }
+  return 0;
+}
 
-  printf("\n(%d keys listed)\n", total_keys);
-  if (first_key && last_key) {
-    printf("Key Range: \"%.*s\" to \"%.*s\"\n", (int)first_key_size,
-           (char *)first_key, (int)last_key_size, (char *)last_key);
+/* estimate whether a newer SSTable holds a version of key; bloom filter
+ * false positives make this an upper bound, and newer files without a
+ * bloom filter are not consulted */
+static int sstable_set_shadowed(const sstable_set_t *set, const int index,
+                                const uint8_t *key, const size_t key_size) {
+  for (int n = 0; n < set->newer_count[index]; n++) {
+    const int j = set->newer[index][n];
+    const klog_bounds_t *b = &set->bounds[j];
+    if (compare_keys(key, key_size, b->min_key, b->min_key_size) < 0 ||
+        compare_keys(key, key_size, b->max_key, b->max_key_size) > 0)
+      continue;
+    if (set->blooms[j] != NULL &&
+        bloom_filter_contains(set->blooms[j], key, key_size))
+      return 1;
   }
-
-  free(first_key);
-  free(last_key);
-  block_manager_cursor_free(cursor);
-  block_manager_close(bm);
   return 0;
 }
 
-static int cmd_bloom_stats(const int argc, char **argv) {
-  if (argc < 2) {
-    printf("Usage: bloom-stats <klog_path>\n");
-    printf("Displays bloom filter statistics from an SSTable.\n");
-    return -1;
-  }
+static void sstable_set_free(sstable_set_t *set) {
+  for (int i = 0; i < set->count; i++) {
+    if (set->bounds)
+      klog_bounds_free(&set->bounds[i]);
+    if (set->blooms && set->blooms[i])
+      bloom_filter_free(set->blooms[i]);
+    if (set->newer)
+      free(set->newer[i]);
+  }
+  free(set->bounds);
+  free(set->blooms);
+  free(set->newer);
+  free(set->newer_count);
+  free(set->files);
+  memset(set, 0, sizeof(*set));
+}
 
-  block_manager_t *bm = NULL;
-  if (block_manager_open(&bm, argv[1], BLOCK_MANAGER_SYNC_NONE) != 0) {
-    printf("Failed to open SSTable file: %s\n", argv[1]);
-    return -1;
-  }
+static void print_key_preview(const uint8_t *key, const size_t key_size,
+                              const size_t max_chars) {
+  const size_t shown = key_size < max_chars ? key_size : max_chars;
+  printf("\"%.*s\"%s", (int)shown, (const char *)key,
+         key_size > max_chars ? "..." : "");
+}
 
-  const int block_count = block_manager_count_blocks(bm);
-  if (block_count < 3) {
-    printf("SSTable has insufficient blocks (need at least 3 for "
-           "index/bloom/metadata)\n");
-    block_manager_close(bm);
-    return -1;
-  }
+/* the key bounds are decoded like any other key argument, so hex:, b64:,
+ * @file and raw: work here too */
+typedef struct {
+  arg_bytes_t prefix;
+  arg_bytes_t range_start;
+  arg_bytes_t range_end;
+  int has_prefix;
+  int has_range;
+  uint64_t seq_min;
+  uint64_t seq_max;
+  int only_deletes;
+  int only_ttl;
+  int active;
+} dump_filter_t;
+
+static void dump_filter_free(dump_filter_t *f) {
+  arg_bytes_free(&f->prefix);
+  arg_bytes_free(&f->range_start);
+  arg_bytes_free(&f->range_end);
+}
 
-  block_manager_cursor_t *cursor = NULL;
-  if (block_manager_cursor_init(&cursor, bm) != 0) {
-    printf("Failed to create cursor\n");
-    block_manager_close(bm);
-    return -1;
+/* parses filter flags and the optional numeric limit that follow the path */
+static int dump_filter_parse(const int argc, char **argv, dump_filter_t *f,
+                             int *limit) {
+  memset(f, 0, sizeof(*f));
+  f->seq_max = UINT64_MAX;
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--prefix") == 0 && i + 1 < argc) {
+      arg_bytes_free(&f->prefix);
+      if (arg_bytes_decode(argv[++i], &f->prefix) != 0) {
+        dump_filter_free(f);
+        return -1;
+      }
+      f->has_prefix = 1;
+    } else if (strcmp(argv[i], "--key-range") == 0 && i + 2 < argc) {
+      arg_bytes_free(&f->range_start);
+      arg_bytes_free(&f->range_end);
+      if (arg_bytes_decode(argv[++i], &f->range_start) != 0 ||
+          arg_bytes_decode(argv[++i], &f->range_end) != 0) {
+        dump_filter_free(f);
+        return -1;
+      }
+      f->has_range = 1;
+    } else if (strcmp(argv[i], "--seq-min") == 0 && i + 1 < argc) {
+      f->seq_min = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--seq-max") == 0 && i + 1 < argc) {
+      f->seq_max = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--only-deletes") == 0) {
+      f->only_deletes = 1;
+    } else if (strcmp(argv[i], "--only-ttl") == 0) {
+      f->only_ttl = 1;
+    } else {
+      char *endptr;
+      const long parsed = strtol(argv[i], &endptr, 10);
+      if (*endptr != '\0' || parsed <= 0) {
+        printf("Unknown option: %s\n", argv[i]);
+        dump_filter_free(f);
+        return -1;
+      }
+      *limit = (int)parsed;
+      continue;
+    }
+    f->active = 1;
   }
+  return 0;
+}
 
-  if (block_manager_cursor_goto_last(cursor) != 0) {
-    printf("Failed to seek to last block\n");
-    block_manager_cursor_free(cursor);
-    block_manager_close(bm);
-    return -1;
-  }
+static int dump_filter_has_keys(const dump_filter_t *f) {
+  return f->has_prefix || f->has_range;
+}
 
-  if (block_manager_cursor_prev(cursor) != 0) {
-    printf("Failed to seek to bloom filter block\n");
-    block_manager_cursor_free(cursor);
-    block_manager_close(bm);
-    return -1;
-  }
+/* flags and seq are checked before any key bytes are compared */
+static int dump_filter_match(const dump_filter_t *f, const klog_entry_t *e) {
+  if (f->only_deletes && !(e->flags & TDB_KV_FLAG_TOMBSTONE))
+    return 0;
+  if (f->only_ttl && !(e->flags & TDB_KV_FLAG_HAS_TTL))
+    return 0;
+  if (e->seq < f->seq_min || e->seq > f->seq_max)
+    return 0;
+  if (e->key == NULL && dump_filter_has_keys(f))
+    return 0;
+  if (f->has_prefix &&
+      (e->key_size < f->prefix.size ||
+       memcmp(e->key, f->prefix.data, f->prefix.size) != 0))
+    return 0;
+  if (f->has_range &&
+      (compare_keys(e->key, (size_t)e->key_size, f->range_start.data,
+                    f->range_start.size) < 0 ||
+       compare_keys(e->key, (size_t)e->key_size, f->range_end.data,
+                    f->range_end.size) > 0))
+    return 0;
+  return 1;
+}
 
-  block_manager_block_t *bloom_block = block_manager_cursor_read(cursor);
-  if (!bloom_block) {
-    printf("Failed to read bloom filter block\n");
-    block_manager_cursor_free(cursor);
-    block_manager_close(bm);
-    return -1;
+/* in a sorted klog, nothing at or after this key can match */
+static int dump_filter_past_end(const dump_filter_t *f, const uint8_t *key,
+                                const size_t key_size) {
+  if (f->has_range && compare_keys(key, key_size, f->range_end.data,
+                                   f->range_end.size) > 0)
+    return 1;
+  if (f->has_prefix) {
+    const size_t n = key_size < f->prefix.size ? key_size : f->prefix.size;
+    return compare_keys(key, n, f->prefix.data, f->prefix.size) > 0;
   }
+  return 0;
+}
 
-  if (bloom_block->size == 0) {
-    printf("Bloom Filter: disabled (empty block)\n");
-    block_manager_block_release(bloom_block);
-    block_manager_cursor_free(cursor);
-    block_manager_close(bm);
+/* a block can be skipped when the next block starts at or before the
+ * lowest key that can match */
+static int dump_filter_before_start(const dump_filter_t *f,
+                                    const uint8_t *key,
+                                    const size_t key_size) {
+  if (f->has_prefix &&
+      compare_keys(key, key_size, f->prefix.data, f->prefix.size) > 0)
     return 0;
-  }
+  if (f->has_range && compare_keys(key, key_size, f->range_start.data,
+                                   f->range_start.size) > 0)
+    return 0;
+  return 1;
+}
 
-  bloom_filter_t *bf = bloom_filter_deserialize(bloom_block->data);
-  if (!bf) {
-    printf(
-        "Failed to deserialize bloom filter (may be disabled or corrupted)\n");
-    block_manager_block_release(bloom_block);
-    block_manager_cursor_free(cursor);
-    block_manager_close(bm);
+/* decodes only the first entry of the block at pos, reading a small
+ * prefix of it first */
+static int klog_probe_first_key(const int fd, const uint64_t pos,
+                                strbuf_t *key) {
+  uint8_t header[8];
+  if (pread(fd, header, 8, (off_t)pos) != 8)
+    return -1;
+  const uint32_t block_size = decode_uint32_le(header);
+  if (block_size == 0 || block_size > 100 * 1024 * 1024)
     return -1;
-  }
 
-  uint64_t bits_set = 0;
-  for (unsigned int i = 0; i < bf->size_in_words; i++) {
-    uint64_t word = bf->bitset[i];
-    while (word) {
-      bits_set += word & 1;
-      word >>= 1;
+  size_t want = block_size < 4096 ? block_size : 4096;
+  while (1) {
+    uint8_t *data = malloc(want);
+    if (!data)
+      return -1;
+    if (pread(fd, data, want, (off_t)(pos + 8)) != (ssize_t)want) {
+      free(data);
+      return -1;
+    }
+    const uint8_t *ptr = data;
+    size_t remaining = want;
+    uint64_t prev_seq = 0;
+    klog_entry_t entry;
+    const int rc = klog_decode_entry(&ptr, &remaining, &prev_seq, &entry);
+    if (rc == 0) {
+      key->len = 0;
+      const int ok = strbuf_append(key, (const char *)entry.key,
+                                   (size_t)entry.key_size);
+      free(data);
+      return ok;
     }
+    free(data);
+    if (want == block_size)
+      return -1;
+    want = block_size;
   }
+}
 
-  const double fill_ratio = (double)bits_set / (double)bf->m;
-  const double estimated_fpr = pow(fill_ratio, (double)bf->h);
+static int cmd_sstable_dump(const int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: sstable-dump <klog_path> [limit] [--prefix P] "
+           "[--key-range A B]\n");
+    printf("       [--seq-min N] [--seq-max N] [--only-deletes] "
+           "[--only-ttl]\n");
+    return -1;
+  }
 
-  printf("Bloom Filter Statistics: %s\n", argv[1]);
-  printf("  Serialized Size: %" PRIu64 " bytes\n", bloom_block->size);
-  printf("  Filter Size (m): %u bits (%.2f KB)\n", bf->m,
-         (double)bf->m / 8.0 / 1024.0);
-  printf("  Hash Functions (k): %u\n", bf->h);
-  printf("  Storage Words: %u (uint64_t)\n", bf->size_in_words);
-  printf("  Bits Set: %" PRIu64 "\n", bits_set);
-  printf("  Fill Ratio: %.2f%%\n", fill_ratio * 100.0);
-  printf("  Estimated FPR: %.6f (%.4f%%)\n", estimated_fpr,
-         estimated_fpr * 100.0);
+  int limit = ADMINTOOL_DEFAULT_DUMP_LIMIT;
+  dump_filter_t filter;
+  if (dump_filter_parse(argc, argv, &filter, &limit) != 0)
+    return -1;
 
-  if (fill_ratio > 0.5) {
-    printf("  Warning: High fill ratio may increase false positives\n");
+  struct stat st;
+  if (stat(argv[1], &st) == 0 && st.st_size > ADMINTOOL_LARGE_FILE_THRESHOLD) {
+    printf("Warning: Large file (%" PRId64 " MB). ",
+           (int64_t)(st.st_size / (1024 * 1024)));
+    printf("Limiting to %d entries. Use explicit limit to override.\n", limit);
   }
 
-  bloom_filter_free(bf);
-  block_manager_block_release(bloom_block);
-  block_manager_cursor_free(cursor);
-  block_manager_close(bm);
-  return 0;
-}
-
-static int cmd_sstable_checksum(const int argc, char **argv) {
-  if (argc < 2) {
-    printf("Usage: sstable-checksum <klog_path>\n");
-    printf("Verifies all block checksums and reports any corruption.\n");
-    return -1;
+  /* filters only look at data blocks; the trailer is not entries */
+  int data_blocks = -1;
+  if (filter.active) {
+    block_manager_t *bm = NULL;
+    if (block_manager_open(&bm, argv[1], BLOCK_MANAGER_SYNC_NONE) != 0) {
+      printf("Failed to open SSTable file: %s\n", argv[1]);
+      dump_filter_free(&filter);
+      return -1;
+    }
+    data_blocks = block_manager_count_blocks(bm) - KLOG_TRAILER_BLOCKS;
+    block_manager_close(bm);
   }
 
   const int fd = open(argv[1], O_RDONLY);
-  if (fd < 0) {
-    printf("Failed to open file: %s\n", argv[1]);
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    printf("Failed to open SSTable file: %s\n", argv[1]);
+    if (fd >= 0)
+      close(fd);
+    dump_filter_free(&filter);
     return -1;
   }
 
-  struct stat st;
-  if (fstat(fd, &st) != 0) {
-    printf("Failed to stat file\n");
+  if ((uint64_t)st.st_size <= 8) {
+    printf("(empty SSTable)\n");
     close(fd);
-    return -1;
+    dump_filter_free(&filter);
+    return 0;
   }
 
-  printf("Verifying checksums: %s\n", argv[1]);
-  printf("  File Size: %ld bytes\n\n", (long)st.st_size);
-
-  uint64_t pos = 8;
+  printf("SSTable Entries (limit: %d):\n", limit);
+  int total_entries = 0;
   int block_num = 0;
-  int valid_blocks = 0;
-  int invalid_blocks = 0;
+  uint64_t scanned = 0;
+  int skipped_blocks = 0;
+  int done = 0;
+  uint64_t pos = 8;
+  strbuf_t next_key = {0};
 
-  while (pos < (uint64_t)st.st_size) {
+  while (!done && total_entries < limit && pos + 8 <= (uint64_t)st.st_size &&
+         (data_blocks < 0 || block_num < data_blocks)) {
     uint8_t header[8];
-    ssize_t nread = pread(fd, header, 8, (off_t)pos);
-    if (nread != 8)
+    if (pread(fd, header, 8, (off_t)pos) != 8)
       break;
-
     const uint32_t block_size = decode_uint32_le(header);
-    const uint32_t stored_checksum = decode_uint32_le(header + 4);
-
-    if (block_size == 0 || block_size > 100 * 1024 * 1024) {
-      printf("  Block %d @ offset %" PRIu64 ": INVALID SIZE (%u)\n", block_num,
-             pos, block_size);
-      invalid_blocks++;
+    if (block_size == 0 || block_size > 100 * 1024 * 1024)
       break;
+    const uint64_t next_pos = pos + 16 + (uint64_t)block_size;
+
+    if (dump_filter_has_keys(&filter) && block_num + 1 < data_blocks &&
+        klog_probe_first_key(fd, next_pos, &next_key) == 0 &&
+        dump_filter_before_start(&filter, (const uint8_t *)next_key.data,
+                                 next_key.len)) {
+      skipped_blocks++;
+      block_num++;
+      pos = next_pos;
+      continue;
     }
 
-    uint8_t *data = malloc(block_size);
-    if (!data) {
-      printf("  Block %d: OUT OF MEMORY\n", block_num);
-      break;
+    if (block_size < 4) {
+      block_num++;
+      pos = next_pos;
+      continue;
     }
 
-    nread = pread(fd, data, block_size, (off_t)(pos + 8));
-    if (nread != (ssize_t)block_size) {
-      printf("  Block %d @ offset %" PRIu64
-             ": READ ERROR (expected %u, got %zd)\n",
-             block_num, pos, block_size, nread);
+    uint8_t *data = malloc(block_size);
+    if (!data)
+      break;
+    if (pread(fd, data, block_size, (off_t)(pos + 8)) !=
+        (ssize_t)block_size) {
       free(data);
-      invalid_blocks++;
       break;
     }
 
-    const uint32_t computed_checksum = compute_block_checksum(data, block_size);
+    const uint8_t *ptr = data;
+    size_t remaining = block_size;
+    uint64_t prev_seq = 0;
+    klog_entry_t entry;
+
+    while (remaining > 0 && total_entries < limit &&
+           klog_decode_entry(&ptr, &remaining, &prev_seq, &entry) == 0) {
+      scanned++;
+      if (filter.active && !dump_filter_match(&filter, &entry)) {
+        if (dump_filter_has_keys(&filter) &&
+            dump_filter_past_end(&filter, entry.key, (size_t)entry.key_size)) {
+          done = 1;
+          break;
+        }
+        continue;
+      }
 
-    if (computed_checksum != stored_checksum) {
-      printf("  Block %d @ offset %" PRIu64 ": CHECKSUM MISMATCH\n", block_num,
-             pos);
-      printf("    Size: %u bytes\n", block_size);
-      printf("    Stored:   0x%08X\n", stored_checksum);
-      printf("    Computed: 0x%08X\n", computed_checksum);
-      invalid_blocks++;
-    } else {
-      valid_blocks++;
+      total_entries++;
+      printf("%d) [blk:%d] ", total_entries, block_num);
+
+      if (entry.flags & TDB_KV_FLAG_TOMBSTONE)
+        printf("[DEL] ");
+      if (entry.flags & TDB_KV_FLAG_HAS_TTL)
+        printf("[TTL:%" PRId64 "] ", entry.ttl);
+      if (entry.flags & TDB_KV_FLAG_HAS_VLOG)
+        printf("[VLOG:%" PRIu64 "] ", entry.vlog_offset);
+
+      printf("seq=%" PRIu64 " key=\"%.*s\"", entry.seq, (int)entry.key_size,
+             (const char *)entry.key);
+
+      if (entry.value && entry.value_size > 0) {
+        if (entry.value_size <= 64) {
+          printf(" value=\"%.*s\"", (int)entry.value_size,
+                 (const char *)entry.value);
+        } else {
+          printf(" value=(%zu bytes)", (size_t)entry.value_size);
+        }
+      } else if (entry.flags & TDB_KV_FLAG_HAS_VLOG) {
+        printf(" value=(in vlog, %zu bytes)", (size_t)entry.value_size);
+      }
+      printf("\n");
     }
 
     free(data);
-
-    pos += 8 + block_size + 8;
+    if (done || next_pos + 8 > (uint64_t)st.st_size)
+      break;
+    pos = next_pos;
     block_num++;
   }
 
-  printf("\nChecksum Verification Results:\n");
-  printf("  Total Blocks: %d\n", block_num);
-  printf("  Valid: %d\n", valid_blocks);
-  printf("  Invalid: %d\n", invalid_blocks);
-  printf("  Status: %s\n", invalid_blocks == 0 ? "OK" : "CORRUPTED");
+  if (data_blocks >= 0 && block_num >= data_blocks)
+    block_num = data_blocks - 1;
+  printf("\n(%d entries dumped from %d blocks)\n", total_entries,
+         block_num + 1);
+  if (filter.active)
+    printf("(%" PRIu64 " entries examined, %d blocks skipped by key)\n",
+           scanned, skipped_blocks);
 
+  strbuf_free(&next_key);
   close(fd);
-  return invalid_blocks > 0 ? -1 : 0;
+  dump_filter_free(&filter);
+  return 0;
 }
 
-static int read_vlog_value(const char *vlog_path, uint64_t vlog_offset,
-                           size_t value_size, uint8_t **value_out) {
-  const int fd = open(vlog_path, O_RDONLY);
-  if (fd < 0)
-    return -1;
-
-  uint8_t header[8];
-  ssize_t nread = pread(fd, header, 8, (off_t)vlog_offset);
-  if (nread != 8) {
-    close(fd);
+static int cmd_sstable_stats(const int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: sstable-stats <klog_path>\n");
     return -1;
   }
 
-  const uint32_t block_size = decode_uint32_le(header);
-  const uint32_t stored_checksum = decode_uint32_le(header + 4);
-
-  if (block_size == 0 || block_size > 100 * 1024 * 1024) {
-    close(fd);
+  block_manager_t *bm = NULL;
+  if (block_manager_open(&bm, argv[1], BLOCK_MANAGER_SYNC_NONE) != 0) {
+    printf("Failed to open SSTable file: %s\n", argv[1]);
     return -1;
   }
 
-  uint8_t *data = malloc(block_size);
-  if (!data) {
-    close(fd);
-    return -1;
-  }
+  uint64_t file_size = 0;
+  block_manager_get_size(bm, &file_size);
 
-  nread = pread(fd, data, block_size, (off_t)(vlog_offset + 8));
-  if (nread != (ssize_t)block_size) {
-    free(data);
-    close(fd);
+  block_manager_cursor_t *cursor = NULL;
+  if (block_manager_cursor_init(&cursor, bm) != 0) {
+    printf("Failed to create cursor\n");
+    block_manager_close(bm);
     return -1;
   }
 
-  uint32_t computed = compute_block_checksum(data, block_size);
-  if (computed != stored_checksum) {
-    free(data);
-    close(fd);
-    return -2;
+  if (block_manager_cursor_goto_first(cursor) != 0) {
+    printf("(empty SSTable)\n");
+    block_manager_cursor_free(cursor);
+    block_manager_close(bm);
+    return 0;
   }
 
-  *value_out = data;
-  close(fd);
-  return (int)block_size;
-}
+  uint64_t total_entries = 0;
+  uint64_t tombstone_count = 0;
+  uint64_t ttl_count = 0;
+  uint64_t vlog_count = 0;
+  uint64_t min_seq = UINT64_MAX;
+  uint64_t max_seq = 0;
+  uint64_t total_key_size = 0;
+  uint64_t total_value_size = 0;
+  uint64_t min_key_size = UINT64_MAX;
+  uint64_t max_key_size = 0;
+  uint64_t min_value_size = UINT64_MAX;
+  uint64_t max_value_size = 0;
+  int block_count = 0;
+  const uint64_t file_start = trace_now();
 
-static int cmd_sstable_dump_full(const int argc, char **argv) {
-  if (argc < 2) {
-    printf("Usage: sstable-dump-full <klog_path> [vlog_path] [limit]\n");
-    printf(
-        "Dumps SSTable entries with vlog value retrieval and checksum info.\n");
-    return -1;
-  }
+  while (1) {
+    const uint64_t block_start = trace_now();
+    block_manager_block_t *block = block_manager_cursor_read(cursor);
+    if (!block)
+      break;
 
-  const char *klog_path = argv[1];
-  const char *vlog_path = NULL;
-  int limit = ADMINTOOL_DEFAULT_DUMP_LIMIT;
+    block_count++;
 
-  if (argc >= 3) {
-    struct stat st;
-    if (stat(argv[2], &st) == 0 && S_ISREG(st.st_mode)) {
-      vlog_path = argv[2];
-      if (argc >= 4) {
-        char *endptr;
-        long parsed = strtol(argv[3], &endptr, 10);
-        if (*endptr == '\0' && parsed > 0)
-          limit = (int)parsed;
-      }
-    } else {
-      char *endptr;
-      long parsed = strtol(argv[2], &endptr, 10);
-      if (*endptr == '\0' && parsed > 0)
-        limit = (int)parsed;
-    }
-  }
-
-  int fd = open(klog_path, O_RDONLY);
-  if (fd < 0) {
-    printf("Failed to open klog: %s\n", klog_path);
-    return -1;
-  }
-
-  struct stat st;
-  fstat(fd, &st);
-
-  printf("SSTable Full Dump (limit: %d):\n", limit);
-  printf("  KLog: %s\n", klog_path);
-  if (vlog_path)
-    printf("  VLog: %s\n", vlog_path);
-  printf("\n");
-
-  uint64_t pos = 8;
-  int total_entries = 0;
-  int block_num = 0;
-  int checksum_errors = 0;
-
-  while (total_entries < limit && pos < (uint64_t)st.st_size) {
-    uint8_t header[8];
-    ssize_t nread = pread(fd, header, 8, (off_t)pos);
-    if (nread != 8)
-      break;
-
-    uint32_t block_size = decode_uint32_le(header);
-    uint32_t stored_checksum = decode_uint32_le(header + 4);
-
-    if (block_size == 0 || block_size > 100 * 1024 * 1024)
-      break;
-
-    uint8_t *block_data = malloc(block_size);
-    if (!block_data)
-      break;
-
-    nread = pread(fd, block_data, block_size, (off_t)(pos + 8));
-    if (nread != (ssize_t)block_size) {
-      free(block_data);
-      break;
+    if (block->size < 4) {
+      block_manager_block_release(block);
+      if (block_manager_cursor_next(cursor) != 0)
+        break;
+      continue;
     }
 
-    uint32_t computed_checksum = compute_block_checksum(block_data, block_size);
-    int checksum_ok = (computed_checksum == stored_checksum);
-    if (!checksum_ok)
-      checksum_errors++;
-
-    const uint8_t *ptr = block_data;
-    size_t remaining = block_size;
+    const uint8_t *ptr = (const uint8_t *)block->data;
+    size_t remaining = block->size;
     uint64_t prev_seq = 0;
 
-    while (remaining > 0 && total_entries < limit) {
+    while (remaining > 0) {
       if (remaining < 1)
         break;
 
-      uint8_t flags = *ptr++;
+      const uint8_t flags = *ptr++;
       remaining--;
 
       uint64_t key_size, value_size, seq_value;
-      int bytes_read;
 
-      bytes_read = decode_varint_safe(ptr, &key_size, remaining);
+      int bytes_read = decode_varint_safe(ptr, &key_size, remaining);
       if (bytes_read < 0 || (size_t)bytes_read > remaining)
         break;
       ptr += bytes_read;
@@ -1962,545 +3237,6976 @@ static int cmd_sstable_dump_full(const int argc, char **argv) {
       remaining -= bytes_read;
 
       uint64_t seq = seq_value;
-      if (flags & TDB_KV_FLAG_DELTA_SEQ)
+      if (flags & TDB_KV_FLAG_DELTA_SEQ) {
         seq = prev_seq + seq_value;
+      }
       prev_seq = seq;
 
-      int64_t ttl = 0;
       if (flags & TDB_KV_FLAG_HAS_TTL) {
         if (remaining < sizeof(int64_t))
           break;
-        memcpy(&ttl, ptr, sizeof(int64_t));
         ptr += sizeof(int64_t);
         remaining -= sizeof(int64_t);
+        ttl_count++;
       }
 
-      uint64_t vlog_offset = 0;
       if (flags & TDB_KV_FLAG_HAS_VLOG) {
+        uint64_t vlog_offset;
         bytes_read = decode_varint_safe(ptr, &vlog_offset, remaining);
         if (bytes_read < 0 || (size_t)bytes_read > remaining)
           break;
         ptr += bytes_read;
         remaining -= bytes_read;
+        vlog_count++;
       }
 
       if (remaining < key_size)
         break;
-      const uint8_t *key = ptr;
       ptr += key_size;
       remaining -= key_size;
 
-      const uint8_t *value = NULL;
-      uint8_t *vlog_value = NULL;
-      int vlog_status = 0;
-
-      if (flags & TDB_KV_FLAG_HAS_VLOG) {
-        if (vlog_path && value_size > 0) {
-          vlog_status =
-              read_vlog_value(vlog_path, vlog_offset, value_size, &vlog_value);
-          if (vlog_status > 0)
-            value = vlog_value;
-        }
-      } else if (value_size > 0) {
+      if (!(flags & TDB_KV_FLAG_HAS_VLOG) && value_size > 0) {
         if (remaining < value_size)
           break;
-        value = ptr;
         ptr += value_size;
         remaining -= value_size;
       }
 
       total_entries++;
-      printf("%d) [blk:%d", total_entries, block_num);
-      if (!checksum_ok)
-        printf(" CHECKSUM_ERR");
-      printf("] ");
-
       if (flags & TDB_KV_FLAG_TOMBSTONE)
-        printf("[DEL] ");
-      if (flags & TDB_KV_FLAG_HAS_TTL)
-        printf("[TTL:%" PRId64 "] ", ttl);
-      if (flags & TDB_KV_FLAG_HAS_VLOG) {
-        printf("[VLOG:%" PRIu64, vlog_offset);
-        if (vlog_status == -2)
-          printf(" CHECKSUM_ERR");
-        else if (vlog_status < 0 && vlog_path)
-          printf(" READ_ERR");
-        else if (!vlog_path)
-          printf(" NO_VLOG_FILE");
-        printf("] ");
-      }
-
-      printf("seq=%" PRIu64 " key=\"%.*s\"", seq, (int)key_size, (char *)key);
+        tombstone_count++;
 
-      if (value && value_size > 0) {
-        if (value_size <= 64)
-          printf(" value=\"%.*s\"", (int)value_size, (char *)value);
-        else
-          printf(" value=(%zu bytes)", (size_t)value_size);
-      } else if ((flags & TDB_KV_FLAG_HAS_VLOG) && !vlog_value) {
-        printf(" value=(vlog, %zu bytes, not retrieved)", (size_t)value_size);
-      }
-      printf("\n");
+      if (seq < min_seq)
+        min_seq = seq;
+      if (seq > max_seq)
+        max_seq = seq;
 
-      free(vlog_value);
+      total_key_size += key_size;
+      total_value_size += value_size;
+      if (key_size < min_key_size)
+        min_key_size = key_size;
+      if (key_size > max_key_size)
+        max_key_size = key_size;
+      if (value_size < min_value_size)
+        min_value_size = value_size;
+      if (value_size > max_value_size)
+        max_value_size = value_size;
     }
 
-    free(block_data);
-    pos += 8 + block_size + 8;
-    block_num++;
+    trace_span("stats", "block", block_start, "block=%d size=%" PRIu64,
+               block_count - 1, block->size);
+    block_manager_block_release(block);
+    if (block_manager_cursor_next(cursor) != 0)
+      break;
   }
 
-  printf("\n(%d entries from %d blocks", total_entries, block_num);
-  if (checksum_errors > 0)
-    printf(", %d checksum errors", checksum_errors);
-  printf(")\n");
+  trace_span("stats", argv[1], file_start,
+             "blocks=%d entries=%" PRIu64, block_count, total_entries);
 
-  close(fd);
-  return checksum_errors > 0 ? -1 : 0;
+  printf("SSTable Statistics: %s\n", argv[1]);
+  printf("  File Size: %" PRIu64 " bytes (%.2f MB)\n", file_size,
+         (double)file_size / (1024 * 1024));
+  printf("  Block Count: %d\n", block_count);
+  printf("  Total Entries: %" PRIu64 "\n", total_entries);
+  printf("  Tombstones: %" PRIu64 " (%.1f%%)\n", tombstone_count,
+         total_entries > 0
+             ? (double)tombstone_count * 100.0 / (double)total_entries
+             : 0);
+  printf("  TTL Entries: %" PRIu64 "\n", ttl_count);
+  printf("  VLog References: %" PRIu64 "\n", vlog_count);
+  printf("  Sequence Range: %" PRIu64 " - %" PRIu64 "\n",
+         min_seq == UINT64_MAX ? 0 : min_seq, max_seq);
+  printf("  Key Sizes: min=%" PRIu64 " max=%" PRIu64 " avg=%.1f\n",
+         min_key_size == UINT64_MAX ? 0 : min_key_size, max_key_size,
+         total_entries > 0 ? (double)total_key_size / (double)total_entries
+                           : 0);
+  printf("  Value Sizes: min=%" PRIu64 " max=%" PRIu64 " avg=%.1f\n",
+         min_value_size == UINT64_MAX ? 0 : min_value_size, max_value_size,
+         total_entries > 0 ? (double)total_value_size / (double)total_entries
+                           : 0);
+
+  block_manager_cursor_free(cursor);
+  block_manager_close(bm);
+  return 0;
 }
 
-static int cmd_wal_list(const int argc, char **argv) {
+static int cmd_sstable_keys(const int argc, char **argv) {
   if (argc < 2) {
-    printf("Usage: wal-list <cf>\n");
+    printf("Usage: sstable-keys <klog_path> [limit]\n");
     return -1;
   }
 
-  if (g_db == NULL) {
-    printf("No database is open.\n");
+  int limit = ADMINTOOL_DEFAULT_DUMP_LIMIT;
+  if (argc >= 3) {
+    char *endptr;
+    const long parsed = strtol(argv[2], &endptr, 10);
+    if (*endptr == '\0' && parsed > 0) {
+      limit = (int)parsed;
+    }
+  }
+
+  struct stat st;
+  if (stat(argv[1], &st) == 0 && st.st_size > ADMINTOOL_LARGE_FILE_THRESHOLD) {
+    printf("Warning: Large file (%" PRId64 " MB). Limiting to %d keys.\n",
+           (int64_t)(st.st_size / (1024 * 1024)), limit);
+  }
+
+  block_manager_t *bm = NULL;
+  if (block_manager_open(&bm, argv[1], BLOCK_MANAGER_SYNC_NONE) != 0) {
+    printf("Failed to open SSTable file: %s\n", argv[1]);
     return -1;
   }
 
-  const tidesdb_column_family_t *cf = tidesdb_get_column_family(g_db, argv[1]);
-  if (cf == NULL) {
-    printf("Column family '%s' not found.\n", argv[1]);
+  block_manager_cursor_t *cursor = NULL;
+  if (block_manager_cursor_init(&cursor, bm) != 0) {
+    printf("Failed to create cursor\n");
+    block_manager_close(bm);
     return -1;
   }
 
-  char cf_path[2048];
-  snprintf(cf_path, sizeof(cf_path), "%s/%s", g_db_path, argv[1]);
+  if (block_manager_cursor_goto_first(cursor) != 0) {
+    printf("(empty SSTable)\n");
+    block_manager_cursor_free(cursor);
+    block_manager_close(bm);
+    return 0;
+  }
 
-  DIR *dir = opendir(cf_path);
-  if (dir == NULL) {
-    printf("Cannot open column family directory: %s\n", strerror(errno));
-    return -1;
+  printf("SSTable Keys (limit: %d):\n", limit);
+  int total_keys = 0;
+  uint8_t *first_key = NULL;
+  size_t first_key_size = 0;
+  uint8_t *last_key = NULL;
+  size_t last_key_size = 0;
+
+  while (total_keys < limit) {
+    block_manager_block_t *block = block_manager_cursor_read(cursor);
+    if (!block)
+      break;
+
+    if (block->size < 4) {
+      block_manager_block_release(block);
+      if (block_manager_cursor_next(cursor) != 0)
+        break;
+      continue;
+    }
+
+    const uint8_t *ptr = (const uint8_t *)block->data;
+    size_t remaining = block->size;
+    uint64_t prev_seq = 0;
+
+    while (remaining > 0 && total_keys < limit) {
+      if (remaining < 1)
+        break;
+
+      uint8_t flags = *ptr++;
+      remaining--;
+
+      uint64_t key_size, value_size, seq_value;
+
+      int bytes_read = decode_varint_safe(ptr, &key_size, remaining);
+      if (bytes_read < 0 || (size_t)bytes_read > remaining)
+        break;
+      ptr += bytes_read;
+      remaining -= bytes_read;
+
+      bytes_read = decode_varint_safe(ptr, &value_size, remaining);
+      if (bytes_read < 0 || (size_t)bytes_read > remaining)
+        break;
+      ptr += bytes_read;
+      remaining -= bytes_read;
+
+      bytes_read = decode_varint_safe(ptr, &seq_value, remaining);
+      if (bytes_read < 0 || (size_t)bytes_read > remaining)
+        break;
+      ptr += bytes_read;
+      remaining -= bytes_read;
+
+      if (flags & TDB_KV_FLAG_DELTA_SEQ) {
+        prev_seq = prev_seq + seq_value;
+      } else {
+        prev_seq = seq_value;
+      }
+
+      if (flags & TDB_KV_FLAG_HAS_TTL) {
+        if (remaining < sizeof(int64_t))
+          break;
+        ptr += sizeof(int64_t);
+        remaining -= sizeof(int64_t);
+      }
+
+      if (flags & TDB_KV_FLAG_HAS_VLOG) {
+        uint64_t vlog_offset;
+        bytes_read = decode_varint_safe(ptr, &vlog_offset, remaining);
+        if (bytes_read < 0 || (size_t)bytes_read > remaining)
+          break;
+        ptr += bytes_read;
+        remaining -= bytes_read;
+      }
+
+      if (remaining < key_size)
+        break;
+      const uint8_t *key = ptr;
+      ptr += key_size;
+      remaining -= key_size;
+
+      if (!(flags & TDB_KV_FLAG_HAS_VLOG) && value_size > 0) {
+        if (remaining < value_size)
+          break;
+        ptr += value_size;
+        remaining -= value_size;
+      }
+
+      total_keys++;
+      printf("%d) \"%.*s\"", total_keys, (int)key_size, (char *)key);
+      if (flags & TDB_KV_FLAG_TOMBSTONE)
+        printf(" [DEL]");
+      printf("\n");
+
+      if (first_key == NULL) {
+        first_key = malloc(key_size);
+        if (first_key) {
+          memcpy(first_key, key, key_size);
+          first_key_size = key_size;
+        }
+      }
+
+      free(last_key);
+      last_key = malloc(key_size);
+      if (last_key) {
+        memcpy(last_key, key, key_size);
+        last_key_size = key_size;
+      }
+    }
+
+    block_manager_block_release(block);
+    if (block_manager_cursor_next(cursor) != 0)
+      break;
+  }
+
+  printf("\n(%d keys listed)\n", total_keys);
+  if (first_key && last_key) {
+    printf("Key Range: \"%.*s\" to \"%.*s\"\n", (int)first_key_size,
+           (char *)first_key, (int)last_key_size, (char *)last_key);
+  }
+
+  free(first_key);
+  free(last_key);
+  block_manager_cursor_free(cursor);
+  block_manager_close(bm);
+  return 0;
+}
+
+static int cmd_bloom_stats(const int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: bloom-stats <klog_path>\n");
+    printf("Displays bloom filter statistics from an SSTable.\n");
+    return -1;
+  }
+
+  block_manager_t *bm = NULL;
+  if (block_manager_open(&bm, argv[1], BLOCK_MANAGER_SYNC_NONE) != 0) {
+    printf("Failed to open SSTable file: %s\n", argv[1]);
+    return -1;
+  }
+
+  const int block_count = block_manager_count_blocks(bm);
+  if (block_count < 3) {
+    printf("SSTable has insufficient blocks (need at least 3 for "
+           "index/bloom/metadata)\n");
+    block_manager_close(bm);
+    return -1;
+  }
+
+  block_manager_cursor_t *cursor = NULL;
+  if (block_manager_cursor_init(&cursor, bm) != 0) {
+    printf("Failed to create cursor\n");
+    block_manager_close(bm);
+    return -1;
+  }
+
+  if (block_manager_cursor_goto_last(cursor) != 0) {
+    printf("Failed to seek to last block\n");
+    block_manager_cursor_free(cursor);
+    block_manager_close(bm);
+    return -1;
+  }
+
+  if (block_manager_cursor_prev(cursor) != 0) {
+    printf("Failed to seek to bloom filter block\n");
+    block_manager_cursor_free(cursor);
+    block_manager_close(bm);
+    return -1;
+  }
+
+  block_manager_block_t *bloom_block = block_manager_cursor_read(cursor);
+  if (!bloom_block) {
+    printf("Failed to read bloom filter block\n");
+    block_manager_cursor_free(cursor);
+    block_manager_close(bm);
+    return -1;
+  }
+
+  if (bloom_block->size == 0) {
+    printf("Bloom Filter: disabled (empty block)\n");
+    block_manager_block_release(bloom_block);
+    block_manager_cursor_free(cursor);
+    block_manager_close(bm);
+    return 0;
+  }
+
+  bloom_filter_t *bf = bloom_filter_deserialize(bloom_block->data);
+  if (!bf) {
+    printf(
+        "Failed to deserialize bloom filter (may be disabled or corrupted)\n");
+    block_manager_block_release(bloom_block);
+    block_manager_cursor_free(cursor);
+    block_manager_close(bm);
+    return -1;
+  }
+
+  uint64_t bits_set = 0;
+  for (unsigned int i = 0; i < bf->size_in_words; i++) {
+    uint64_t word = bf->bitset[i];
+    while (word) {
+      bits_set += word & 1;
+      word >>= 1;
+    }
+  }
+
+  const double fill_ratio = (double)bits_set / (double)bf->m;
+  const double estimated_fpr = pow(fill_ratio, (double)bf->h);
+
+  printf("Bloom Filter Statistics: %s\n", argv[1]);
+  printf("  Serialized Size: %" PRIu64 " bytes\n", bloom_block->size);
+  printf("  Filter Size (m): %u bits (%.2f KB)\n", bf->m,
+         (double)bf->m / 8.0 / 1024.0);
+  printf("  Hash Functions (k): %u\n", bf->h);
+  printf("  Storage Words: %u (uint64_t)\n", bf->size_in_words);
+  printf("  Bits Set: %" PRIu64 "\n", bits_set);
+  printf("  Fill Ratio: %.2f%%\n", fill_ratio * 100.0);
+  printf("  Estimated FPR: %.6f (%.4f%%)\n", estimated_fpr,
+         estimated_fpr * 100.0);
+
+  if (fill_ratio > 0.5) {
+    printf("  Warning: High fill ratio may increase false positives\n");
+  }
+
+  bloom_filter_free(bf);
+  block_manager_block_release(bloom_block);
+  block_manager_cursor_free(cursor);
+  block_manager_close(bm);
+  return 0;
+}
+
+#define BLOOM_AUDIT_REPORT 20
+
+typedef struct {
+  uint64_t bytes;
+  uint64_t blocks;
+  uint64_t keys;
+  uint64_t misses;
+  uint64_t checksum_errors;
+  uint64_t decode_errors;
+  uint64_t data_blocks;
+  uint64_t elapsed_us;
+  strbuf_t missing; /* previews of the first BLOOM_AUDIT_REPORT misses */
+  int no_bloom;
+  int truncated; /* fewer data blocks could be read than the file claims */
+  int failed;
+} bloom_audit_t;
+
+static void bloom_audit_probe(bloom_filter_t *bf, const uint8_t *key,
+                              const size_t size, bloom_audit_t *r) {
+  if (bloom_filter_contains(bf, key, size))
+    return;
+  if (r->misses++ < BLOOM_AUDIT_REPORT) {
+    const size_t shown = size < 48 ? size : 48;
+    strbuf_printf(&r->missing, "    \"%.*s\"%s\n", (int)shown,
+                  (const char *)key, size > 48 ? "..." : "");
+  }
+}
+
+/* streams every key of a klog's data blocks through its bloom filter;
+ * blocks with a bad checksum are counted and not probed */
+static int bloom_audit_klog(const char *path, bloom_audit_t *r) {
+  const uint64_t start = now_us();
+  block_manager_t *bm = NULL;
+  if (block_manager_open(&bm, path, BLOCK_MANAGER_SYNC_NONE) != 0) {
+    r->failed = 1;
+    return -1;
+  }
+  const int block_count = block_manager_count_blocks(bm);
+  block_manager_close(bm);
+  if (block_count < KLOG_TRAILER_BLOCKS) {
+    r->failed = 1;
+    return -1;
+  }
+  const int data_blocks = block_count - KLOG_TRAILER_BLOCKS;
+  r->data_blocks = (uint64_t)data_blocks;
+
+  bloom_filter_t *bf = klog_read_bloom(path);
+  if (bf == NULL) {
+    r->no_bloom = 1;
+    r->elapsed_us = now_us() - start;
+    return 0;
+  }
+
+  block_stream_t stream;
+  if (block_stream_open(&stream, path, 8, 0, 0) != 0) {
+    bloom_filter_free(bf);
+    r->failed = 1;
+    return -1;
+  }
+
+  stream_block_t block;
+  int rc = 0;
+  for (int i = 0;
+       i < data_blocks && (rc = block_stream_next(&stream, &block)) == 1;
+       i++) {
+    r->blocks++;
+    r->bytes += (uint64_t)block.size + 8;
+    if (compute_block_checksum(block.data, block.size) != block.checksum) {
+      r->checksum_errors++;
+      continue;
+    }
+    const uint8_t *ptr = block.data;
+    size_t remaining = block.size;
+    uint64_t prev_seq = 0;
+    klog_entry_t entry;
+    while (remaining > 0) {
+      if (klog_decode_entry(&ptr, &remaining, &prev_seq, &entry) != 0) {
+        r->decode_errors++;
+        break;
+      }
+      r->keys++;
+      bloom_audit_probe(bf, entry.key, (size_t)entry.key_size, r);
+    }
+  }
+  if (rc < 0 || r->blocks < (uint64_t)data_blocks)
+    r->truncated = 1;
+
+  block_stream_close(&stream);
+  bloom_filter_free(bf);
+  r->elapsed_us = now_us() - start;
+  return 0;
+}
+
+static int cmd_bloom_audit(const int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: bloom-audit <klog_path>\n");
+    printf("Checks that the bloom filter contains every key in an "
+           "SSTable.\n");
+    return -1;
+  }
+
+  bloom_audit_t r;
+  memset(&r, 0, sizeof(r));
+  if (bloom_audit_klog(argv[1], &r) != 0) {
+    printf("Failed to read SSTable file: %s\n", argv[1]);
+    strbuf_free(&r.missing);
+    return -1;
+  }
+
+  printf("Bloom Filter Audit: %s\n", argv[1]);
+  if (r.no_bloom) {
+    printf("  Bloom Filter: disabled or unreadable, nothing to audit\n");
+    return 0;
+  }
+  const double secs = (double)r.elapsed_us / 1e6;
+  printf("  Data Blocks: %" PRIu64 " (%" PRIu64 " bytes)\n", r.blocks,
+         r.bytes);
+  printf("  Keys Probed: %" PRIu64 "\n", r.keys);
+  printf("  Time: %.1f ms (%.1f MB/s, %.0f keys/s)\n",
+         (double)r.elapsed_us / 1000.0,
+         secs > 0 ? (double)r.bytes / (1024 * 1024) / secs : 0.0,
+         secs > 0 ? (double)r.keys / secs : 0.0);
+  if (r.checksum_errors)
+    printf("  Blocks Skipped (bad checksum): %" PRIu64 "\n",
+           r.checksum_errors);
+  if (r.decode_errors)
+    printf("  Undecodable Blocks: %" PRIu64 "\n", r.decode_errors);
+  if (r.truncated)
+    printf("  Truncated: %" PRIu64 " of %" PRIu64 " data blocks readable\n",
+           r.blocks, r.data_blocks);
+  printf("  False Negatives: %" PRIu64 "\n", r.misses);
+  if (r.missing.len > 0) {
+    printf("  Keys the filter reports absent:\n%s", r.missing.data);
+    if (r.misses > BLOOM_AUDIT_REPORT)
+      printf("    ... and %" PRIu64 " more\n", r.misses - BLOOM_AUDIT_REPORT);
+  }
+  strbuf_free(&r.missing);
+
+  const int ok = r.misses == 0 && r.checksum_errors == 0 &&
+                 r.decode_errors == 0 && !r.truncated;
+  printf("  Status: %s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : -1;
+}
+
+static int cmd_sstable_checksum(const int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: sstable-checksum <klog_path>\n");
+    printf("Verifies all block checksums and reports any corruption.\n");
+    return -1;
+  }
+
+  const int fd = open(argv[1], O_RDONLY);
+  if (fd < 0) {
+    printf("Failed to open file: %s\n", argv[1]);
+    return -1;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    printf("Failed to stat file\n");
+    close(fd);
+    return -1;
+  }
+
+  printf("Verifying checksums: %s\n", argv[1]);
+  printf("  File Size: %ld bytes\n\n", (long)st.st_size);
+
+  const uint64_t file_start = trace_now();
+  uint64_t pos = 8;
+  int block_num = 0;
+  int valid_blocks = 0;
+  int invalid_blocks = 0;
+
+  while (pos < (uint64_t)st.st_size) {
+    const uint64_t block_start = trace_now();
+    uint8_t header[8];
+    ssize_t nread = pread(fd, header, 8, (off_t)pos);
+    if (nread != 8)
+      break;
+
+    const uint32_t block_size = decode_uint32_le(header);
+    const uint32_t stored_checksum = decode_uint32_le(header + 4);
+
+    if (block_size == 0 || block_size > 100 * 1024 * 1024) {
+      printf("  Block %d @ offset %" PRIu64 ": INVALID SIZE (%u)\n", block_num,
+             pos, block_size);
+      invalid_blocks++;
+      break;
+    }
+
+    uint8_t *data = malloc(block_size);
+    if (!data) {
+      printf("  Block %d: OUT OF MEMORY\n", block_num);
+      break;
+    }
+
+    nread = pread(fd, data, block_size, (off_t)(pos + 8));
+    if (nread != (ssize_t)block_size) {
+      printf("  Block %d @ offset %" PRIu64
+             ": READ ERROR (expected %u, got %zd)\n",
+             block_num, pos, block_size, nread);
+      free(data);
+      invalid_blocks++;
+      break;
+    }
+
+    const uint32_t computed_checksum = compute_block_checksum(data, block_size);
+
+    if (computed_checksum != stored_checksum) {
+      printf("  Block %d @ offset %" PRIu64 ": CHECKSUM MISMATCH\n", block_num,
+             pos);
+      printf("    Size: %u bytes\n", block_size);
+      printf("    Stored:   0x%08X\n", stored_checksum);
+      printf("    Computed: 0x%08X\n", computed_checksum);
+      invalid_blocks++;
+    } else {
+      valid_blocks++;
+    }
+
+    free(data);
+    trace_span("checksum", "block", block_start,
+               "block=%d offset=%" PRIu64 " size=%u", block_num, pos,
+               block_size);
+
+    pos += 8 + block_size + 8;
+    block_num++;
+  }
+
+  trace_span("checksum", argv[1], file_start, "blocks=%d invalid=%d",
+             block_num, invalid_blocks);
+
+  printf("\nChecksum Verification Results:\n");
+  printf("  Total Blocks: %d\n", block_num);
+  printf("  Valid: %d\n", valid_blocks);
+  printf("  Invalid: %d\n", invalid_blocks);
+  printf("  Status: %s\n", invalid_blocks == 0 ? "OK" : "CORRUPTED");
+
+  close(fd);
+  return invalid_blocks > 0 ? -1 : 0;
+}
+
+static int read_vlog_value(const char *vlog_path, uint64_t vlog_offset,
+                           size_t value_size, uint8_t **value_out) {
+  const int fd = open(vlog_path, O_RDONLY);
+  if (fd < 0)
+    return -1;
+
+  uint8_t header[8];
+  ssize_t nread = pread(fd, header, 8, (off_t)vlog_offset);
+  if (nread != 8) {
+    close(fd);
+    return -1;
+  }
+
+  const uint32_t block_size = decode_uint32_le(header);
+  const uint32_t stored_checksum = decode_uint32_le(header + 4);
+
+  if (block_size == 0 || block_size > 100 * 1024 * 1024) {
+    close(fd);
+    return -1;
+  }
+
+  uint8_t *data = malloc(block_size);
+  if (!data) {
+    close(fd);
+    return -1;
+  }
+
+  nread = pread(fd, data, block_size, (off_t)(vlog_offset + 8));
+  if (nread != (ssize_t)block_size) {
+    free(data);
+    close(fd);
+    return -1;
+  }
+
+  uint32_t computed = compute_block_checksum(data, block_size);
+  if (computed != stored_checksum) {
+    free(data);
+    close(fd);
+    return -2;
+  }
+
+  *value_out = data;
+  close(fd);
+  return (int)block_size;
+}
+
+static int cmd_sstable_dump_full(const int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: sstable-dump-full <klog_path> [vlog_path] [limit]\n");
+    printf(
+        "Dumps SSTable entries with vlog value retrieval and checksum info.\n");
+    return -1;
+  }
+
+  const char *klog_path = argv[1];
+  const char *vlog_path = NULL;
+  int limit = ADMINTOOL_DEFAULT_DUMP_LIMIT;
+
+  if (argc >= 3) {
+    struct stat st;
+    if (stat(argv[2], &st) == 0 && S_ISREG(st.st_mode)) {
+      vlog_path = argv[2];
+      if (argc >= 4) {
+        char *endptr;
+        long parsed = strtol(argv[3], &endptr, 10);
+        if (*endptr == '\0' && parsed > 0)
+          limit = (int)parsed;
+      }
+    } else {
+      char *endptr;
+      long parsed = strtol(argv[2], &endptr, 10);
+      if (*endptr == '\0' && parsed > 0)
+        limit = (int)parsed;
+    }
+  }
+
+  int fd = open(klog_path, O_RDONLY);
+  if (fd < 0) {
+    printf("Failed to open klog: %s\n", klog_path);
+    return -1;
+  }
+
+  struct stat st;
+  fstat(fd, &st);
+
+  printf("SSTable Full Dump (limit: %d):\n", limit);
+  printf("  KLog: %s\n", klog_path);
+  if (vlog_path)
+    printf("  VLog: %s\n", vlog_path);
+  printf("\n");
+
+  uint64_t pos = 8;
+  int total_entries = 0;
+  int block_num = 0;
+  int checksum_errors = 0;
+
+  while (total_entries < limit && pos < (uint64_t)st.st_size) {
+    uint8_t header[8];
+    ssize_t nread = pread(fd, header, 8, (off_t)pos);
+    if (nread != 8)
+      break;
+
+    uint32_t block_size = decode_uint32_le(header);
+    uint32_t stored_checksum = decode_uint32_le(header + 4);
+
+    if (block_size == 0 || block_size > 100 * 1024 * 1024)
+      break;
+
+    uint8_t *block_data = malloc(block_size);
+    if (!block_data)
+      break;
+
+    nread = pread(fd, block_data, block_size, (off_t)(pos + 8));
+    if (nread != (ssize_t)block_size) {
+      free(block_data);
+      break;
+    }
+
+    uint32_t computed_checksum = compute_block_checksum(block_data, block_size);
+    int checksum_ok = (computed_checksum == stored_checksum);
+    if (!checksum_ok)
+      checksum_errors++;
+
+    const uint8_t *ptr = block_data;
+    size_t remaining = block_size;
+    uint64_t prev_seq = 0;
+
+    while (remaining > 0 && total_entries < limit) {
+      if (remaining < 1)
+        break;
+
+      uint8_t flags = *ptr++;
+      remaining--;
+
+      uint64_t key_size, value_size, seq_value;
+      int bytes_read;
+
+      bytes_read = decode_varint_safe(ptr, &key_size, remaining);
+      if (bytes_read < 0 || (size_t)bytes_read > remaining)
+        break;
+      ptr += bytes_read;
+      remaining -= bytes_read;
+
+      bytes_read = decode_varint_safe(ptr, &value_size, remaining);
+      if (bytes_read < 0 || (size_t)bytes_read > remaining)
+        break;
+      ptr += bytes_read;
+      remaining -= bytes_read;
+
+      bytes_read = decode_varint_safe(ptr, &seq_value, remaining);
+      if (bytes_read < 0 || (size_t)bytes_read > remaining)
+        break;
+      ptr += bytes_read;
+      remaining -= bytes_read;
+
+      uint64_t seq = seq_value;
+      if (flags & TDB_KV_FLAG_DELTA_SEQ)
+        seq = prev_seq + seq_value;
+      prev_seq = seq;
+
+      int64_t ttl = 0;
+      if (flags & TDB_KV_FLAG_HAS_TTL) {
+        if (remaining < sizeof(int64_t))
+          break;
+        memcpy(&ttl, ptr, sizeof(int64_t));
+        ptr += sizeof(int64_t);
+        remaining -= sizeof(int64_t);
+      }
+
+      uint64_t vlog_offset = 0;
+      if (flags & TDB_KV_FLAG_HAS_VLOG) {
+        bytes_read = decode_varint_safe(ptr, &vlog_offset, remaining);
+        if (bytes_read < 0 || (size_t)bytes_read > remaining)
+          break;
+        ptr += bytes_read;
+        remaining -= bytes_read;
+      }
+
+      if (remaining < key_size)
+        break;
+      const uint8_t *key = ptr;
+      ptr += key_size;
+      remaining -= key_size;
+
+      const uint8_t *value = NULL;
+      uint8_t *vlog_value = NULL;
+      int vlog_status = 0;
+
+      if (flags & TDB_KV_FLAG_HAS_VLOG) {
+        if (vlog_path && value_size > 0) {
+          vlog_status =
+              read_vlog_value(vlog_path, vlog_offset, value_size, &vlog_value);
+          if (vlog_status > 0)
+            value = vlog_value;
+        }
+      } else if (value_size > 0) {
+        if (remaining < value_size)
+          break;
+        value = ptr;
+        ptr += value_size;
+        remaining -= value_size;
+      }
+
+      total_entries++;
+      printf("%d) [blk:%d", total_entries, block_num);
+      if (!checksum_ok)
+        printf(" CHECKSUM_ERR");
+      printf("] ");
+
+      if (flags & TDB_KV_FLAG_TOMBSTONE)
+        printf("[DEL] ");
+      if (flags & TDB_KV_FLAG_HAS_TTL)
+        printf("[TTL:%" PRId64 "] ", ttl);
+      if (flags & TDB_KV_FLAG_HAS_VLOG) {
+        printf("[VLOG:%" PRIu64, vlog_offset);
+        if (vlog_status == -2)
+          printf(" CHECKSUM_ERR");
+        else if (vlog_status < 0 && vlog_path)
+          printf(" READ_ERR");
+        else if (!vlog_path)
+          printf(" NO_VLOG_FILE");
+        printf("] ");
+      }
+
+      printf("seq=%" PRIu64 " key=\"%.*s\"", seq, (int)key_size, (char *)key);
+
+      if (value && value_size > 0) {
+        if (value_size <= 64)
+          printf(" value=\"%.*s\"", (int)value_size, (char *)value);
+        else
+          printf(" value=(%zu bytes)", (size_t)value_size);
+      } else if ((flags & TDB_KV_FLAG_HAS_VLOG) && !vlog_value) {
+        printf(" value=(vlog, %zu bytes, not retrieved)", (size_t)value_size);
+      }
+      printf("\n");
+
+      free(vlog_value);
+    }
+
+    free(block_data);
+    pos += 8 + block_size + 8;
+    block_num++;
+  }
+
+  printf("\n(%d entries from %d blocks", total_entries, block_num);
+  if (checksum_errors > 0)
+    printf(", %d checksum errors", checksum_errors);
+  printf(")\n");
+
+  close(fd);
+  return checksum_errors > 0 ? -1 : 0;
+}
+
+static int list_target_files(const char *arg, const char *suffix,
+                             cf_file_t **files_out, int *count_out) {
+  struct stat st;
+  if (stat(arg, &st) == 0 && S_ISREG(st.st_mode)) {
+    cf_file_t *file = calloc(1, sizeof(*file));
+    if (!file)
+      return -1;
+    const char *name = strrchr(arg, '/');
+    snprintf(file->path, sizeof(file->path), "%s", arg);
+    snprintf(file->name, sizeof(file->name), "%s", name ? name + 1 : arg);
+    file->level = parse_level_from_name(file->name);
+    file->file_size = (uint64_t)st.st_size;
+    *files_out = file;
+    *count_out = 1;
+    return 0;
+  }
+
+  char cf_dir[4096];
+  if (resolve_cf_dir(arg, cf_dir, sizeof(cf_dir)) != 0)
+    return -1;
+  return list_cf_files(cf_dir, suffix, files_out, count_out);
+}
+
+static int append_target_files(const char *arg, const char *suffix,
+                               cf_file_t **files, int *count) {
+  cf_file_t *found = NULL;
+  int found_count = 0;
+  if (list_target_files(arg, suffix, &found, &found_count) != 0)
+    return -1;
+  if (found_count > 0) {
+    cf_file_t *grown =
+        realloc(*files, (size_t)(*count + found_count) * sizeof(**files));
+    if (!grown) {
+      free(found);
+      return -1;
+    }
+    memcpy(grown + *count, found, (size_t)found_count * sizeof(*found));
+    *files = grown;
+    *count += found_count;
+  }
+  free(found);
+  return 0;
+}
+
+/* expands each argument as a file, a directory or a glob pattern; other
+ * arguments starting with '-' are flags, and those named in value_flags
+ * take the next argument as their value, so both are skipped */
+static int collect_target_files(char **args, const int nargs,
+                                const char *const *value_flags,
+                                const char *suffix, cf_file_t **files_out,
+                                int *count_out) {
+  *files_out = NULL;
+  *count_out = 0;
+  for (int i = 0; i < nargs; i++) {
+    if (args[i][0] == '-' && args[i][1] != '\0') {
+      for (int f = 0; value_flags && value_flags[f]; f++) {
+        if (strcmp(args[i], value_flags[f]) == 0) {
+          i++;
+          break;
+        }
+      }
+      continue;
+    }
+#ifndef _WIN32
+    if (strpbrk(args[i], "*?[") != NULL) {
+      glob_t matches;
+      const int rc = glob(args[i], 0, NULL, &matches);
+      if (rc == GLOB_NOMATCH) {
+        printf("No files match %s\n", args[i]);
+        continue;
+      }
+      if (rc != 0)
+        return -1;
+      for (size_t m = 0; m < matches.gl_pathc; m++) {
+        if (append_target_files(matches.gl_pathv[m], suffix, files_out,
+                                count_out) != 0) {
+          globfree(&matches);
+          return -1;
+        }
+      }
+      globfree(&matches);
+      continue;
+    }
+#endif
+    if (append_target_files(args[i], suffix, files_out, count_out) != 0) {
+      printf("Not a file or directory: %s\n", args[i]);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static size_t parse_readahead(const char *arg) {
+  const long mb = atol(arg);
+  return mb > 0 ? (size_t)mb * 1024 * 1024 : ADMINTOOL_STREAM_BUFFER_SIZE;
+}
+
+typedef struct {
+  int file;
+  uint64_t start;
+  uint64_t end;
+  uint64_t blocks;
+  uint64_t value_bytes;
+  uint64_t min_value;
+  uint64_t max_value;
+  uint64_t histogram[32];
+  uint64_t bad_count;
+  uint64_t bad_offsets[ADMINTOOL_VLOG_REPORTED_ERRORS];
+  int truncated;
+  uint64_t truncated_at;
+} vlog_scan_job_t;
+
+typedef struct {
+  cf_file_t *files;
+  int file_count;
+  uint64_t chunk_target;
+  uint64_t **bounds;
+  int *bound_counts;
+  vlog_scan_job_t *jobs;
+  int verify;
+  size_t readahead;
+} vlog_scan_ctx_t;
+
+/* walks block headers only, recording a cut point roughly every
+ * chunk_target bytes so one large vlog can be scanned by several threads */
+static void vlog_plan_worker(void *arg, const int index) {
+  vlog_scan_ctx_t *ctx = arg;
+  const cf_file_t *file = &ctx->files[index];
+  int cap = 8;
+  int count = 0;
+  uint64_t *bounds = malloc((size_t)cap * sizeof(uint64_t));
+  if (!bounds)
+    return;
+  bounds[count++] = 8;
+
+  block_stream_t stream;
+  if (file->file_size > ctx->chunk_target &&
+      block_stream_open(&stream, file->path, 8, 0,
+                        ADMINTOOL_HEADER_WALK_BUFFER_SIZE) == 0) {
+    uint64_t last_cut = 8;
+    uint64_t offset;
+    uint32_t block_size;
+    while (block_stream_skip(&stream, &offset, &block_size) == 1) {
+      const uint64_t pos = stream.pos;
+      if (pos - last_cut >= ctx->chunk_target && pos < file->file_size) {
+        if (count == cap) {
+          cap *= 2;
+          uint64_t *grown = realloc(bounds, (size_t)cap * sizeof(uint64_t));
+          if (!grown)
+            break;
+          bounds = grown;
+        }
+        bounds[count++] = pos;
+        last_cut = pos;
+      }
+    }
+    block_stream_close(&stream);
+  }
+
+  ctx->bounds[index] = bounds;
+  ctx->bound_counts[index] = count;
+}
+
+static void vlog_scan_worker(void *arg, const int index) {
+  vlog_scan_ctx_t *ctx = arg;
+  vlog_scan_job_t *job = &ctx->jobs[index];
+  const cf_file_t *file = &ctx->files[job->file];
+  const uint64_t chunk_start = trace_now();
+
+  block_stream_t stream;
+  if (block_stream_open(&stream, file->path, job->start, job->end,
+                        ctx->readahead) != 0) {
+    job->truncated = 1;
+    job->truncated_at = job->start;
+    return;
+  }
+
+  job->min_value = UINT64_MAX;
+  stream_block_t block;
+  int rc;
+  while ((rc = block_stream_next(&stream, &block)) == 1) {
+    job->blocks++;
+    job->value_bytes += block.size;
+    if (block.size < job->min_value)
+      job->min_value = block.size;
+    if (block.size > job->max_value)
+      job->max_value = block.size;
+    int bucket = 0;
+    while (bucket < 31 && (block.size >> (bucket + 1)) != 0)
+      bucket++;
+    job->histogram[bucket]++;
+
+    if (ctx->verify &&
+        compute_block_checksum(block.data, block.size) != block.checksum) {
+      if (job->bad_count < ADMINTOOL_VLOG_REPORTED_ERRORS)
+        job->bad_offsets[job->bad_count] = block.offset;
+      job->bad_count++;
+    }
+  }
+  if (rc < 0) {
+    job->truncated = 1;
+    job->truncated_at = stream.pos;
+  }
+  block_stream_close(&stream);
+
+  trace_span(ctx->verify ? "vlog-checksum" : "vlog-stats", file->name,
+             chunk_start, "start=%" PRIu64 " blocks=%" PRIu64, job->start,
+             job->blocks);
+}
+
+static void vlog_scan_free(vlog_scan_ctx_t *ctx) {
+  if (ctx->bounds) {
+    for (int i = 0; i < ctx->file_count; i++)
+      free(ctx->bounds[i]);
+  }
+  free(ctx->bounds);
+  free(ctx->bound_counts);
+  free(ctx->jobs);
+  free(ctx->files);
+}
+
+/* splits every vlog into block-aligned chunks and scans them in parallel;
+ * returns the number of jobs, or -1 */
+static int vlog_scan_run(vlog_scan_ctx_t *ctx, const int threads) {
+  uint64_t total_size = 0;
+  for (int i = 0; i < ctx->file_count; i++)
+    total_size += ctx->files[i].file_size;
+  ctx->chunk_target = total_size / (uint64_t)threads;
+  if (ctx->chunk_target < ADMINTOOL_VLOG_MIN_CHUNK)
+    ctx->chunk_target = ADMINTOOL_VLOG_MIN_CHUNK;
+
+  ctx->bounds = calloc((size_t)ctx->file_count, sizeof(*ctx->bounds));
+  ctx->bound_counts = calloc((size_t)ctx->file_count, sizeof(int));
+  if (!ctx->bounds || !ctx->bound_counts)
+    return -1;
+  run_parallel(ctx->file_count, threads, vlog_plan_worker, ctx);
+
+  int job_count = 0;
+  for (int i = 0; i < ctx->file_count; i++) {
+    if (!ctx->bounds[i])
+      return -1;
+    job_count += ctx->bound_counts[i];
+  }
+
+  ctx->jobs = calloc((size_t)(job_count ? job_count : 1), sizeof(*ctx->jobs));
+  if (!ctx->jobs)
+    return -1;
+  int j = 0;
+  for (int i = 0; i < ctx->file_count; i++) {
+    for (int b = 0; b < ctx->bound_counts[i]; b++, j++) {
+      ctx->jobs[j].file = i;
+      ctx->jobs[j].start = ctx->bounds[i][b];
+      ctx->jobs[j].end = b + 1 < ctx->bound_counts[i]
+                             ? ctx->bounds[i][b + 1]
+                             : ctx->files[i].file_size;
+    }
+  }
+
+  run_parallel(job_count, threads, vlog_scan_worker, ctx);
+  return job_count;
+}
+
+static int vlog_scan_parse(const int argc, char **argv, const char *usage,
+                           vlog_scan_ctx_t *ctx, int *threads) {
+  memset(ctx, 0, sizeof(*ctx));
+  if (argc < 2) {
+    printf("Usage: %s\n", usage);
+    return -1;
+  }
+
+  *threads = default_thread_count();
+  ctx->readahead = ADMINTOOL_STREAM_BUFFER_SIZE;
+  for (int i = 2; i < argc; i++) {
+    if ((strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0) &&
+        i + 1 < argc)
+      *threads = parse_thread_count(argv[++i]);
+    else if (strcmp(argv[i], "--readahead") == 0 && i + 1 < argc)
+      ctx->readahead = parse_readahead(argv[++i]);
+  }
+
+  if (list_target_files(argv[1], ".vlog", &ctx->files, &ctx->file_count) !=
+      0) {
+    printf("Not a vlog file or column family: %s\n", argv[1]);
+    return -1;
+  }
+  if (ctx->file_count == 0) {
+    printf("No vlog files found in %s\n", argv[1]);
+    vlog_scan_free(ctx);
+    return -1;
+  }
+  return 0;
+}
+
+static int cmd_vlog_stats(const int argc, char **argv) {
+  vlog_scan_ctx_t ctx;
+  int threads;
+  if (vlog_scan_parse(argc, argv,
+                      "vlog-stats <vlog|cf> [-j threads] [--readahead MB]",
+                      &ctx, &threads) != 0)
+    return -1;
+
+  const uint64_t start = now_us();
+  const int job_count = vlog_scan_run(&ctx, threads);
+  if (job_count < 0) {
+    printf("Out of memory\n");
+    vlog_scan_free(&ctx);
+    return -1;
+  }
+  const double elapsed = (double)(now_us() - start) / 1e6;
+
+  uint64_t histogram[32] = {0};
+  uint64_t total_blocks = 0;
+  uint64_t total_values = 0;
+  uint64_t total_size = 0;
+  uint64_t min_value = UINT64_MAX;
+  uint64_t max_value = 0;
+  int issues = 0;
+
+  printf("VLog Statistics: %s\n\n", argv[1]);
+  printf("  %-24s %14s %10s %14s %10s\n", "VLog", "Size", "Blocks",
+         "Value Bytes", "Avg Value");
+  for (int f = 0; f < ctx.file_count; f++) {
+    uint64_t blocks = 0;
+    uint64_t values = 0;
+    int truncated = 0;
+    uint64_t truncated_at = 0;
+    for (int j = 0; j < job_count; j++) {
+      const vlog_scan_job_t *job = &ctx.jobs[j];
+      if (job->file != f)
+        continue;
+      blocks += job->blocks;
+      values += job->value_bytes;
+      if (job->blocks > 0 && job->min_value < min_value)
+        min_value = job->min_value;
+      if (job->max_value > max_value)
+        max_value = job->max_value;
+      for (int b = 0; b < 32; b++)
+        histogram[b] += job->histogram[b];
+      if (job->truncated && !truncated) {
+        truncated = 1;
+        truncated_at = job->truncated_at;
+      }
+    }
+    printf("  %-24s %14" PRIu64 " %10" PRIu64 " %14" PRIu64 " %10" PRIu64
+           "\n",
+           ctx.files[f].name, ctx.files[f].file_size, blocks, values,
+           blocks ? values / blocks : 0);
+    if (truncated) {
+      printf("  %-24s unreadable block at offset %" PRIu64 "\n", "",
+             truncated_at);
+      issues++;
+    }
+    total_blocks += blocks;
+    total_values += values;
+    total_size += ctx.files[f].file_size;
+  }
+
+  printf("\n  Total: %d vlogs, %" PRIu64 " blocks, %" PRIu64 " bytes\n",
+         ctx.file_count, total_blocks, total_size);
+  if (total_blocks > 0) {
+    printf("  Value Bytes: %" PRIu64 " (%.1f%% of file bytes)\n", total_values,
+           percent_of(total_values, total_size));
+    printf("  Value Size: min %" PRIu64 ", avg %" PRIu64 ", max %" PRIu64
+           "\n",
+           min_value, total_values / total_blocks, max_value);
+    printf("\n  Value Size Histogram:\n");
+    for (int b = 0; b < 32; b++) {
+      if (histogram[b] == 0)
+        continue;
+      printf("    %10" PRIu64 " - %-10" PRIu64 " %12" PRIu64 " %6.1f%%\n",
+             (uint64_t)1 << b, ((uint64_t)1 << (b + 1)) - 1, histogram[b],
+             percent_of(histogram[b], total_blocks));
+    }
+  }
+  printf("\n  Elapsed: %.2f s (%.1f MB/s, %d threads)\n", elapsed,
+         elapsed > 0 ? (double)total_size / 1048576.0 / elapsed : 0.0,
+         threads < job_count ? threads : job_count);
+
+  vlog_scan_free(&ctx);
+  return issues > 0 ? -1 : 0;
+}
+
+static int cmd_vlog_checksum(const int argc, char **argv) {
+  vlog_scan_ctx_t ctx;
+  int threads;
+  if (vlog_scan_parse(argc, argv,
+                      "vlog-checksum <vlog|cf> [-j threads] [--readahead MB]",
+                      &ctx, &threads) != 0)
+    return -1;
+  ctx.verify = 1;
+
+  printf("Verifying vlog checksums: %s\n\n", argv[1]);
+  const uint64_t start = now_us();
+  const int job_count = vlog_scan_run(&ctx, threads);
+  if (job_count < 0) {
+    printf("Out of memory\n");
+    vlog_scan_free(&ctx);
+    return -1;
+  }
+  const double elapsed = (double)(now_us() - start) / 1e6;
+
+  uint64_t total_blocks = 0;
+  uint64_t total_bad = 0;
+  uint64_t total_size = 0;
+  int bad_files = 0;
+  for (int f = 0; f < ctx.file_count; f++) {
+    uint64_t blocks = 0;
+    uint64_t bad = 0;
+    int truncated = 0;
+    for (int j = 0; j < job_count; j++) {
+      const vlog_scan_job_t *job = &ctx.jobs[j];
+      if (job->file != f)
+        continue;
+      blocks += job->blocks;
+      bad += job->bad_count;
+      truncated |= job->truncated;
+    }
+    const int ok = bad == 0 && !truncated;
+    printf("  %-24s %10" PRIu64 " blocks  %s\n", ctx.files[f].name, blocks,
+           ok ? "OK" : "CORRUPTED");
+    for (int j = 0; j < job_count && !ok; j++) {
+      const vlog_scan_job_t *job = &ctx.jobs[j];
+      if (job->file != f)
+        continue;
+      for (uint64_t i = 0;
+           i < job->bad_count && i < ADMINTOOL_VLOG_REPORTED_ERRORS; i++)
+        printf("    Block @ offset %" PRIu64 ": CHECKSUM MISMATCH\n",
+               job->bad_offsets[i]);
+      if (job->bad_count > ADMINTOOL_VLOG_REPORTED_ERRORS)
+        printf("    ... %" PRIu64 " more mismatches in this range\n",
+               job->bad_count - ADMINTOOL_VLOG_REPORTED_ERRORS);
+      if (job->truncated)
+        printf("    Block @ offset %" PRIu64 ": INVALID OR TRUNCATED\n",
+               job->truncated_at);
+    }
+    total_blocks += blocks;
+    total_bad += bad;
+    total_size += ctx.files[f].file_size;
+    if (!ok)
+      bad_files++;
+  }
+
+  printf("\nChecksum Verification Results:\n");
+  printf("  Files: %d (%d corrupted)\n", ctx.file_count, bad_files);
+  printf("  Total Blocks: %" PRIu64 "\n", total_blocks);
+  printf("  Invalid: %" PRIu64 "\n", total_bad);
+  printf("  Throughput: %.1f MB/s over %.2f s\n",
+         elapsed > 0 ? (double)total_size / 1048576.0 / elapsed : 0.0,
+         elapsed);
+  printf("  Status: %s\n", bad_files == 0 ? "OK" : "CORRUPTED");
+
+  vlog_scan_free(&ctx);
+  return bad_files > 0 ? -1 : 0;
+}
+
+static int cmd_vlog_dump(const int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: vlog-dump <vlog_path> [limit] [--readahead MB]\n");
+    printf("Dumps vlog blocks with offsets, sizes and checksum status.\n");
+    return -1;
+  }
+
+  int limit = ADMINTOOL_DEFAULT_DUMP_LIMIT;
+  size_t readahead = ADMINTOOL_STREAM_BUFFER_SIZE;
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--readahead") == 0 && i + 1 < argc) {
+      readahead = parse_readahead(argv[++i]);
+    } else {
+      char *endptr;
+      const long parsed = strtol(argv[i], &endptr, 10);
+      if (*endptr == '\0' && parsed > 0)
+        limit = (int)parsed;
+    }
+  }
+
+  block_stream_t stream;
+  if (block_stream_open(&stream, argv[1], 8, 0, readahead) != 0) {
+    printf("Failed to open vlog: %s\n", argv[1]);
+    return -1;
+  }
+
+  printf("VLog Dump (limit: %d): %s\n", limit, argv[1]);
+  printf("  File Size: %" PRIu64 " bytes\n\n", stream.file_size);
+
+  stream_block_t block;
+  int count = 0;
+  int bad = 0;
+  int rc = 0;
+  while (count < limit && (rc = block_stream_next(&stream, &block)) == 1) {
+    const int ok =
+        compute_block_checksum(block.data, block.size) == block.checksum;
+    if (!ok)
+      bad++;
+    printf("  [%d] offset=%" PRIu64 " size=%u%s", count, block.offset,
+           block.size, ok ? "" : " CHECKSUM_ERR");
+    if (block.size <= 64)
+      printf(" value=\"%.*s\"", (int)block.size, (const char *)block.data);
+    printf("\n");
+    count++;
+  }
+  if (rc < 0)
+    printf("  Invalid or truncated block at offset %" PRIu64 "\n", stream.pos);
+
+  printf("\nDumped %d blocks", count);
+  if (bad > 0)
+    printf(", %d checksum mismatches", bad);
+  printf("\n");
+
+  block_stream_close(&stream);
+  return bad > 0 || rc < 0 ? -1 : 0;
+}
+
+static int cmd_wal_list(const int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: wal-list <cf>\n");
+    return -1;
+  }
+
+  if (g_db == NULL) {
+    printf("No database is open.\n");
+    return -1;
+  }
+
+  const tidesdb_column_family_t *cf = tidesdb_get_column_family(g_db, argv[1]);
+  if (cf == NULL) {
+    printf("Column family '%s' not found.\n", argv[1]);
+    return -1;
+  }
+
+  char cf_path[2048];
+  snprintf(cf_path, sizeof(cf_path), "%s/%s", g_db_path, argv[1]);
+
+  DIR *dir = opendir(cf_path);
+  if (dir == NULL) {
+    printf("Cannot open column family directory: %s\n", strerror(errno));
+    return -1;
+  }
+
+  printf("WAL files in '%s':\n", argv[1]);
+  int count = 0;
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL) {
+    if (strstr(entry->d_name, ".log") != NULL) {
+      char full_path[4096];
+      snprintf(full_path, sizeof(full_path), "%s/%s", cf_path, entry->d_name);
+
+      struct stat st;
+      if (stat(full_path, &st) == 0) {
+        printf("  %s (%ld bytes)\n", entry->d_name, (long)st.st_size);
+        count++;
+      }
+    }
+  }
+  closedir(dir);
+
+  if (count == 0) {
+    printf("  (no WAL files found)\n");
+  } else {
+    printf("(%d WAL files)\n", count);
+  }
+
+  return 0;
+}
+
+static int cmd_wal_info(const int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: wal-info <wal_path>\n");
+    return -1;
+  }
+
+  block_manager_t *bm = NULL;
+  if (block_manager_open(&bm, argv[1], BLOCK_MANAGER_SYNC_NONE) != 0) {
+    printf("Failed to open WAL file: %s\n", argv[1]);
+    return -1;
+  }
+
+  uint64_t file_size = 0;
+  block_manager_get_size(bm, &file_size);
+
+  const int block_count = block_manager_count_blocks(bm);
+
+  printf("WAL: %s\n", argv[1]);
+  printf("  File Size: %" PRIu64 " bytes\n", file_size);
+  printf("  Block Count (entries): %d\n", block_count);
+  printf("  Last Modified: %ld\n", (long)block_manager_last_modified(bm));
+
+  block_manager_close(bm);
+  return 0;
+}
+
+static void print_wal_entry(const uint64_t entry_num,
+                            const klog_entry_t *entry) {
+  printf("%" PRIu64 ") ", entry_num);
+
+  if (entry->flags & TDB_KV_FLAG_TOMBSTONE)
+    printf("[DELETE] ");
+  else
+    printf("[PUT] ");
+
+  if (entry->partial)
+    printf("[PARTIAL] ");
+
+  if (entry->flags & TDB_KV_FLAG_HAS_TTL) {
+    if (entry->partial == 2)
+      printf("[TTL:?] ");
+    else
+      printf("[TTL:%" PRId64 "] ", entry->ttl);
+  }
+
+  if (entry->key == NULL) {
+    printf("seq=%" PRIu64 " key=(truncated, %zu bytes)", entry->seq,
+           (size_t)entry->key_size);
+  } else {
+    printf("seq=%" PRIu64 " key=\"%.*s\"", entry->seq, (int)entry->key_size,
+           (const char *)entry->key);
+  }
+
+  if (entry->value && entry->value_size > 0) {
+    if (entry->value_size <= 64) {
+      printf(" value=\"%.*s\"", (int)entry->value_size,
+             (const char *)entry->value);
+    } else {
+      printf(" value=(%zu bytes)", (size_t)entry->value_size);
+    }
+  } else if (entry->partial && entry->value_size > 0) {
+    printf(" value=(truncated, %zu bytes)", (size_t)entry->value_size);
+  }
+  printf("\n");
+}
+
+static int cmd_wal_dump(const int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: wal-dump <wal_path> [limit] [--prefix P] "
+           "[--key-range A B]\n");
+    printf("       [--seq-min N] [--seq-max N] [--only-deletes] "
+           "[--only-ttl]\n");
+    return -1;
+  }
+
+  int limit = ADMINTOOL_DEFAULT_DUMP_LIMIT;
+  dump_filter_t filter;
+  if (dump_filter_parse(argc, argv, &filter, &limit) != 0)
+    return -1;
+
+  struct stat st;
+  if (stat(argv[1], &st) == 0 && st.st_size > ADMINTOOL_LARGE_FILE_THRESHOLD) {
+    printf("Warning: Large WAL file (%" PRId64 " MB). ",
+           (int64_t)(st.st_size / (1024 * 1024)));
+    printf("Limiting to %d entries.\n", limit);
+  }
+
+  block_stream_t stream;
+  if (block_stream_open(&stream, argv[1], 8, 0, 0) != 0) {
+    printf("Failed to open WAL file: %s\n", argv[1]);
+    dump_filter_free(&filter);
+    return -1;
+  }
+
+  if (stream.file_size <= 8) {
+    printf("(empty WAL)\n");
+    block_stream_close(&stream);
+    dump_filter_free(&filter);
+    return 0;
+  }
+
+  printf("WAL Entries (limit: %d):\n", limit);
+  int entry_num = 0;
+  uint64_t scanned = 0;
+
+  stream_block_t block;
+  while (entry_num < limit && block_stream_next(&stream, &block) == 1) {
+    klog_entry_t entry;
+    if (wal_decode_entry(block.data, block.size, &entry) != 0 &&
+        wal_decode_partial(block.data, block.size, &entry) != 0)
+      continue;
+    scanned++;
+    if (filter.active && !dump_filter_match(&filter, &entry))
+      continue;
+    entry_num++;
+    print_wal_entry((uint64_t)entry_num, &entry);
+  }
+
+  printf("\n(%d WAL entries dumped)\n", entry_num);
+  if (filter.active)
+    printf("(%" PRIu64 " entries examined)\n", scanned);
+
+  block_stream_close(&stream);
+  dump_filter_free(&filter);
+  return 0;
+}
+
+typedef struct {
+  int fd;
+  char path[4096];
+  uint64_t pos;
+  uint64_t from_seq;
+  uint64_t printed;
+  uint64_t skipped;
+  uint64_t stuck_at;
+} wal_tail_t;
+
+/* decodes every complete block past tail->pos; returns 1 when the file
+ * ends on a block boundary and 0 while a block is still being written */
+static int wal_tail_drain(wal_tail_t *tail) {
+  struct stat st;
+  if (fstat(tail->fd, &st) != 0)
+    return 0;
+  const uint64_t file_size = (uint64_t)st.st_size;
+
+  while (tail->pos + 8 <= file_size) {
+    uint8_t header[8];
+    if (pread(tail->fd, header, 8, (off_t)tail->pos) != 8)
+      return 0;
+    const uint32_t block_size = decode_uint32_le(header);
+    const uint32_t stored_checksum = decode_uint32_le(header + 4);
+    const uint64_t span = 16 + (uint64_t)block_size;
+    if (block_size == 0 || block_size > 100 * 1024 * 1024 ||
+        tail->pos + span > file_size) {
+      if (block_size > 100 * 1024 * 1024 && tail->stuck_at != tail->pos) {
+        printf("# invalid block header at offset %" PRIu64 ", waiting\n",
+               tail->pos);
+        tail->stuck_at = tail->pos;
+      }
+      return 0;
+    }
+
+    uint8_t *data = malloc(block_size);
+    if (!data)
+      return 0;
+    if (pread(tail->fd, data, block_size, (off_t)(tail->pos + 8)) !=
+        (ssize_t)block_size) {
+      free(data);
+      return 0;
+    }
+
+    klog_entry_t entry;
+    if (compute_block_checksum(data, block_size) != stored_checksum) {
+      free(data);
+      /* the writer may still be filling this block; only a block with
+       * more data behind it is known to be bad */
+      if (tail->pos + span >= file_size)
+        return 0;
+      printf("# checksum mismatch at offset %" PRIu64 ", skipped\n",
+             tail->pos);
+    } else if (wal_decode_entry(data, block_size, &entry) != 0) {
+      printf("# undecodable entry at offset %" PRIu64 ", skipped\n",
+             tail->pos);
+      free(data);
+    } else {
+      if (entry.seq >= tail->from_seq)
+        print_wal_entry(++tail->printed, &entry);
+      else
+        tail->skipped++;
+      free(data);
+    }
+    tail->pos += span;
+  }
+  return tail->pos == file_size;
+}
+
+/* finds the WAL in cf_dir with the lowest id above after_id, or the
+ * highest id overall when newest is set */
+static int wal_tail_find(const char *cf_dir, const int after_id,
+                         const int newest, char *out, const size_t out_size) {
+  cf_file_t *wals = NULL;
+  int count = 0;
+  if (list_cf_files(cf_dir, ".log", &wals, &count) != 0)
+    return -1;
+  int best = -1;
+  for (int i = 0; i < count; i++) {
+    const int id = parse_sstable_id(wals[i].name);
+    if (newest) {
+      if (best < 0 || id > parse_sstable_id(wals[best].name))
+        best = i;
+    } else if (id > after_id &&
+               (best < 0 || id < parse_sstable_id(wals[best].name))) {
+      best = i;
+    }
+  }
+  if (best >= 0)
+    snprintf(out, out_size, "%s", wals[best].path);
+  free(wals);
+  return best >= 0 ? 0 : -1;
+}
+
+static int wal_tail_open(wal_tail_t *tail, const char *path,
+                         const int from_start) {
+  if (tail->fd >= 0)
+    close(tail->fd);
+  snprintf(tail->path, sizeof(tail->path), "%s", path);
+  tail->fd = open(path, O_RDONLY);
+  if (tail->fd < 0)
+    return -1;
+  tail->pos = 8;
+  tail->stuck_at = 0;
+  if (from_start)
+    return 0;
+
+  /* the writer may be mid-block, so start after the last complete block
+   * rather than at the current end of the file */
+  block_stream_t stream;
+  if (block_stream_open(&stream, path, 8, 0, 0) == 0) {
+    stream_block_t block;
+    while (block_stream_next(&stream, &block) == 1)
+      ;
+    tail->pos = stream.pos;
+    block_stream_close(&stream);
+  }
+  return 0;
+}
+
+/* a followed file that was truncated, or renamed away and replaced by a
+ * new file at the same path, has to be reopened; returns 1 when a new file
+ * is in place, 0 when the open one is still current, -1 while the path is
+ * missing */
+static int wal_tail_replaced(const wal_tail_t *tail) {
+  struct stat by_path;
+  struct stat by_fd;
+  if (stat(tail->path, &by_path) != 0)
+    return -1;
+  if (fstat(tail->fd, &by_fd) != 0)
+    return 1;
+  return by_path.st_ino != by_fd.st_ino || by_path.st_dev != by_fd.st_dev ||
+         (uint64_t)by_path.st_size < tail->pos;
+}
+
+static int cmd_wal_tail(const int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: wal-tail <wal_path|cf> [--from-seq N]\n");
+    printf("Follows a WAL and prints entries as they are appended.\n");
+    return -1;
+  }
+
+  wal_tail_t tail;
+  memset(&tail, 0, sizeof(tail));
+  tail.fd = -1;
+  int from_start = 0;
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--from-seq") == 0 && i + 1 < argc) {
+      tail.from_seq = strtoull(argv[++i], NULL, 10);
+      from_start = 1;
+    }
+  }
+
+  char cf_dir[4096] = {0};
+  char path[4096];
+  struct stat st;
+  if (stat(argv[1], &st) == 0 && S_ISREG(st.st_mode)) {
+    snprintf(path, sizeof(path), "%s", argv[1]);
+  } else if (resolve_cf_dir(argv[1], cf_dir, sizeof(cf_dir)) == 0) {
+    if (wal_tail_find(cf_dir, -1, !from_start, path, sizeof(path)) != 0) {
+      printf("No WAL files found in %s\n", cf_dir);
+      return -1;
+    }
+  } else {
+    printf("Not a WAL file or column family: %s\n", argv[1]);
+    return -1;
+  }
+
+  if (wal_tail_open(&tail, path, from_start) != 0) {
+    printf("Failed to open WAL file: %s\n", path);
+    return -1;
+  }
+
+  int notify_fd = -1;
+  int file_watch = -1;
+#ifdef __linux__
+  notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (notify_fd >= 0) {
+    file_watch = inotify_add_watch(notify_fd, tail.path,
+                                   IN_MODIFY | IN_DELETE_SELF | IN_MOVE_SELF);
+    if (cf_dir[0] != '\0') {
+      inotify_add_watch(notify_fd, cf_dir, IN_CREATE | IN_MOVED_TO);
+    } else {
+      /* wakes up when a replacement appears at the followed path */
+      char dir[4096];
+      snprintf(dir, sizeof(dir), "%s", tail.path);
+      char *slash = strrchr(dir, '/');
+      if (slash == dir)
+        slash[1] = '\0';
+      else if (slash != NULL)
+        *slash = '\0';
+      else
+        snprintf(dir, sizeof(dir), ".");
+      inotify_add_watch(notify_fd, dir, IN_CREATE | IN_MOVED_TO);
+    }
+  }
+#endif
+  int file_gone = 0;
+
+  void (*prev_int)(int) = signal(SIGINT, handle_interrupt);
+  g_interrupted = 0;
+
+  printf("Following %s from offset %" PRIu64, tail.path, tail.pos);
+  if (from_start)
+    printf(" (seq >= %" PRIu64 ")", tail.from_seq);
+  printf("%s\nPress Ctrl-C to stop.\n",
+         notify_fd >= 0 ? "" : " (polling)");
+  fflush(stdout);
+
+  while (!g_interrupted) {
+    const int at_boundary = wal_tail_drain(&tail);
+    fflush(stdout);
+
+    char next[4096];
+    int switch_to_next = 0;
+    if (cf_dir[0] != '\0' && at_boundary) {
+      const int id = parse_sstable_id(strrchr(tail.path, '/') + 1);
+      switch_to_next = wal_tail_find(cf_dir, id, 0, next, sizeof(next)) == 0;
+    } else if (cf_dir[0] == '\0') {
+      /* the file was truncated or replaced; start over on the new one */
+      const int replaced = wal_tail_replaced(&tail);
+      if (replaced > 0) {
+        snprintf(next, sizeof(next), "%s", tail.path);
+        switch_to_next = 1;
+      } else if (replaced < 0 && !file_gone) {
+        printf("# %s was moved or deleted, waiting for a new file\n",
+               tail.path);
+        fflush(stdout);
+        file_gone = 1;
+      }
+    }
+
+    if (switch_to_next) {
+      if (wal_tail_open(&tail, next, 1) != 0) {
+        printf("Failed to open WAL file: %s\n", next);
+        break;
+      }
+      printf("# now following %s\n", tail.path);
+      fflush(stdout);
+      file_gone = 0;
+#ifdef __linux__
+      if (notify_fd >= 0) {
+        if (file_watch >= 0)
+          inotify_rm_watch(notify_fd, file_watch);
+        file_watch = inotify_add_watch(
+            notify_fd, tail.path, IN_MODIFY | IN_DELETE_SELF | IN_MOVE_SELF);
+      }
+#endif
+      continue;
+    }
+
+#ifdef __linux__
+    if (notify_fd >= 0) {
+      struct pollfd pfd = {.fd = notify_fd, .events = POLLIN, .revents = 0};
+      if (poll(&pfd, 1, 500) > 0) {
+        /* the loop re-checks the path after every wakeup, so the events
+         * only need to be consumed; a moved or deleted file also ends its
+         * watch, which is replaced when the new file is opened */
+        char events[4096]
+            __attribute__((aligned(__alignof__(struct inotify_event))));
+        ssize_t n;
+        while ((n = read(notify_fd, events, sizeof(events))) > 0) {
+          for (ssize_t at = 0; at < n;) {
+            const struct inotify_event *ev =
+                (const struct inotify_event *)(events + at);
+            if (ev->wd == file_watch &&
+                (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)))
+              file_watch = -1;
+            at += (ssize_t)sizeof(*ev) + ev->len;
+          }
+        }
+      }
+      continue;
+    }
+#endif
+    usleep(ADMINTOOL_POLL_INTERVAL_US);
+  }
+
+  if (notify_fd >= 0)
+    close(notify_fd);
+  close(tail.fd);
+  signal(SIGINT, prev_int);
+  g_interrupted = 0;
+
+  printf("\nStopped at %s offset %" PRIu64 " (%" PRIu64 " entries shown",
+         tail.path, tail.pos, tail.printed);
+  if (tail.skipped > 0)
+    printf(", %" PRIu64 " below --from-seq", tail.skipped);
+  printf(")\n");
+  return 0;
+}
+
+typedef struct {
+  cf_file_t file;
+  uint64_t blocks;
+  uint64_t valid_entries;
+  uint64_t checksum_errors;
+  uint64_t structure_errors;
+  uint64_t seq_regressions;
+  uint64_t min_seq;
+  uint64_t max_seq;
+  uint64_t valid_end;
+  uint64_t prefix_entries;
+  uint64_t first_error_at;
+  XXH3_state_t *hash; /* optional: digest of the first hash_end bytes */
+  uint64_t hash_end;
+  XXH128_hash_t digest;
+  int hash_failed;
+  int bad_header; /* shorter than the 8-byte file header */
+  int truncated;
+  int failed;
+} wal_verify_t;
+
+static void wal_verify_worker(void *arg, const int index) {
+  wal_verify_t *r = &((wal_verify_t *)arg)[index];
+  const uint64_t file_start = trace_now();
+  r->min_seq = UINT64_MAX;
+  r->valid_end = 8;
+
+  block_stream_t stream;
+  if (block_stream_open(&stream, r->file.path, 8, 0, 0) != 0) {
+    r->failed = 1;
+    return;
+  }
+  if (r->hash && block_stream_hash(&stream, r->hash, r->hash_end) != 0)
+    r->hash_failed = 1;
+  if (stream.file_size < 8) {
+    r->bad_header = 1;
+    r->valid_end = stream.file_size;
+    r->first_error_at = 0;
+    if (r->hash && !r->hash_failed &&
+        block_stream_hash_digest(&stream, &r->digest) != 0)
+      r->hash_failed = 1;
+    block_stream_close(&stream);
+    return;
+  }
+
+  int prefix_intact = 1;
+  uint64_t prev_seq = 0;
+  stream_block_t block;
+  klog_entry_t entry;
+  int rc;
+  while ((rc = block_stream_next(&stream, &block)) == 1) {
+    const uint64_t block_start = trace_now();
+    r->blocks++;
+    int valid = 1;
+    if (compute_block_checksum(block.data, block.size) != block.checksum) {
+      r->checksum_errors++;
+      valid = 0;
+    } else if (wal_decode_entry(block.data, block.size, &entry) != 0) {
+      r->structure_errors++;
+      valid = 0;
+    }
+
+    if (valid) {
+      r->valid_entries++;
+      if (entry.seq < r->min_seq)
+        r->min_seq = entry.seq;
+      if (entry.seq > r->max_seq)
+        r->max_seq = entry.seq;
+      if (r->valid_entries > 1 && entry.seq <= prev_seq)
+        r->seq_regressions++;
+      prev_seq = entry.seq;
+      if (prefix_intact) {
+        r->valid_end = block.offset + 16 + block.size;
+        r->prefix_entries++;
+      }
+    } else if (prefix_intact) {
+      prefix_intact = 0;
+      r->first_error_at = block.offset;
+    }
+
+    trace_span("verify", "block", block_start,
+               "offset=%" PRIu64 " size=%u valid=%d", block.offset,
+               block.size, valid);
+  }
+  if (rc < 0) {
+    r->truncated = 1;
+    if (prefix_intact) {
+      prefix_intact = 0;
+      r->first_error_at = stream.pos;
+    }
+  }
+  if (r->hash && !r->hash_failed &&
+      block_stream_hash_digest(&stream, &r->digest) != 0)
+    r->hash_failed = 1;
+  block_stream_close(&stream);
+
+  trace_span("verify", r->file.name, file_start,
+             "valid=%" PRIu64 " corrupted=%" PRIu64, r->valid_entries,
+             r->checksum_errors + r->structure_errors);
+}
+
+static int wal_verify_seq_compare(const void *a, const void *b) {
+  const wal_verify_t *ra = a;
+  const wal_verify_t *rb = b;
+  if (ra->min_seq != rb->min_seq)
+    return ra->min_seq < rb->min_seq ? -1 : 1;
+  return strcmp(ra->file.path, rb->file.path);
+}
+
+static int cmd_wal_verify(const int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: wal-verify <wal_path|dir|glob>... [-j threads]\n");
+    printf("Verifies WAL structure and checksums and seq continuity.\n");
+    return -1;
+  }
+
+  int threads = default_thread_count();
+  for (int i = 1; i < argc; i++) {
+    if ((strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0) &&
+        i + 1 < argc)
+      threads = parse_thread_count(argv[++i]);
+  }
+
+  static const char *const value_flags[] = {"-j", "--jobs", NULL};
+  cf_file_t *files = NULL;
+  int count = 0;
+  if (collect_target_files(argv + 1, argc - 1, value_flags, ".log", &files,
+                           &count) != 0) {
+    free(files);
+    return -1;
+  }
+  if (count == 0) {
+    printf("No WAL files found\n");
+    return -1;
+  }
+
+  wal_verify_t *results = calloc((size_t)count, sizeof(*results));
+  if (!results) {
+    printf("Out of memory\n");
+    free(files);
+    return -1;
+  }
+  for (int i = 0; i < count; i++)
+    results[i].file = files[i];
+  free(files);
+
+  const uint64_t start = now_us();
+  run_parallel(count, threads, wal_verify_worker, results);
+  const double elapsed = (double)(now_us() - start) / 1e6;
+
+  int corrupted_files = 0;
+  uint64_t total_bytes = 0;
+  for (int i = 0; i < count; i++) {
+    const wal_verify_t *r = &results[i];
+    const uint64_t corrupted = r->checksum_errors + r->structure_errors;
+    const int ok =
+        !r->failed && !r->bad_header && !r->truncated && corrupted == 0;
+    total_bytes += r->file.file_size;
+
+    printf("Verifying WAL: %s\n", r->file.path);
+    if (r->failed) {
+      printf("  Status: FAILED (cannot open file)\n\n");
+      corrupted_files++;
+      continue;
+    }
+    printf("  File Size: %" PRIu64 " bytes\n", r->file.file_size);
+    if (r->bad_header) {
+      printf("  Status: CORRUPTED (header %s, %" PRIu64 " of 8 bytes)\n\n",
+             r->file.file_size == 0 ? "missing" : "truncated",
+             r->file.file_size);
+      corrupted_files++;
+      continue;
+    }
+    printf("  Valid Entries: %" PRIu64 "\n", r->valid_entries);
+    printf("  Corrupted Entries: %" PRIu64 " (checksum %" PRIu64
+           ", structure %" PRIu64 ")\n",
+           corrupted, r->checksum_errors, r->structure_errors);
+    if (r->truncated)
+      printf("  Truncated Block At: %" PRIu64 "\n", r->first_error_at);
+    if (r->valid_entries > 0) {
+      printf("  Sequence Range: %" PRIu64 " - %" PRIu64 "\n", r->min_seq,
+             r->max_seq);
+      if (r->seq_regressions > 0)
+        printf("  Out-of-Order Seqs: %" PRIu64 "\n", r->seq_regressions);
+      printf("  Last Valid Position: %" PRIu64 "\n", r->valid_end);
+    }
+    if (ok) {
+      printf("  Status: OK\n\n");
+    } else {
+      printf("  Status: CORRUPTED (first error at %" PRIu64
+             ", recovery possible up to position %" PRIu64 ")\n\n",
+             r->first_error_at, r->valid_end);
+      corrupted_files++;
+    }
+  }
+
+  if (count > 1) {
+    qsort(results, (size_t)count, sizeof(*results), wal_verify_seq_compare);
+    printf("Sequence Continuity:\n");
+    int breaks = 0;
+    const wal_verify_t *prev = NULL;
+    for (int i = 0; i < count; i++) {
+      const wal_verify_t *r = &results[i];
+      if (r->valid_entries == 0)
+        continue;
+      if (prev && r->min_seq != prev->max_seq + 1) {
+        if (r->min_seq <= prev->max_seq)
+          printf("  OVERLAP: %s ends at %" PRIu64 ", %s starts at %" PRIu64
+                 "\n",
+                 prev->file.name, prev->max_seq, r->file.name, r->min_seq);
+        else
+          printf("  GAP: %" PRIu64 " seqs missing between %s and %s (%" PRIu64
+                 " .. %" PRIu64 ")\n",
+                 r->min_seq - prev->max_seq - 1, prev->file.name,
+                 r->file.name, prev->max_seq + 1, r->min_seq - 1);
+        breaks++;
+      }
+      prev = r;
+    }
+    if (breaks == 0)
+      printf("  Continuous across %d files\n", count);
+    printf("\n");
+
+    printf("Summary: %d files, %d corrupted, %" PRIu64
+           " bytes in %.2f s (%.1f MB/s)\n",
+           count, corrupted_files, total_bytes, elapsed,
+           elapsed > 0 ? (double)total_bytes / 1048576.0 / elapsed : 0.0);
+  }
+
+  free(results);
+  return corrupted_files > 0 ? -1 : 0;
+}
+
+static int fsync_parent_dir(const char *path) {
+#ifndef _WIN32
+  char dir[4096];
+  snprintf(dir, sizeof(dir), "%s", path);
+  char *slash = strrchr(dir, '/');
+  if (slash == dir)
+    slash[1] = '\0';
+  else if (slash)
+    *slash = '\0';
+  else
+    snprintf(dir, sizeof(dir), ".");
+  const int fd = open(dir, O_RDONLY);
+  if (fd < 0)
+    return -1;
+  const int rc = fsync(fd);
+  close(fd);
+  return rc;
+#else
+  (void)path;
+  return 0;
+#endif
+}
+
+/* clones src into dst with a reflink when the filesystem supports it,
+ * otherwise copies through a fixed buffer; returns 1 for a clone */
+static int copy_file_cow(const char *src, const char *dst) {
+  const int in = open(src, O_RDONLY);
+  if (in < 0)
+    return -1;
+  const int out = open(dst, O_WRONLY | O_CREAT | O_EXCL, 0644);
+  if (out < 0) {
+    close(in);
+    return -1;
+  }
+
+  int rc = -1;
+#ifdef FICLONE
+  if (ioctl(out, FICLONE, in) == 0)
+    rc = 1;
+#endif
+  if (rc < 0) {
+    uint8_t *buf = malloc(ADMINTOOL_STREAM_BUFFER_SIZE);
+    rc = buf ? 0 : -1;
+    while (rc == 0) {
+      const ssize_t n = read(in, buf, ADMINTOOL_STREAM_BUFFER_SIZE);
+      if (n == 0)
+        break;
+      if (n < 0 || write_all(out, buf, (size_t)n) != 0)
+        rc = -1;
+    }
+    free(buf);
+  }
+
+  if (rc >= 0 && fsync(out) != 0)
+    rc = -1;
+  close(out);
+  close(in);
+  if (rc < 0)
+    unlink(dst);
+  else
+    fsync_parent_dir(dst);
+  return rc;
+}
+
+/* compares resolved paths, so "../db/users" or a symlink into the database
+ * counts as inside it and "/data/db2" does not count as inside "/data/db" */
+static int path_is_within(const char *path, const char *dir) {
+  char real_path[4096];
+  char real_dir[4096];
+#ifdef _WIN32
+  if (_fullpath(real_path, path, sizeof(real_path)) == NULL ||
+      _fullpath(real_dir, dir, sizeof(real_dir)) == NULL)
+    return -1;
+#else
+  if (realpath(path, real_path) == NULL || realpath(dir, real_dir) == NULL)
+    return -1;
+#endif
+  size_t n = strlen(real_dir);
+  while (n > 1 && (real_dir[n - 1] == '/' || real_dir[n - 1] == '\\'))
+    n--;
+  if (strncmp(real_path, real_dir, n) != 0)
+    return 0;
+  return real_path[n] == '\0' || real_path[n] == '/' ||
+         real_path[n] == '\\' || n == 1;
+}
+
+static int cmd_wal_repair(const int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: wal-repair <wal_path> [--dry-run] [--backup <path>]\n");
+    printf("Truncates a WAL after its last valid block, keeping a backup.\n");
+    return -1;
+  }
+
+  int dry_run = 0;
+  const char *backup = NULL;
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--dry-run") == 0)
+      dry_run = 1;
+    else if (strcmp(argv[i], "--backup") == 0 && i + 1 < argc)
+      backup = argv[++i];
+  }
+
+  wal_verify_t result;
+  memset(&result, 0, sizeof(result));
+  struct stat st;
+  if (stat(argv[1], &st) != 0 || !S_ISREG(st.st_mode)) {
+    printf("Not a WAL file: %s\n", argv[1]);
+    return -1;
+  }
+
+  if (g_db != NULL) {
+    const int inside = path_is_within(argv[1], g_db_path);
+    if (inside < 0) {
+      printf("Cannot resolve '%s': %s\n", argv[1], strerror(errno));
+      return -1;
+    }
+    if (inside) {
+      printf("Close the database before repairing its WAL files.\n");
+      return -1;
+    }
+  }
+  snprintf(result.file.path, sizeof(result.file.path), "%s", argv[1]);
+  snprintf(result.file.name, sizeof(result.file.name), "%s", argv[1]);
+  result.file.file_size = (uint64_t)st.st_size;
+
+  const uint64_t start = now_us();
+  wal_verify_worker(&result, 0);
+  if (result.failed) {
+    printf("Failed to open WAL file: %s\n", argv[1]);
+    return -1;
+  }
+
+  printf("WAL Repair: %s\n", argv[1]);
+  printf("  File Size: %" PRIu64 " bytes\n", result.file.file_size);
+  if (result.bad_header) {
+    printf("  Status: CANNOT REPAIR (header %s, %" PRIu64 " of 8 bytes)\n",
+           result.file.file_size == 0 ? "missing" : "truncated",
+           result.file.file_size);
+    return -1;
+  }
+  printf("  Valid Entries: %" PRIu64 "\n", result.valid_entries);
+  if (result.valid_end >= result.file.file_size) {
+    printf("  Status: OK (nothing to repair)\n");
+    return 0;
+  }
+
+  const uint64_t dropped = result.file.file_size - result.valid_end;
+  printf("  First Error At: %" PRIu64 "\n", result.first_error_at);
+  printf("  Entries Kept: %" PRIu64 ", Dropped: %" PRIu64 "\n",
+         result.prefix_entries,
+         result.valid_entries - result.prefix_entries);
+  printf("  Truncate To: %" PRIu64 " (drops %" PRIu64 " bytes",
+         result.valid_end, dropped);
+  if (result.checksum_errors + result.structure_errors > 0)
+    printf(", %" PRIu64 " bad blocks",
+           result.checksum_errors + result.structure_errors);
+  printf(")\n");
+
+  if (dry_run) {
+    printf("  Status: DRY RUN (no changes made)\n");
+    return 0;
+  }
+
+  char backup_path[4096];
+  if (backup)
+    snprintf(backup_path, sizeof(backup_path), "%s", backup);
+  else
+    snprintf(backup_path, sizeof(backup_path), "%s.bak", argv[1]);
+  const int cloned = copy_file_cow(argv[1], backup_path);
+  if (cloned < 0) {
+    printf("  Failed to create backup %s: %s\n", backup_path,
+           strerror(errno));
+    printf("  Status: ABORTED (WAL unchanged)\n");
+    return -1;
+  }
+  printf("  Backup: %s (%s)\n", backup_path, cloned ? "reflink" : "copy");
+
+  const int fd = open(argv[1], O_WRONLY);
+  if (fd < 0 || ftruncate(fd, (off_t)result.valid_end) != 0 ||
+      fsync(fd) != 0) {
+    printf("  Failed to truncate WAL: %s\n", strerror(errno));
+    if (fd >= 0)
+      close(fd);
+    return -1;
+  }
+  close(fd);
+
+  printf("  Status: REPAIRED in %.2f s\n", (double)(now_us() - start) / 1e6);
+  return 0;
+}
+
+/* Space-Saving heavy hitters: a fixed set of counters where a miss on a
+ * full table evicts the smallest counter and inherits its count as error;
+ * a min-heap on count finds that counter in O(log capacity) */
+typedef struct {
+  uint8_t key[ADMINTOOL_TOPK_KEY_MAX];
+  size_t key_size;
+  uint64_t count;
+  uint64_t error;
+  uint64_t bytes;
+  int next;
+  int heap_pos;
+} topk_slot_t;
+
+typedef struct {
+  topk_slot_t *slots;
+  int *buckets;
+  int *heap;
+  int capacity;
+  int used;
+} topk_t;
+
+static int topk_init(topk_t *t, const int capacity) {
+  memset(t, 0, sizeof(*t));
+  t->slots = calloc((size_t)capacity, sizeof(*t->slots));
+  t->buckets = malloc((size_t)capacity * 2 * sizeof(int));
+  t->heap = malloc((size_t)capacity * sizeof(int));
+  if (!t->slots || !t->buckets || !t->heap) {
+    free(t->slots);
+    free(t->buckets);
+    free(t->heap);
+    return -1;
+  }
+  for (int i = 0; i < capacity * 2; i++)
+    t->buckets[i] = -1;
+  t->capacity = capacity;
+  return 0;
+}
+
+static void topk_free(topk_t *t) {
+  free(t->slots);
+  free(t->buckets);
+  free(t->heap);
+  memset(t, 0, sizeof(*t));
+}
+
+static void topk_heap_swap(topk_t *t, const int a, const int b) {
+  const int tmp = t->heap[a];
+  t->heap[a] = t->heap[b];
+  t->heap[b] = tmp;
+  t->slots[t->heap[a]].heap_pos = a;
+  t->slots[t->heap[b]].heap_pos = b;
+}
+
+/* counts only grow, so a changed slot can only move towards the leaves */
+static void topk_heap_sift_down(topk_t *t, int i) {
+  while (1) {
+    const int l = 2 * i + 1;
+    const int r = l + 1;
+    int smallest = i;
+    if (l < t->used &&
+        t->slots[t->heap[l]].count < t->slots[t->heap[smallest]].count)
+      smallest = l;
+    if (r < t->used &&
+        t->slots[t->heap[r]].count < t->slots[t->heap[smallest]].count)
+      smallest = r;
+    if (smallest == i)
+      return;
+    topk_heap_swap(t, i, smallest);
+    i = smallest;
+  }
+}
+
+static void topk_heap_push(topk_t *t, const int slot) {
+  int i = slot;
+  t->heap[i] = slot;
+  t->slots[slot].heap_pos = i;
+  while (i > 0) {
+    const int parent = (i - 1) / 2;
+    if (t->slots[t->heap[i]].count >= t->slots[t->heap[parent]].count)
+      break;
+    topk_heap_swap(t, i, parent);
+    i = parent;
+  }
+}
+
+static int topk_bucket(const topk_t *t, const uint8_t *key, const size_t size) {
+  return (int)(XXH32(key, size, 0) % (uint32_t)(t->capacity * 2));
+}
+
+static void topk_unlink(topk_t *t, const int slot) {
+  const topk_slot_t *s = &t->slots[slot];
+  int *link = &t->buckets[topk_bucket(t, s->key, s->key_size)];
+  while (*link != -1 && *link != slot)
+    link = &t->slots[*link].next;
+  if (*link == slot)
+    *link = s->next;
+}
+
+static void topk_add(topk_t *t, const uint8_t *key, size_t size,
+                     const uint64_t bytes) {
+  if (size > ADMINTOOL_TOPK_KEY_MAX)
+    size = ADMINTOOL_TOPK_KEY_MAX;
+  const int bucket = topk_bucket(t, key, size);
+  for (int i = t->buckets[bucket]; i != -1; i = t->slots[i].next) {
+    topk_slot_t *s = &t->slots[i];
+    if (s->key_size == size && memcmp(s->key, key, size) == 0) {
+      s->count++;
+      s->bytes += bytes;
+      topk_heap_sift_down(t, s->heap_pos);
+      return;
+    }
+  }
+
+  const int fresh = t->used < t->capacity;
+  const int slot = fresh ? t->used++ : t->heap[0];
+  uint64_t inherited = 0;
+  if (!fresh) {
+    inherited = t->slots[slot].count;
+    topk_unlink(t, slot);
+  }
+
+  topk_slot_t *s = &t->slots[slot];
+  memcpy(s->key, key, size);
+  s->key_size = size;
+  s->count = inherited + 1;
+  s->error = inherited;
+  s->bytes = bytes;
+  s->next = t->buckets[bucket];
+  t->buckets[bucket] = slot;
+  if (fresh)
+    topk_heap_push(t, slot);
+  else
+    topk_heap_sift_down(t, 0);
+}
+
+static int topk_slot_compare(const void *a, const void *b) {
+  const topk_slot_t *sa = a;
+  const topk_slot_t *sb = b;
+  if (sa->count != sb->count)
+    return sa->count > sb->count ? -1 : 1;
+  return compare_keys(sa->key, sa->key_size, sb->key, sb->key_size);
+}
+
+static void topk_print(topk_t *t, const char *title, const int k,
+                       const uint64_t total) {
+  /* sorting breaks the hash chains and the heap, which is fine once
+   * streaming is done */
+  qsort(t->slots, (size_t)t->used, sizeof(*t->slots), topk_slot_compare);
+  printf("\n  %s:\n", title);
+  if (t->used == 0) {
+    printf("    (none)\n");
+    return;
+  }
+  printf("    %-4s %-36s %12s %8s %12s\n", "#", "Key", "Entries", "Share",
+         "Bytes");
+  for (int i = 0; i < t->used && i < k; i++) {
+    const topk_slot_t *s = &t->slots[i];
+    char shown[40];
+    const size_t n = s->key_size < 33 ? s->key_size : 33;
+    snprintf(shown, sizeof(shown), "\"%.*s\"%s", (int)n, (const char *)s->key,
+             s->key_size > 33 ? "..." : "");
+    printf("    %-4d %-36s %12" PRIu64 " %7.2f%% %12" PRIu64 "%s\n", i + 1,
+           shown, s->count, percent_of(s->count, total), s->bytes,
+           s->error > 0 ? " ~" : "");
+  }
+}
+
+/* entry counts per seq window; when the seq span outgrows the windows,
+ * neighbouring windows are merged and the width doubles */
+typedef struct {
+  uint64_t base;
+  uint64_t width;
+  uint64_t counts[ADMINTOOL_SEQ_WINDOWS];
+  uint64_t earlier;
+  int started;
+} seq_windows_t;
+
+static void seq_windows_add(seq_windows_t *w, const uint64_t seq) {
+  if (!w->started) {
+    w->base = seq;
+    w->width = 1024;
+    w->started = 1;
+  }
+  if (seq < w->base) {
+    w->earlier++;
+    return;
+  }
+  while ((seq - w->base) / w->width >= ADMINTOOL_SEQ_WINDOWS) {
+    for (int i = 0; i < ADMINTOOL_SEQ_WINDOWS / 2; i++)
+      w->counts[i] = w->counts[2 * i] + w->counts[2 * i + 1];
+    memset(w->counts + ADMINTOOL_SEQ_WINDOWS / 2, 0,
+           sizeof(uint64_t) * (ADMINTOOL_SEQ_WINDOWS / 2));
+    w->width *= 2;
+  }
+  w->counts[(seq - w->base) / w->width]++;
+}
+
+static void print_size_histogram(const char *title, const uint64_t *hist,
+                                 const uint64_t total) {
+  printf("\n  %s:\n", title);
+  for (int b = 0; b < 33; b++) {
+    if (hist[b] == 0)
+      continue;
+    if (b == 0)
+      printf("    %10s   %-10s %12" PRIu64 " %6.1f%%\n", "0", "", hist[b],
+             percent_of(hist[b], total));
+    else
+      printf("    %10" PRIu64 " - %-10" PRIu64 " %12" PRIu64 " %6.1f%%\n",
+             (uint64_t)1 << (b - 1), ((uint64_t)1 << b) - 1, hist[b],
+             percent_of(hist[b], total));
+  }
+}
+
+static int size_bucket(uint64_t size) {
+  int bucket = 0;
+  while (size != 0 && bucket < 32) {
+    size >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+static int wal_id_compare(const void *a, const void *b) {
+  const int ia = parse_sstable_id(((const cf_file_t *)a)->name);
+  const int ib = parse_sstable_id(((const cf_file_t *)b)->name);
+  if (ia != ib)
+    return ia < ib ? -1 : 1;
+  return strcmp(((const cf_file_t *)a)->path, ((const cf_file_t *)b)->path);
+}
+
+static int cmd_wal_stats(const int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: wal-stats <wal_path|dir|glob>... [--top K] [--delim C]\n");
+    printf("Reports WAL traffic mix, size histograms and hot keys.\n");
+    return -1;
+  }
+
+  int k = 10;
+  char delim = ':';
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+      k = atoi(argv[++i]);
+      if (k < 1)
+        k = 1;
+      if (k > ADMINTOOL_TOPK_MAX)
+        k = ADMINTOOL_TOPK_MAX;
+    } else if (strcmp(argv[i], "--delim") == 0 && i + 1 < argc) {
+      delim = argv[++i][0];
+    }
+  }
+
+  static const char *const value_flags[] = {"--top", "--delim", NULL};
+  cf_file_t *files = NULL;
+  int count = 0;
+  if (collect_target_files(argv + 1, argc - 1, value_flags, ".log", &files,
+                           &count) != 0) {
+    free(files);
+    return -1;
+  }
+  if (count == 0) {
+    printf("No WAL files found\n");
+    return -1;
+  }
+  qsort(files, (size_t)count, sizeof(*files), wal_id_compare);
+
+  topk_t keys;
+  topk_t prefixes;
+  if (topk_init(&keys, k * 10) != 0 || topk_init(&prefixes, k * 10) != 0) {
+    printf("Out of memory\n");
+    topk_free(&keys);
+    free(files);
+    return -1;
+  }
+
+  seq_windows_t windows;
+  memset(&windows, 0, sizeof(windows));
+  uint64_t key_hist[33] = {0};
+  uint64_t value_hist[33] = {0};
+  uint64_t entries = 0;
+  uint64_t puts = 0;
+  uint64_t deletes = 0;
+  uint64_t ttl_entries = 0;
+  uint64_t key_bytes = 0;
+  uint64_t value_bytes = 0;
+  uint64_t bad_blocks = 0;
+  uint64_t min_seq = UINT64_MAX;
+  uint64_t max_seq = 0;
+  const uint64_t start = now_us();
+
+  for (int f = 0; f < count; f++) {
+    const uint64_t file_start = trace_now();
+    block_stream_t stream;
+    if (block_stream_open(&stream, files[f].path, 8, 0, 0) != 0) {
+      printf("Failed to open WAL file: %s\n", files[f].path);
+      bad_blocks++;
+      continue;
+    }
+    stream_block_t block;
+    klog_entry_t entry;
+    int rc;
+    while ((rc = block_stream_next(&stream, &block)) == 1) {
+      if (wal_decode_entry(block.data, block.size, &entry) != 0) {
+        bad_blocks++;
+        continue;
+      }
+      entries++;
+      if (entry.flags & TDB_KV_FLAG_TOMBSTONE)
+        deletes++;
+      else
+        puts++;
+      if (entry.flags & TDB_KV_FLAG_HAS_TTL)
+        ttl_entries++;
+      key_bytes += entry.key_size;
+      value_bytes += entry.value_size;
+      key_hist[size_bucket(entry.key_size)]++;
+      value_hist[size_bucket(entry.value_size)]++;
+      if (entry.seq < min_seq)
+        min_seq = entry.seq;
+      if (entry.seq > max_seq)
+        max_seq = entry.seq;
+      seq_windows_add(&windows, entry.seq);
+
+      const uint64_t weight = entry.key_size + entry.value_size;
+      topk_add(&keys, entry.key, (size_t)entry.key_size, weight);
+      const uint8_t *sep = memchr(entry.key, delim, (size_t)entry.key_size);
+      const size_t prefix_size =
+          sep ? (size_t)(sep - entry.key) + 1 : (size_t)entry.key_size;
+      topk_add(&prefixes, entry.key, prefix_size, weight);
+    }
+    if (rc < 0)
+      bad_blocks++;
+    block_stream_close(&stream);
+    trace_span("wal-stats", files[f].name, file_start, NULL);
+  }
+
+  printf("WAL Statistics: %d files\n", count);
+  printf("  Entries: %" PRIu64 "\n", entries);
+  printf("  Puts: %" PRIu64 " (%.1f%%), Deletes: %" PRIu64 " (%.1f%%)\n", puts,
+         percent_of(puts, entries), deletes, percent_of(deletes, entries));
+  printf("  With TTL: %" PRIu64 " (%.1f%%)\n", ttl_entries,
+         percent_of(ttl_entries, entries));
+  if (entries > 0) {
+    printf("  Key Bytes: %" PRIu64 " (avg %.1f), Value Bytes: %" PRIu64
+           " (avg %.1f)\n",
+           key_bytes, (double)key_bytes / (double)entries, value_bytes,
+           (double)value_bytes / (double)entries);
+    printf("  Sequence Range: %" PRIu64 " - %" PRIu64 "\n", min_seq, max_seq);
+  }
+  if (bad_blocks > 0)
+    printf("  Unreadable Blocks: %" PRIu64 " (run wal-verify)\n", bad_blocks);
+
+  print_size_histogram("Key Size Histogram", key_hist, entries);
+  print_size_histogram("Value Size Histogram", value_hist, entries);
+
+  char title[64];
+  snprintf(title, sizeof(title), "Top %d Keys", k);
+  topk_print(&keys, title, k, entries);
+  snprintf(title, sizeof(title), "Top %d Prefixes (delimiter '%c')", k,
+           delim);
+  topk_print(&prefixes, title, k, entries);
+  if (keys.used > 0)
+    printf("  (~ marks an estimate that may overcount; tracked with %d "
+           "counters)\n",
+           keys.capacity);
+
+  if (windows.started) {
+    printf("\n  Entries per Seq Window (width %" PRIu64 "):\n", windows.width);
+    printf("    %-29s %12s %8s\n", "Seq Range", "Entries", "Density");
+    for (int i = 0; i < ADMINTOOL_SEQ_WINDOWS; i++) {
+      if (windows.counts[i] == 0)
+        continue;
+      const uint64_t lo = windows.base + (uint64_t)i * windows.width;
+      char range[48];
+      snprintf(range, sizeof(range), "%" PRIu64 " - %" PRIu64, lo,
+               lo + windows.width - 1);
+      printf("    %-29s %12" PRIu64 " %7.1f%%\n", range, windows.counts[i],
+             percent_of(windows.counts[i], windows.width));
+    }
+    if (windows.earlier > 0)
+      printf("    (%" PRIu64 " entries below seq %" PRIu64 ")\n",
+             windows.earlier, windows.base);
+  }
+
+  printf("\n  Elapsed: %.2f s\n", (double)(now_us() - start) / 1e6);
+
+  topk_free(&keys);
+  topk_free(&prefixes);
+  free(files);
+  return 0;
+}
+
+static int cmd_level_info(const int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: level-info <cf>\n");
+    return -1;
+  }
+
+  if (g_db == NULL) {
+    printf("No database is open.\n");
+    return -1;
+  }
+
+  tidesdb_column_family_t *cf = tidesdb_get_column_family(g_db, argv[1]);
+  if (cf == NULL) {
+    printf("Column family '%s' not found.\n", argv[1]);
+    return -1;
+  }
+
+  tidesdb_stats_t *stats = NULL;
+  const int ret = tidesdb_get_stats(cf, &stats);
+  if (ret != TDB_SUCCESS) {
+    printf("Failed to get stats: %s\n", error_to_string(ret));
+    return ret;
+  }
+
+  printf("Level Information for '%s':\n", argv[1]);
+  printf("  Memtable Size: %zu bytes (%.2f MB)\n", stats->memtable_size,
+         (double)stats->memtable_size / (1024 * 1024));
+  printf("  Number of Levels: %d\n\n", stats->num_levels);
+
+  uint64_t total_size = 0;
+  int total_sstables = 0;
+
+  for (int i = 0; i < stats->num_levels; i++) {
+    printf("  Level %d:\n", i + 1);
+    printf("    SSTables: %d\n", stats->level_num_sstables[i]);
+    printf("    Size: %zu bytes (%.2f MB)\n", stats->level_sizes[i],
+           (double)stats->level_sizes[i] / (1024 * 1024));
+
+    total_size += stats->level_sizes[i];
+    total_sstables += stats->level_num_sstables[i];
+  }
+
+  printf("\n  Total SSTables: %d\n", total_sstables);
+  printf("  Total Disk Size: %" PRIu64 " bytes (%.2f MB)\n", total_size,
+         (double)total_size / (1024 * 1024));
+
+  tidesdb_free_stats(stats);
+  return 0;
+}
+
+typedef struct {
+  uint64_t *items;
+  size_t count;
+  size_t cap;
+} offset_set_t;
+
+static int offset_set_add(offset_set_t *set, const uint64_t offset) {
+  if (set->count == set->cap) {
+    const size_t new_cap = set->cap ? set->cap * 2 : 256;
+    uint64_t *grown = realloc(set->items, new_cap * sizeof(uint64_t));
+    if (!grown)
+      return -1;
+    set->items = grown;
+    set->cap = new_cap;
+  }
+  set->items[set->count++] = offset;
+  return 0;
+}
+
+static int uint64_compare(const void *a, const void *b) {
+  const uint64_t va = *(const uint64_t *)a;
+  const uint64_t vb = *(const uint64_t *)b;
+  return va < vb ? -1 : (va > vb ? 1 : 0);
+}
+
+static void offset_set_finish(offset_set_t *set) {
+  if (set->count == 0)
+    return;
+  qsort(set->items, set->count, sizeof(uint64_t), uint64_compare);
+  size_t unique = 1;
+  for (size_t i = 1; i < set->count; i++) {
+    if (set->items[i] != set->items[unique - 1])
+      set->items[unique++] = set->items[i];
+  }
+  set->count = unique;
+}
+
+static int offset_set_contains(const offset_set_t *set, const uint64_t offset) {
+  return set->count > 0 && bsearch(&offset, set->items, set->count,
+                                   sizeof(uint64_t), uint64_compare) != NULL;
+}
+
+static void offset_set_free(offset_set_t *set) {
+  free(set->items);
+  memset(set, 0, sizeof(*set));
+}
+
+static void vlog_path_for_klog(const char *klog_path, char *out,
+                               const size_t out_size) {
+  snprintf(out, out_size, "%s", klog_path);
+  const size_t len = strlen(out);
+  if (len >= 5 && strcmp(out + len - 5, ".klog") == 0)
+    memcpy(out + len - 5, ".vlog", 5);
+}
+
+#define VERIFY_MANIFEST_NAME ".verify-manifest"
+#define VERIFY_MANIFEST_HEADER "# admintool verify manifest v1"
+#define FILE_HASH_BUFFER_SIZE (1024 * 1024)
+
+static void format_xxh128(const XXH128_hash_t hash, char out[33]) {
+  snprintf(out, 33, "%016" PRIx64 "%016" PRIx64, hash.high64, hash.low64);
+}
+
+static int parse_xxh128(const char *hex, XXH128_hash_t *out) {
+  char half[17];
+  if (strlen(hex) != 32)
+    return -1;
+  memcpy(half, hex, 16);
+  half[16] = '\0';
+  char *end;
+  out->high64 = strtoull(half, &end, 16);
+  if (*end != '\0')
+    return -1;
+  out->low64 = strtoull(hex + 16, &end, 16);
+  return *end == '\0' ? 0 : -1;
+}
+
+/* XXH3-128 of the first size bytes of a file, so a WAL that grows while it
+ * is hashed still matches the size that was recorded; the file is mapped
+ * and hashed in one pass, with buffered reads as the fallback */
+static int file_xxh3(const char *path, const uint64_t size,
+                     XXH128_hash_t *out) {
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return -1;
+#ifndef _WIN32
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < size) {
+    close(fd);
+    return -1;
+  }
+  if (size > 0 && size <= (uint64_t)SIZE_MAX) {
+    void *map = mmap(NULL, (size_t)size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+      madvise(map, (size_t)size, MADV_SEQUENTIAL);
+#endif
+      *out = XXH3_128bits(map, (size_t)size);
+      munmap(map, (size_t)size);
+      close(fd);
+      return 0;
+    }
+  }
+#endif
+  uint8_t *buf = malloc(FILE_HASH_BUFFER_SIZE);
+  XXH3_state_t *state = XXH3_createState();
+  if (!buf || !state) {
+    free(buf);
+    if (state)
+      XXH3_freeState(state);
+    close(fd);
+    return -1;
+  }
+  XXH3_128bits_reset(state);
+
+  uint64_t done = 0;
+  int rc = 0;
+  while (done < size) {
+    const uint64_t left = size - done;
+    const size_t want =
+        left < FILE_HASH_BUFFER_SIZE ? (size_t)left : FILE_HASH_BUFFER_SIZE;
+    const ssize_t n = pread(fd, buf, want, (off_t)done);
+    if (n <= 0) {
+      rc = -1;
+      break;
+    }
+    XXH3_128bits_update(state, buf, (size_t)n);
+    done += (uint64_t)n;
+  }
+  if (rc == 0)
+    *out = XXH3_128bits_digest(state);
+  XXH3_freeState(state);
+  free(buf);
+  close(fd);
+  return rc;
+}
+
+static int64_t stat_mtime_ns(const struct stat *st) {
+#if defined(__linux__)
+  return (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+#elif defined(__APPLE__)
+  return (int64_t)st->st_mtimespec.tv_sec * 1000000000 +
+         st->st_mtimespec.tv_nsec;
+#else
+  return (int64_t)st->st_mtime * 1000000000;
+#endif
+}
+
+typedef struct {
+  char name[256];
+  uint64_t size;
+  int64_t mtime_ns;
+  XXH128_hash_t hash;
+  int64_t verified_at;
+} verify_stamp_t;
+
+/* last clean verification of each file of a column family, sorted by name */
+typedef struct {
+  verify_stamp_t *items;
+  int count;
+  int cap;
+} verify_manifest_t;
+
+static int verify_stamp_compare(const void *a, const void *b) {
+  return strcmp(((const verify_stamp_t *)a)->name,
+                ((const verify_stamp_t *)b)->name);
+}
+
+static int verify_stamp_init(verify_stamp_t *stamp, const char *path,
+                             const char *name) {
+  struct stat st;
+  memset(stamp, 0, sizeof(*stamp));
+  if (stat(path, &st) != 0)
+    return -1;
+  snprintf(stamp->name, sizeof(stamp->name), "%s", name);
+  stamp->size = (uint64_t)st.st_size;
+  stamp->mtime_ns = stat_mtime_ns(&st);
+  return 0;
+}
+
+static int verify_manifest_add(verify_manifest_t *m,
+                               const verify_stamp_t *stamp) {
+  if (m->count == m->cap) {
+    const int new_cap = m->cap ? m->cap * 2 : 64;
+    verify_stamp_t *grown =
+        realloc(m->items, sizeof(*m->items) * (size_t)new_cap);
+    if (grown == NULL)
+      return -1;
+    m->items = grown;
+    m->cap = new_cap;
+  }
+  m->items[m->count++] = *stamp;
+  return 0;
+}
+
+static void verify_manifest_free(verify_manifest_t *m) {
+  free(m->items);
+  memset(m, 0, sizeof(*m));
+}
+
+/* a missing manifest is an empty one; malformed lines are ignored so the
+ * affected files are simply verified again */
+static void verify_manifest_load(verify_manifest_t *m, const char *path) {
+  memset(m, 0, sizeof(*m));
+  FILE *fp = fopen(path, "r");
+  if (fp == NULL)
+    return;
+  char line[512];
+  while (fgets(line, sizeof(line), fp)) {
+    if (line[0] == '#')
+      continue;
+    verify_stamp_t stamp;
+    char hex[64];
+    memset(&stamp, 0, sizeof(stamp));
+    if (sscanf(line, "%255s %" SCNu64 " %" SCNd64 " %63s %" SCNd64,
+               stamp.name, &stamp.size, &stamp.mtime_ns, hex,
+               &stamp.verified_at) != 5 ||
+        parse_xxh128(hex, &stamp.hash) != 0)
+      continue;
+    if (verify_manifest_add(m, &stamp) != 0)
+      break;
+  }
+  fclose(fp);
+  if (m->count > 0)
+    qsort(m->items, (size_t)m->count, sizeof(*m->items),
+          verify_stamp_compare);
+}
+
+static const verify_stamp_t *verify_manifest_find(const verify_manifest_t *m,
+                                                  const char *name) {
+  if (m->count == 0)
+    return NULL;
+  verify_stamp_t key;
+  snprintf(key.name, sizeof(key.name), "%s", name);
+  return bsearch(&key, m->items, (size_t)m->count, sizeof(*m->items),
+                 verify_stamp_compare);
+}
+
+/* written beside the column family and renamed into place */
+static int verify_manifest_save(const verify_manifest_t *m, const char *path) {
+  char tmp[4096 + 8];
+  if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp))
+    return -1;
+  FILE *fp = fopen(tmp, "w");
+  if (fp == NULL)
+    return -1;
+  fprintf(fp, "%s\n", VERIFY_MANIFEST_HEADER);
+  fprintf(fp, "# name size mtime_ns xxh3_128 verified_at\n");
+  for (int i = 0; i < m->count; i++) {
+    const verify_stamp_t *s = &m->items[i];
+    char hex[33];
+    format_xxh128(s->hash, hex);
+    fprintf(fp, "%s %" PRIu64 " %" PRId64 " %s %" PRId64 "\n", s->name,
+            s->size, s->mtime_ns, hex, s->verified_at);
+  }
+  int rc = fflush(fp) == 0 && fsync(fileno(fp)) == 0 ? 0 : -1;
+  if (fclose(fp) != 0)
+    rc = -1;
+  if (rc == 0 && rename(tmp, path) == 0) {
+    fsync_parent_dir(path);
+    return 0;
+  }
+  unlink(tmp);
+  return -1;
+}
+
+/* unchanged means same size and mtime as when the file last verified clean */
+static int verify_stamp_unchanged(const verify_stamp_t *now,
+                                  const verify_stamp_t *last) {
+  return last != NULL && now->size == last->size &&
+         now->mtime_ns == last->mtime_ns;
+}
+
+enum { DEEP_KLOG, DEEP_WAL, DEEP_VLOG };
+
+typedef struct {
+  cf_file_t file;
+  int kind;
+  uint64_t bytes;
+  uint64_t blocks;
+  uint64_t entries;
+  uint64_t checksum_errors;
+  uint64_t decode_errors;
+  uint64_t order_errors;
+  uint64_t bloom_misses;
+  uint64_t index_errors;
+  uint64_t seq_regressions;
+  uint64_t vlog_refs;
+  uint64_t vlog_dangling;
+  uint64_t elapsed_us;
+  verify_stamp_t stamp;
+  verify_stamp_t vlog_stamp; /* paired vlog of a klog, if it has one */
+  verify_stamp_t previous;
+  verify_stamp_t vlog_previous;
+  XXH3_state_t *hash; /* fed by the verify pass to fingerprint the file */
+  int has_vlog;
+  int has_previous;
+  int has_vlog_previous;
+  int skipped;
+  int hash_failed;
+  int hash_mismatch;
+  int no_bloom;
+  int truncated;
+  int failed;
+} deep_verify_t;
+
+typedef struct {
+  deep_verify_t *results;
+  int check_order;
+  int64_t now;
+} deep_verify_ctx_t;
+
+/* hashes the file's stamped size as the stream reads it */
+static void deep_verify_hash_begin(block_stream_t *stream, deep_verify_t *r,
+                                   const verify_stamp_t *stamp) {
+  if (stamp->name[0] == '\0' ||
+      block_stream_hash(stream, r->hash, stamp->size) != 0)
+    r->hash_failed = 1;
+}
+
+static void deep_verify_hash_end(block_stream_t *stream, deep_verify_t *r,
+                                 verify_stamp_t *stamp) {
+  if (stream->hash && block_stream_hash_digest(stream, &stamp->hash) != 0)
+    r->hash_failed = 1;
+}
+
+/* streams a vlog, counting checksum failures and resolving the sorted
+ * reference offsets in one merge pass; returns -1 if it cannot be read */
+static int deep_verify_vlog(const char *path, const uint64_t *refs,
+                            const size_t ref_count, deep_verify_t *r,
+                            verify_stamp_t *stamp) {
+  block_stream_t stream;
+  if (block_stream_open(&stream, path, 8, 0, 0) != 0) {
+    r->vlog_dangling += ref_count;
+    return -1;
+  }
+  r->bytes += stream.file_size;
+  deep_verify_hash_begin(&stream, r, stamp);
+
+  size_t next = 0;
+  stream_block_t block;
+  int rc;
+  while ((rc = block_stream_next(&stream, &block)) == 1) {
+    const uint64_t block_start = trace_now();
+    r->blocks++;
+    const int valid =
+        compute_block_checksum(block.data, block.size) == block.checksum;
+    if (!valid)
+      r->checksum_errors++;
+    while (next < ref_count && refs[next] < block.offset) {
+      r->vlog_dangling++;
+      next++;
+    }
+    while (next < ref_count && refs[next] == block.offset)
+      next++;
+    trace_span("verify", "block", block_start,
+               "offset=%" PRIu64 " size=%u valid=%d", block.offset,
+               block.size, valid);
+  }
+  if (rc < 0)
+    r->truncated = 1;
+  r->vlog_dangling += ref_count - next;
+  deep_verify_hash_end(&stream, r, stamp);
+  block_stream_close(&stream);
+  return 0;
+}
+
+static void deep_verify_klog(const deep_verify_ctx_t *ctx, deep_verify_t *r) {
+  block_manager_t *bm = NULL;
+  if (block_manager_open(&bm, r->file.path, BLOCK_MANAGER_SYNC_NONE) != 0) {
+    r->failed = 1;
+    return;
+  }
+  const int block_count = block_manager_count_blocks(bm);
+  block_manager_close(bm);
+  if (block_count < KLOG_TRAILER_BLOCKS) {
+    r->failed = 1;
+    return;
+  }
+  const int data_blocks = block_count - KLOG_TRAILER_BLOCKS;
+
+  bloom_filter_t *bloom = data_blocks > 0 ? klog_read_bloom(r->file.path)
+                                          : NULL;
+  r->no_bloom = data_blocks > 0 && bloom == NULL;
+
+  block_stream_t stream;
+  if (block_stream_open(&stream, r->file.path, 8, 0, 0) != 0) {
+    if (bloom)
+      bloom_filter_free(bloom);
+    r->failed = 1;
+    return;
+  }
+  r->bytes += stream.file_size;
+  deep_verify_hash_begin(&stream, r, &r->stamp);
+
+  offset_set_t refs = {0};
+  strbuf_t prev_key = {0};
+  int have_prev = 0;
+  int index = 0;
+  stream_block_t block;
+  int rc;
+  while ((rc = block_stream_next(&stream, &block)) == 1) {
+    const uint64_t block_start = trace_now();
+    r->blocks++;
+    const int position = index++;
+    const int valid =
+        compute_block_checksum(block.data, block.size) == block.checksum;
+    if (!valid) {
+      r->checksum_errors++;
+    } else if (position == data_blocks) {
+      if (data_blocks > 0 && block.size == 0)
+        r->index_errors++;
+    } else if (position < data_blocks) {
+      const uint8_t *ptr = block.data;
+      size_t remaining = block.size;
+      uint64_t prev_seq = 0;
+      klog_entry_t entry;
+      while (remaining > 0) {
+        if (klog_decode_entry(&ptr, &remaining, &prev_seq, &entry) != 0) {
+          r->decode_errors++;
+          break;
+        }
+        r->entries++;
+        if (ctx->check_order && have_prev &&
+            compare_keys(entry.key, (size_t)entry.key_size,
+                         (const uint8_t *)prev_key.data, prev_key.len) <= 0)
+          r->order_errors++;
+        prev_key.len = 0;
+        strbuf_append(&prev_key, (const char *)entry.key,
+                      (size_t)entry.key_size);
+        have_prev = 1;
+        if (bloom && !bloom_filter_contains(bloom, entry.key,
+                                            (size_t)entry.key_size))
+          r->bloom_misses++;
+        if (entry.flags & TDB_KV_FLAG_HAS_VLOG) {
+          r->vlog_refs++;
+          offset_set_add(&refs, entry.vlog_offset);
+        }
+      }
+    }
+    trace_span("verify", "block", block_start,
+               "offset=%" PRIu64 " size=%u valid=%d", block.offset,
+               block.size, valid);
+  }
+  if (rc < 0 || index != block_count)
+    r->truncated = 1;
+  deep_verify_hash_end(&stream, r, &r->stamp);
+  block_stream_close(&stream);
+  strbuf_free(&prev_key);
+  if (bloom)
+    bloom_filter_free(bloom);
+
+  char vlog_path[4096];
+  vlog_path_for_klog(r->file.path, vlog_path, sizeof(vlog_path));
+  struct stat st;
+  if (stat(vlog_path, &st) == 0) {
+    offset_set_finish(&refs);
+    deep_verify_vlog(vlog_path, refs.items, refs.count, r, &r->vlog_stamp);
+  } else {
+    r->vlog_dangling += r->vlog_refs;
+  }
+  offset_set_free(&refs);
+}
+
+static uint64_t deep_verify_problems(const deep_verify_t *r) {
+  return r->checksum_errors + r->decode_errors + r->order_errors +
+         r->bloom_misses + r->index_errors + r->seq_regressions +
+         r->vlog_dangling + (uint64_t)r->truncated + (uint64_t)r->failed +
+         (uint64_t)r->hash_mismatch;
+}
+
+/* a file whose size and mtime match its last manifest entry but whose
+ * content hash doesn't was changed underneath the filesystem metadata */
+static void deep_verify_stamp(verify_stamp_t *stamp,
+                              const verify_stamp_t *previous,
+                              const int64_t now, deep_verify_t *r) {
+  stamp->verified_at = now;
+  if (verify_stamp_unchanged(stamp, previous) &&
+      (stamp->hash.low64 != previous->hash.low64 ||
+       stamp->hash.high64 != previous->hash.high64))
+    r->hash_mismatch = 1;
+}
+
+static void deep_verify_worker(void *arg, const int index) {
+  deep_verify_ctx_t *ctx = arg;
+  deep_verify_t *r = &ctx->results[index];
+  if (r->skipped)
+    return;
+  const uint64_t file_start = trace_now();
+  const uint64_t start = now_us();
+  r->hash = XXH3_createState();
+  if (r->hash == NULL) {
+    r->failed = 1;
+    return;
+  }
+
+  if (r->kind == DEEP_KLOG) {
+    deep_verify_klog(ctx, r);
+  } else if (r->kind == DEEP_WAL) {
+    wal_verify_t wal;
+    memset(&wal, 0, sizeof(wal));
+    wal.file = r->file;
+    if (r->stamp.name[0] != '\0') {
+      wal.hash = r->hash;
+      wal.hash_end = r->stamp.size;
+    } else {
+      r->hash_failed = 1;
+    }
+    wal_verify_worker(&wal, 0);
+    r->stamp.hash = wal.digest;
+    r->hash_failed |= wal.hash_failed;
+    r->bytes = r->file.file_size;
+    r->blocks = wal.blocks;
+    r->entries = wal.valid_entries;
+    r->checksum_errors = wal.checksum_errors;
+    r->decode_errors = wal.structure_errors;
+    r->seq_regressions = wal.seq_regressions;
+    r->truncated = wal.truncated || wal.bad_header;
+    r->failed = wal.failed;
+  } else if (deep_verify_vlog(r->file.path, NULL, 0, r, &r->stamp) != 0) {
+    r->failed = 1;
+  }
+  XXH3_freeState(r->hash);
+  r->hash = NULL;
+
+  if (deep_verify_problems(r) == 0 && !r->hash_failed) {
+    deep_verify_stamp(&r->stamp, r->has_previous ? &r->previous : NULL,
+                      ctx->now, r);
+    if (r->has_vlog)
+      deep_verify_stamp(&r->vlog_stamp,
+                        r->has_vlog_previous ? &r->vlog_previous : NULL,
+                        ctx->now, r);
+  }
+
+  r->elapsed_us = now_us() - start;
+  trace_span("verify", r->file.name, file_start, "deep=1 bytes=%" PRIu64,
+             r->bytes);
+}
+
+static int deep_verify_add(deep_verify_t **results, int *count, int *cap,
+                           const cf_file_t *files, const int n,
+                           const int kind, const char *cf_path) {
+  for (int i = 0; i < n; i++) {
+    if (kind == DEEP_VLOG) {
+      /* vlogs that belong to a klog are checked with it */
+      char klog[4096];
+      snprintf(klog, sizeof(klog), "%s/%.*s.klog", cf_path,
+               (int)strlen(files[i].name) - 5, files[i].name);
+      struct stat st;
+      if (stat(klog, &st) == 0)
+        continue;
+    }
+    if (*count == *cap) {
+      const int new_cap = *cap ? *cap * 2 : 64;
+      deep_verify_t *grown =
+          realloc(*results, sizeof(**results) * (size_t)new_cap);
+      if (grown == NULL)
+        return -1;
+      *results = grown;
+      *cap = new_cap;
+    }
+    deep_verify_t *r = &(*results)[(*count)++];
+    memset(r, 0, sizeof(*r));
+    r->file = files[i];
+    r->kind = kind;
+  }
+  return 0;
+}
+
+typedef struct {
+  const cf_file_t *files;
+  bloom_audit_t *results;
+} bloom_audit_ctx_t;
+
+static void bloom_audit_worker(void *arg, const int index) {
+  bloom_audit_ctx_t *ctx = arg;
+  const uint64_t file_start = trace_now();
+  bloom_audit_klog(ctx->files[index].path, &ctx->results[index]);
+  trace_span("verify", ctx->files[index].name, file_start,
+             "bloom=1 keys=%" PRIu64, ctx->results[index].keys);
+}
+
+static int verify_bloom(const char *cf_name, const char *cf_path,
+                        const int threads) {
+  cf_file_t *files = NULL;
+  int count = 0;
+  if (list_cf_files(cf_path, ".klog", &files, &count) != 0) {
+    printf("Failed to open column family directory: %s\n", cf_path);
+    return -1;
+  }
+  bloom_audit_ctx_t ctx = {.files = files,
+                           .results = calloc(count ? (size_t)count : 1,
+                                             sizeof(bloom_audit_t))};
+  if (ctx.results == NULL) {
+    printf("Out of memory\n");
+    free(files);
+    return -1;
+  }
+
+  printf("Auditing bloom filters of column family '%s' (%d SSTables, %d "
+         "threads)...\n",
+         cf_name, count, threads);
+  const uint64_t start = now_us();
+  run_parallel(count, threads, bloom_audit_worker, &ctx);
+  const uint64_t elapsed = now_us() - start;
+
+  uint64_t keys = 0;
+  uint64_t bytes = 0;
+  uint64_t misses = 0;
+  int bad = 0;
+  for (int i = 0; i < count; i++) {
+    bloom_audit_t *r = &ctx.results[i];
+    keys += r->keys;
+    bytes += r->bytes;
+    misses += r->misses;
+    if (r->failed || r->truncated || r->misses || r->checksum_errors ||
+        r->decode_errors) {
+      bad++;
+      printf("  %s: ", files[i].name);
+      if (r->failed)
+        printf("cannot read\n");
+      else if (r->truncated)
+        printf("truncated after %" PRIu64 " of %" PRIu64
+               " data blocks, %" PRIu64 " of %" PRIu64
+               " keys absent from filter\n%s",
+               r->blocks, r->data_blocks, r->misses, r->keys,
+               r->missing.len ? r->missing.data : "");
+      else
+        printf("%" PRIu64 " of %" PRIu64 " keys absent from filter, %" PRIu64
+               " bad blocks\n%s",
+               r->misses, r->keys, r->checksum_errors + r->decode_errors,
+               r->missing.len ? r->missing.data : "");
+    } else if (r->no_bloom) {
+      printf("  %s: no bloom filter\n", files[i].name);
+    }
+    strbuf_free(&r->missing);
+  }
+
+  const double secs = (double)elapsed / 1e6;
+  printf("\nBloom Audit Results:\n");
+  printf("  SSTables: %d audited, %d with issues\n", count, bad);
+  printf("  Keys Probed: %" PRIu64 "\n", keys);
+  printf("  False Negatives: %" PRIu64 "\n", misses);
+  printf("  Time: %.1f ms (%.1f MB/s)\n", (double)elapsed / 1000.0,
+         secs > 0 ? (double)bytes / (1024 * 1024) / secs : 0.0);
+  printf("  Status: %s\n", bad == 0 ? "OK" : "ISSUES FOUND");
+  free(ctx.results);
+  free(files);
+  return bad == 0 ? 0 : -1;
+}
+
+/* stamps every file and marks those that are unchanged since they last
+ * verified clean; a klog is only skipped when its vlog is unchanged too */
+static void deep_verify_plan(deep_verify_t *results, const int count,
+                             const verify_manifest_t *manifest,
+                             const int full) {
+  for (int i = 0; i < count; i++) {
+    deep_verify_t *r = &results[i];
+    const verify_stamp_t *last = verify_manifest_find(manifest, r->file.name);
+    if (verify_stamp_init(&r->stamp, r->file.path, r->file.name) != 0)
+      continue;
+    if (last) {
+      r->previous = *last;
+      r->has_previous = 1;
+    }
+    int unchanged = verify_stamp_unchanged(&r->stamp, last);
+
+    if (r->kind == DEEP_KLOG) {
+      char vlog_path[4096];
+      vlog_path_for_klog(r->file.path, vlog_path, sizeof(vlog_path));
+      const char *vlog_name = strrchr(vlog_path, '/');
+      vlog_name = vlog_name ? vlog_name + 1 : vlog_path;
+      if (verify_stamp_init(&r->vlog_stamp, vlog_path, vlog_name) == 0) {
+        const verify_stamp_t *vlog_last =
+            verify_manifest_find(manifest, vlog_name);
+        r->has_vlog = 1;
+        if (vlog_last) {
+          r->vlog_previous = *vlog_last;
+          r->has_vlog_previous = 1;
+        }
+        unchanged = unchanged &&
+                    verify_stamp_unchanged(&r->vlog_stamp, vlog_last);
+      }
+    }
+    r->skipped = unchanged && !full;
+  }
+}
+
+static int verify_deep(const char *cf_name, tidesdb_column_family_t *cf,
+                       const char *cf_path, const int threads,
+                       const int full) {
+  deep_verify_ctx_t ctx = {
+      .results = NULL, .check_order = 1, .now = (int64_t)time(NULL)};
+  tidesdb_stats_t *stats = NULL;
+  if (tidesdb_get_stats(cf, &stats) == TDB_SUCCESS && stats) {
+    const char *cmp = stats->config ? stats->config->comparator_name : "";
+    if (cmp[0] != '\0' && strcmp(cmp, "memcmp") != 0)
+      ctx.check_order = 0;
+    tidesdb_free_stats(stats);
+  }
+
+  static const char *const suffixes[] = {".klog", ".log", ".vlog"};
+  static const int kinds[] = {DEEP_KLOG, DEEP_WAL, DEEP_VLOG};
+  int count = 0;
+  int cap = 0;
+  for (int k = 0; k < 3; k++) {
+    cf_file_t *files = NULL;
+    int n = 0;
+    if (list_cf_files(cf_path, suffixes[k], &files, &n) != 0) {
+      printf("  Status: FAILED (cannot open directory)\n");
+      free(files);
+      free(ctx.results);
+      return -1;
+    }
+    const int rc = deep_verify_add(&ctx.results, &count, &cap, files, n,
+                                   kinds[k], cf_path);
+    free(files);
+    if (rc != 0) {
+      printf("Out of memory\n");
+      free(ctx.results);
+      return -1;
+    }
+  }
+
+  char manifest_path[4096];
+  snprintf(manifest_path, sizeof(manifest_path), "%s/%s", cf_path,
+           VERIFY_MANIFEST_NAME);
+  verify_manifest_t manifest;
+  verify_manifest_load(&manifest, manifest_path);
+  deep_verify_plan(ctx.results, count, &manifest, full);
+  verify_manifest_free(&manifest);
+
+  int skipped = 0;
+  uint64_t skipped_bytes = 0;
+  for (int i = 0; i < count; i++) {
+    if (ctx.results[i].skipped) {
+      skipped++;
+      skipped_bytes += ctx.results[i].stamp.size +
+                       (ctx.results[i].has_vlog ? ctx.results[i].vlog_stamp.size
+                                                : 0);
+    }
+  }
+
+  printf("Deep-verifying column family '%s' (%d of %d files, %d "
+         "threads)...\n",
+         cf_name, count - skipped, count, threads);
+  if (!ctx.check_order)
+    printf("  (custom comparator: key ordering not checked)\n");
+
+  const uint64_t start = now_us();
+  run_parallel(count, threads, deep_verify_worker, &ctx);
+  const uint64_t elapsed = now_us() - start;
+
+  deep_verify_t total;
+  memset(&total, 0, sizeof(total));
+  uint64_t bad_files = 0;
+  printf("\n  %-24s %12s %10s %9s %12s  %s\n", "File", "Bytes", "Time ms",
+         "MB/s", "Entries", "Result");
+  for (int i = 0; i < count; i++) {
+    const deep_verify_t *r = &ctx.results[i];
+    if (r->skipped)
+      continue;
+    const double secs = (double)r->elapsed_us / 1e6;
+    printf("  %-24s %12" PRIu64 " %10.1f %9.1f %12" PRIu64 "  ", r->file.name,
+           r->bytes, (double)r->elapsed_us / 1000.0,
+           secs > 0 ? (double)r->bytes / (1024 * 1024) / secs : 0.0,
+           r->entries);
+    strbuf_t issues = {0};
+    if (r->failed)
+      strbuf_printf(&issues, ", cannot read");
+    if (r->checksum_errors)
+      strbuf_printf(&issues, ", %" PRIu64 " bad checksums", r->checksum_errors);
+    if (r->decode_errors)
+      strbuf_printf(&issues, ", %" PRIu64 " undecodable", r->decode_errors);
+    if (r->order_errors)
+      strbuf_printf(&issues, ", %" PRIu64 " out of order", r->order_errors);
+    if (r->bloom_misses)
+      strbuf_printf(&issues, ", %" PRIu64 " missing from bloom",
+                    r->bloom_misses);
+    if (r->index_errors)
+      strbuf_printf(&issues, ", empty index");
+    if (r->seq_regressions)
+      strbuf_printf(&issues, ", %" PRIu64 " seq regressions",
+                    r->seq_regressions);
+    if (r->vlog_dangling)
+      strbuf_printf(&issues, ", %" PRIu64 "/%" PRIu64 " dangling vlog refs",
+                    r->vlog_dangling, r->vlog_refs);
+    if (r->truncated)
+      strbuf_printf(&issues, ", truncated");
+    if (r->hash_mismatch)
+      strbuf_printf(&issues, ", content changed since last verify");
+    printf("%s%s\n", issues.len ? issues.data + 2 : "ok",
+           r->no_bloom ? " (no bloom filter)" : "");
+    strbuf_free(&issues);
+
+    if (deep_verify_problems(r) > 0)
+      bad_files++;
+    total.bytes += r->bytes;
+    total.blocks += r->blocks;
+    total.entries += r->entries;
+    total.checksum_errors += r->checksum_errors;
+    total.decode_errors += r->decode_errors;
+    total.order_errors += r->order_errors;
+    total.bloom_misses += r->bloom_misses;
+    total.index_errors += r->index_errors;
+    total.seq_regressions += r->seq_regressions;
+    total.vlog_refs += r->vlog_refs;
+    total.vlog_dangling += r->vlog_dangling;
+    total.truncated += r->truncated;
+    total.failed += r->failed;
+    total.hash_mismatch += r->hash_mismatch;
+  }
+
+  /* files that verified clean or were skipped keep an entry; files with
+   * issues and files that no longer exist drop out and are rechecked */
+  verify_manifest_t updated = {0};
+  for (int i = 0; i < count; i++) {
+    const deep_verify_t *r = &ctx.results[i];
+    if (r->skipped) {
+      verify_manifest_add(&updated, &r->previous);
+      if (r->has_vlog)
+        verify_manifest_add(&updated, &r->vlog_previous);
+    } else if (deep_verify_problems(r) == 0 && !r->hash_failed) {
+      verify_manifest_add(&updated, &r->stamp);
+      if (r->has_vlog)
+        verify_manifest_add(&updated, &r->vlog_stamp);
+    }
+  }
+  /* a shadow open must not write into the database directory */
+  const int saved =
+      g_db_shadow ? 0 : verify_manifest_save(&updated, manifest_path);
+  verify_manifest_free(&updated);
+
+  const double secs = (double)elapsed / 1e6;
+  printf("\nDeep Verification Results:\n");
+  printf("  Files: %d checked, %" PRIu64 " with issues\n", count - skipped,
+         bad_files);
+  printf("  Skipped (unchanged since last verify): %d files, %" PRIu64
+         " bytes\n",
+         skipped, skipped_bytes);
+  printf("  Blocks: %" PRIu64 ", Entries: %" PRIu64
+         ", Vlog References: %" PRIu64 "\n",
+         total.blocks, total.entries, total.vlog_refs);
+  printf("  Checksum Errors: %" PRIu64 "\n", total.checksum_errors);
+  printf("  Undecodable Blocks: %" PRIu64 "\n", total.decode_errors);
+  printf("  Key Order Violations: %" PRIu64 "\n", total.order_errors);
+  printf("  Bloom False Negatives: %" PRIu64 "\n", total.bloom_misses);
+  printf("  Empty Index Blocks: %" PRIu64 "\n", total.index_errors);
+  printf("  WAL Seq Regressions: %" PRIu64 "\n", total.seq_regressions);
+  printf("  Dangling Vlog References: %" PRIu64 "\n", total.vlog_dangling);
+  printf("  Truncated or Unreadable Files: %d\n",
+         total.truncated + total.failed);
+  printf("  Changed Without Metadata Change: %d\n", total.hash_mismatch);
+  printf("  Read: %.2f GB in %.2f s (%.2f GB/s)\n",
+         (double)total.bytes / (1024.0 * 1024 * 1024), secs,
+         secs > 0 ? (double)total.bytes / (1024.0 * 1024 * 1024) / secs : 0.0);
+  if (saved != 0)
+    printf("  Warning: cannot write %s: %s\n", manifest_path, strerror(errno));
+  else if (g_db_shadow)
+    printf("  (shadow open: manifest not updated)\n");
+
+  free(ctx.results);
+  if (bad_files == 0) {
+    printf("  Status: OK\n");
+    return 0;
+  }
+  printf("  Status: ISSUES FOUND\n");
+  return -1;
+}
+
+static int cmd_verify(const int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: verify <cf> [--deep [--full]|--bloom] [-j N]\n");
+    return -1;
+  }
+
+  int deep = 0;
+  int full = 0;
+  int bloom = 0;
+  int threads = default_thread_count();
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--deep") == 0)
+      deep = 1;
+    else if (strcmp(argv[i], "--full") == 0)
+      full = 1;
+    else if (strcmp(argv[i], "--bloom") == 0)
+      bloom = 1;
+    else if ((strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0) &&
+             i + 1 < argc)
+      threads = parse_thread_count(argv[++i]);
+  }
+
+  if (g_db == NULL) {
+    printf("No database is open.\n");
+    return -1;
+  }
+
+  tidesdb_column_family_t *cf = tidesdb_get_column_family(g_db, argv[1]);
+  if (cf == NULL) {
+    printf("Column family '%s' not found.\n", argv[1]);
+    return -1;
+  }
+
+  char cf_path[2048];
+  snprintf(cf_path, sizeof(cf_path), "%s/%s", g_db_path, argv[1]);
+  if (deep)
+    return verify_deep(argv[1], cf, cf_path, threads, full);
+  if (bloom)
+    return verify_bloom(argv[1], cf_path, threads);
+
+  printf("Verifying column family '%s'...\n", argv[1]);
+
+  DIR *dir = opendir(cf_path);
+  if (dir == NULL) {
+    printf("  Status: FAILED (cannot open directory)\n");
+    return -1;
+  }
+
+  int sstable_count = 0;
+  int sstable_valid = 0;
+  int sstable_invalid = 0;
+  int wal_count = 0;
+  int wal_valid = 0;
+  int wal_invalid = 0;
+
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL) {
+    char full_path[4096];
+    snprintf(full_path, sizeof(full_path), "%s/%s", cf_path, entry->d_name);
+
+    const uint64_t file_start = trace_now();
+    if (strstr(entry->d_name, ".klog") != NULL) {
+      sstable_count++;
+      block_manager_t *bm = NULL;
+      if (block_manager_open(&bm, full_path, BLOCK_MANAGER_SYNC_NONE) == 0) {
+        const int block_count = block_manager_count_blocks(bm);
+        if (block_count >= 0) {
+          sstable_valid++;
+        } else {
+          sstable_invalid++;
+          printf("  Invalid SSTable: %s\n", entry->d_name);
+        }
+        block_manager_close(bm);
+      } else {
+        sstable_invalid++;
+        printf("  Cannot open SSTable: %s\n", entry->d_name);
+      }
+      trace_span("verify", entry->d_name, file_start, "%s", full_path);
+    } else if (strstr(entry->d_name, ".log") != NULL) {
+      wal_count++;
+      block_manager_t *bm = NULL;
+      if (block_manager_open(&bm, full_path, BLOCK_MANAGER_SYNC_NONE) == 0) {
+        const int block_count = block_manager_count_blocks(bm);
+        if (block_count >= 0) {
+          wal_valid++;
+        } else {
+          wal_invalid++;
+          printf("  Invalid WAL: %s\n", entry->d_name);
+        }
+        block_manager_close(bm);
+      } else {
+        wal_invalid++;
+        printf("  Cannot open WAL: %s\n", entry->d_name);
+      }
+      trace_span("verify", entry->d_name, file_start, "%s", full_path);
+    }
+  }
+  closedir(dir);
+
+  printf("\nVerification Results:\n");
+  printf("  SSTables: %d total, %d valid, %d invalid\n", sstable_count,
+         sstable_valid, sstable_invalid);
+  printf("  WAL Files: %d total, %d valid, %d invalid\n", wal_count, wal_valid,
+         wal_invalid);
+
+  if (sstable_invalid == 0 && wal_invalid == 0) {
+    printf("  Status: OK\n");
+    return 0;
+  } else {
+    printf("  Status: ISSUES FOUND\n");
+    return -1;
+  }
+}
+
+typedef struct {
+  char path[4096];
+  char rel[1024];
+  uint64_t size;
+  XXH128_hash_t hash;
+  int failed;
+} fingerprint_file_t;
+
+typedef struct {
+  fingerprint_file_t *items;
+  int count;
+  int cap;
+} fingerprint_list_t;
+
+static int fingerprint_list_add(fingerprint_list_t *list, const char *path,
+                                const char *rel, const uint64_t size) {
+  if (list->count == list->cap) {
+    const int new_cap = list->cap ? list->cap * 2 : 64;
+    fingerprint_file_t *grown =
+        realloc(list->items, sizeof(*list->items) * (size_t)new_cap);
+    if (grown == NULL)
+      return -1;
+    list->items = grown;
+    list->cap = new_cap;
+  }
+  fingerprint_file_t *f = &list->items[list->count++];
+  memset(f, 0, sizeof(*f));
+  snprintf(f->path, sizeof(f->path), "%s", path);
+  snprintf(f->rel, sizeof(f->rel), "%s", rel);
+  f->size = size;
+  return 0;
+}
+
+/* walks dir recursively, naming files relative to the root so manifests
+ * from different hosts line up; verify manifests are host-local and left
+ * out */
+static int fingerprint_collect(const char *dir_path, const char *rel,
+                               fingerprint_list_t *list) {
+  DIR *dir = opendir(dir_path);
+  if (dir == NULL) {
+    printf("Cannot read '%s': %s\n", dir_path, strerror(errno));
+    return -1;
+  }
+  int rc = 0;
+  struct dirent *ent;
+  while (rc == 0 && (ent = readdir(dir)) != NULL) {
+    if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0 ||
+        strncmp(ent->d_name, VERIFY_MANIFEST_NAME,
+                strlen(VERIFY_MANIFEST_NAME)) == 0)
+      continue;
+    char path[4096];
+    char child_rel[1024];
+    snprintf(path, sizeof(path), "%s/%s", dir_path, ent->d_name);
+    if (rel[0] != '\0')
+      snprintf(child_rel, sizeof(child_rel), "%s/%s", rel, ent->d_name);
+    else
+      snprintf(child_rel, sizeof(child_rel), "%s", ent->d_name);
+    struct stat st;
+    if (stat(path, &st) != 0)
+      continue;
+    if (S_ISDIR(st.st_mode))
+      rc = fingerprint_collect(path, child_rel, list);
+    else if (S_ISREG(st.st_mode))
+      rc = fingerprint_list_add(list, path, child_rel, (uint64_t)st.st_size);
+  }
+  closedir(dir);
+  return rc;
+}
+
+static int fingerprint_compare(const void *a, const void *b) {
+  return strcmp(((const fingerprint_file_t *)a)->rel,
+                ((const fingerprint_file_t *)b)->rel);
+}
+
+static void fingerprint_worker(void *arg, const int index) {
+  fingerprint_file_t *f = &((fingerprint_file_t *)arg)[index];
+  const uint64_t start = trace_now();
+  f->failed = file_xxh3(f->path, f->size, &f->hash) != 0;
+  trace_span("fingerprint", f->rel, start, "bytes=%" PRIu64, f->size);
+}
+
+static int cmd_fingerprint(const int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: fingerprint <path|cf|db> [-j N] [-o manifest]\n");
+    printf("Writes an XXH3-128 manifest of whole files for diffing "
+           "copies.\n");
+    return -1;
+  }
+
+  int threads = default_thread_count();
+  const char *output = NULL;
+  for (int i = 2; i < argc; i++) {
+    if ((strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0) &&
+        i + 1 < argc)
+      threads = parse_thread_count(argv[++i]);
+    else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+      output = argv[++i];
+  }
+
+  /* an existing path wins, then a column family, then the open database */
+  fingerprint_list_t list = {0};
+  char root[4096];
+  struct stat st;
+  int rc;
+  if (stat(argv[1], &st) == 0 && S_ISREG(st.st_mode)) {
+    const char *base = strrchr(argv[1], '/');
+    rc = fingerprint_list_add(&list, argv[1], base ? base + 1 : argv[1],
+                              (uint64_t)st.st_size);
+    snprintf(root, sizeof(root), "%s", argv[1]);
+  } else if (resolve_cf_dir(argv[1], root, sizeof(root)) == 0) {
+    rc = fingerprint_collect(root, "", &list);
+  } else if (strcmp(argv[1], "db") == 0 && g_db != NULL) {
+    snprintf(root, sizeof(root), "%s", g_db_path);
+    rc = fingerprint_collect(root, "", &list);
+  } else {
+    printf("No such file, directory or column family: %s\n", argv[1]);
+    return -1;
+  }
+  if (rc != 0) {
+    free(list.items);
+    return -1;
+  }
+  if (list.count > 1)
+    qsort(list.items, (size_t)list.count, sizeof(*list.items),
+          fingerprint_compare);
+
+  const uint64_t start = now_us();
+  run_parallel(list.count, threads, fingerprint_worker, list.items);
+  const double secs = (double)(now_us() - start) / 1e6;
+
+  FILE *out = cmd_out();
+  if (output != NULL && (out = fopen(output, "w")) == NULL) {
+    printf("Cannot write '%s': %s\n", output, strerror(errno));
+    free(list.items);
+    return -1;
+  }
+  uint64_t bytes = 0;
+  int failed = 0;
+  fprintf(out, "# xxh3-128 size path\n");
+  for (int i = 0; i < list.count; i++) {
+    const fingerprint_file_t *f = &list.items[i];
+    char hex[33];
+    if (f->failed) {
+      failed++;
+      snprintf(hex, sizeof(hex), "%-32s", "unreadable");
+    } else {
+      format_xxh128(f->hash, hex);
+    }
+    fprintf(out, "%s  %" PRIu64 "  %s\n", hex, f->size, f->rel);
+    bytes += f->size;
+  }
+  if (out != cmd_out() && fclose(out) != 0) {
+    printf("Cannot write '%s': %s\n", output, strerror(errno));
+    failed++;
+  }
+
+  /* a manifest on stdout is meant to be redirected or piped into diff, so
+   * the summary must not end up in it */
+  FILE *summary = out == cmd_out() ? stderr : cmd_out();
+  fprintf(summary,
+          "# %s: %d files, %" PRIu64 " bytes in %.2f s (%.2f GB/s, %d "
+          "threads)\n",
+          root, list.count, bytes, secs,
+          secs > 0 ? (double)bytes / (1024.0 * 1024 * 1024) / secs : 0.0,
+          threads);
+  if (failed > 0)
+    fprintf(summary, "# %d files could not be read\n", failed);
+  free(list.items);
+  return failed > 0 ? -1 : 0;
+}
+
+typedef struct {
+  const uint8_t *key;
+  size_t key_size;
+} key_ref_t;
+
+static int key_ref_compare(const void *a, const void *b) {
+  const key_ref_t *ka = a;
+  const key_ref_t *kb = b;
+  return compare_keys(ka->key, ka->key_size, kb->key, kb->key_size);
+}
+
+static int key_ref_find(const key_ref_t *points, const int count,
+                        const uint8_t *key, const size_t key_size,
+                        int *exact) {
+  int lo = 0;
+  int hi = count;
+  while (lo < hi) {
+    const int mid = lo + (hi - lo) / 2;
+    if (compare_keys(points[mid].key, points[mid].key_size, key, key_size) <= 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  const int idx = lo - 1;
+  *exact = idx >= 0 && compare_keys(points[idx].key, points[idx].key_size, key,
+                                    key_size) == 0;
+  return idx;
+}
+
+typedef struct {
+  int first_region;
+  int last_region;
+  int depth;
+} overlap_run_t;
+
+static int overlap_run_compare(const void *a, const void *b) {
+  const overlap_run_t *ra = a;
+  const overlap_run_t *rb = b;
+  if (ra->depth != rb->depth)
+    return ra->depth > rb->depth ? -1 : 1;
+  return ra->first_region - rb->first_region;
+}
+
+static int cmd_read_amp_map(const int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: read-amp-map <cf> [key...] [--samples N] [--top N] "
+           "[--limit N]\n");
+    printf("Maps SSTable key-range overlap and per-key lookup cost.\n");
+    return -1;
+  }
+
+  char cf_dir[4096];
+  if (resolve_cf_dir(argv[1], cf_dir, sizeof(cf_dir)) != 0) {
+    printf("Column family directory not found: %s\n", argv[1]);
+    return -1;
+  }
+
+  int samples = 16;
+  int top = 10;
+  int limit = 100;
+  arg_bytes_t *query_keys = calloc((size_t)argc, sizeof(*query_keys));
+  int query_count = 0;
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+      samples = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+      top = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc) {
+      limit = atoi(argv[++i]);
+    } else if (query_keys) {
+      if (arg_bytes_decode(argv[i], &query_keys[query_count]) != 0) {
+        arg_bytes_free_array(query_keys, query_count);
+        return -1;
+      }
+      query_count++;
+    }
+  }
+
+  cf_file_t *files = NULL;
+  int file_count = 0;
+  if (list_cf_files(cf_dir, ".klog", &files, &file_count) != 0) {
+    printf("Cannot open column family directory: %s\n", strerror(errno));
+    arg_bytes_free_array(query_keys, query_count);
+    return -1;
+  }
+
+  klog_bounds_t *bounds = calloc((size_t)(file_count ? file_count : 1),
+                                 sizeof(*bounds));
+  key_ref_t *points = calloc((size_t)(file_count ? file_count : 1) * 2,
+                             sizeof(*points));
+  if (!bounds || !points) {
+    printf("Out of memory\n");
+    free(bounds);
+    free(points);
+    free(files);
+    arg_bytes_free_array(query_keys, query_count);
+    return -1;
+  }
+
+  int max_level = 0;
+  int point_count = 0;
+  int usable = 0;
+  for (int i = 0; i < file_count; i++) {
+    const int rc = klog_read_bounds(files[i].path, &bounds[i]);
+    if (rc < 0) {
+      printf("  Skipping unreadable SSTable: %s\n", files[i].name);
+      continue;
+    }
+    if (rc > 0)
+      continue;
+    usable++;
+    if (files[i].level > max_level)
+      max_level = files[i].level;
+    points[point_count].key = bounds[i].min_key;
+    points[point_count++].key_size = bounds[i].min_key_size;
+    points[point_count].key = bounds[i].max_key;
+    points[point_count++].key_size = bounds[i].max_key_size;
+  }
+
+  printf("Read Amplification Map: %s\n", cf_dir);
+  if (usable == 0) {
+    printf("  (no non-empty SSTables found)\n");
+    for (int i = 0; i < file_count; i++)
+      klog_bounds_free(&bounds[i]);
+    free(bounds);
+    free(points);
+    free(files);
+    arg_bytes_free_array(query_keys, query_count);
+    return 0;
+  }
+
+  qsort(points, (size_t)point_count, sizeof(*points), key_ref_compare);
+  int unique = 0;
+  for (int i = 0; i < point_count; i++) {
+    if (unique == 0 || key_ref_compare(&points[unique - 1], &points[i]) != 0)
+      points[unique++] = points[i];
+  }
+
+  /* regions alternate between boundary keys (even) and the open gaps
+   * between consecutive boundary keys (odd) */
+  const int levels = max_level + 1;
+  const int regions = 2 * unique - 1;
+  int *depth = calloc((size_t)(regions + 1) * (size_t)levels, sizeof(int));
+  if (!depth) {
+    printf("Out of memory\n");
+    for (int i = 0; i < file_count; i++)
+      klog_bounds_free(&bounds[i]);
+    free(bounds);
+    free(points);
+    free(files);
+    arg_bytes_free_array(query_keys, query_count);
+    return -1;
+  }
+
+  int *level_files = calloc((size_t)levels, sizeof(int));
+  for (int i = 0; i < file_count; i++) {
+    if (!bounds[i].min_key)
+      continue;
+    int exact;
+    const int a = key_ref_find(points, unique, bounds[i].min_key,
+                               bounds[i].min_key_size, &exact);
+    const int b = key_ref_find(points, unique, bounds[i].max_key,
+                               bounds[i].max_key_size, &exact);
+    depth[(size_t)(2 * a) * levels + files[i].level]++;
+    depth[(size_t)(2 * b + 1) * levels + files[i].level]--;
+    if (level_files)
+      level_files[files[i].level]++;
+  }
+  for (int r = 1; r < regions; r++) {
+    for (int l = 0; l < levels; l++)
+      depth[(size_t)r * levels + l] += depth[(size_t)(r - 1) * levels + l];
+  }
+
+  int *level_max = calloc((size_t)levels, sizeof(int));
+  for (int r = 0; r < regions && level_max; r++) {
+    for (int l = 0; l < levels; l++) {
+      if (depth[(size_t)r * levels + l] > level_max[l])
+        level_max[l] = depth[(size_t)r * levels + l];
+    }
+  }
+
+  printf("  SSTables: %d (%d key boundaries)\n", usable, unique);
+  for (int l = 0; l < levels; l++) {
+    if (!level_files || level_files[l] == 0)
+      continue;
+    printf("  Level %d: %d SSTables, max overlap %d%s\n", l, level_files[l],
+           level_max ? level_max[l] : 0,
+           l > 1 && level_max && level_max[l] > 1 ? " (overlapping)" : "");
+  }
+
+  printf("\nLookup Cost (SSTables whose key range contains the key):\n");
+  const int sampled = query_count == 0;
+  const int lookups =
+      sampled ? (samples < unique ? (samples > 0 ? samples : 1) : unique)
+              : query_count;
+  uint64_t total_touched = 0;
+  int max_touched = 0;
+  for (int q = 0; q < lookups; q++) {
+    const uint8_t *key;
+    size_t key_size;
+    if (sampled) {
+      const int idx =
+          lookups > 1 ? (int)((int64_t)q * (unique - 1) / (lookups - 1)) : 0;
+      key = points[idx].key;
+      key_size = points[idx].key_size;
+    } else {
+      key = query_keys[q].data;
+      key_size = query_keys[q].size;
+    }
+
+    int exact;
+    const int idx = key_ref_find(points, unique, key, key_size, &exact);
+    const int region = idx < 0 ? -1 : (exact ? 2 * idx : 2 * idx + 1);
+
+    int touched = 0;
+    printf("  ");
+    print_key_preview(key, key_size, 32);
+    if (region >= 0 && region < regions) {
+      for (int l = 0; l < levels; l++)
+        touched += depth[(size_t)region * levels + l];
+    }
+    printf(" total=%d", touched);
+    for (int l = 0; l < levels && region >= 0 && region < regions; l++) {
+      if (level_files && level_files[l] > 0)
+        printf(" L%d=%d", l, depth[(size_t)region * levels + l]);
+    }
+    printf("\n");
+
+    total_touched += (uint64_t)touched;
+    if (touched > max_touched)
+      max_touched = touched;
+  }
+  printf("  Average: %.2f SSTables per lookup (max %d, %s keys)\n",
+         lookups > 0 ? (double)total_touched / lookups : 0, max_touched,
+         sampled ? "sampled" : "supplied");
+
+  overlap_run_t *runs = calloc((size_t)regions, sizeof(*runs));
+  int run_count = 0;
+  for (int r = 0; r < regions && runs; r++) {
+    int total = 0;
+    for (int l = 0; l < levels; l++)
+      total += depth[(size_t)r * levels + l];
+    if (total == 0)
+      continue;
+    if (run_count > 0 && runs[run_count - 1].last_region == r - 1 &&
+        memcmp(&depth[(size_t)(r - 1) * levels], &depth[(size_t)r * levels],
+               (size_t)levels * sizeof(int)) == 0) {
+      runs[run_count - 1].last_region = r;
+      continue;
+    }
+    runs[run_count].first_region = r;
+    runs[run_count].last_region = r;
+    runs[run_count].depth = total;
+    run_count++;
+  }
+
+  printf("\nOverlap Heatmap (%d key ranges):\n", run_count);
+  for (int i = 0; i < run_count && i < limit; i++) {
+    const key_ref_t *start = &points[runs[i].first_region / 2];
+    const key_ref_t *end = &points[(runs[i].last_region + 1) / 2];
+    printf("  [");
+    print_key_preview(start->key, start->key_size, 24);
+    printf(" .. ");
+    print_key_preview(end->key, end->key_size, 24);
+    printf("] depth=%d", runs[i].depth);
+    for (int l = 0; l < levels; l++) {
+      const int d = depth[(size_t)runs[i].first_region * levels + l];
+      if (d > 0)
+        printf(" L%d=%d", l, d);
+    }
+    printf(" |");
+    for (int b = 0; b < runs[i].depth && b < 60; b++)
+      printf("#");
+    printf("\n");
+  }
+  if (run_count > limit)
+    printf("  ... (%d more ranges, use --limit to show)\n", run_count - limit);
+
+  if (runs && run_count > 0) {
+    qsort(runs, (size_t)run_count, sizeof(*runs), overlap_run_compare);
+    printf("\nHottest Key Ranges (compaction candidates):\n");
+    int shown = 0;
+    for (int i = 0; i < run_count && shown < top; i++) {
+      if (runs[i].depth < 2)
+        break;
+      const key_ref_t *start = &points[runs[i].first_region / 2];
+      const key_ref_t *end = &points[(runs[i].last_region + 1) / 2];
+      printf("  %d) [", ++shown);
+      print_key_preview(start->key, start->key_size, 32);
+      printf(" .. ");
+      print_key_preview(end->key, end->key_size, 32);
+      printf("] %d SSTables per lookup\n", runs[i].depth);
+    }
+    if (shown == 0)
+      printf("  (no overlapping ranges)\n");
+  }
+
+  free(runs);
+  free(level_max);
+  free(level_files);
+  free(depth);
+  for (int i = 0; i < file_count; i++)
+    klog_bounds_free(&bounds[i]);
+  free(bounds);
+  free(points);
+  free(files);
+  arg_bytes_free_array(query_keys, query_count);
+  return 0;
+}
+
+typedef struct {
+  uint64_t entries;
+  uint64_t total_bytes;
+  uint64_t tombstones;
+  uint64_t tombstone_bytes;
+  uint64_t expired;
+  uint64_t expired_bytes;
+  uint64_t shadowed;
+  uint64_t shadowed_bytes;
+  uint64_t rewrite_bytes;
+  int failed;
+} gc_debt_t;
+
+typedef struct {
+  sstable_set_t set;
+  gc_debt_t *debt;
+  int64_t now;
+} gc_debt_ctx_t;
+
+static uint64_t klog_entry_bytes(const klog_entry_t *entry) {
+  uint64_t bytes = entry->encoded_size;
+  if (entry->flags & TDB_KV_FLAG_HAS_VLOG)
+    bytes += entry->value_size;
+  return bytes;
+}
+
+static void gc_debt_worker(void *arg, const int index) {
+  gc_debt_ctx_t *ctx = arg;
+  gc_debt_t *debt = &ctx->debt[index];
+  const uint64_t file_start = trace_now();
+
+  klog_iter_t it;
+  if (klog_iter_open(&it, ctx->set.files[index].path) != 0) {
+    debt->failed = 1;
+    return;
+  }
+
+  int rc;
+  while ((rc = klog_iter_next(&it)) == 1) {
+    const klog_entry_t *e = &it.entry;
+    const uint64_t bytes = klog_entry_bytes(e);
+    debt->entries++;
+    debt->total_bytes += bytes;
+
+    if (e->flags & TDB_KV_FLAG_TOMBSTONE) {
+      debt->tombstones++;
+      debt->tombstone_bytes += bytes;
+    } else if ((e->flags & TDB_KV_FLAG_HAS_TTL) && e->ttl > 0 &&
+               e->ttl <= ctx->now) {
+      debt->expired++;
+      debt->expired_bytes += bytes;
+    } else if (sstable_set_shadowed(&ctx->set, index, e->key,
+                                    (size_t)e->key_size)) {
+      debt->shadowed++;
+      debt->shadowed_bytes += bytes;
+    }
+  }
+  if (rc < 0)
+    debt->failed = 1;
+
+  klog_iter_close(&it);
+  trace_span("gc-debt", ctx->set.files[index].name, file_start,
+             "entries=%" PRIu64, debt->entries);
+}
+
+static uint64_t gc_reclaimable(const gc_debt_t *debt) {
+  return debt->tombstone_bytes + debt->expired_bytes + debt->shadowed_bytes;
+}
+
+typedef struct {
+  int index;
+  double score; /* reclaimable bytes per byte rewritten */
+} gc_target_t;
+
+static int gc_target_compare(const void *a, const void *b) {
+  const gc_target_t *ta = a;
+  const gc_target_t *tb = b;
+  if (ta->score != tb->score)
+    return ta->score > tb->score ? -1 : 1;
+  return ta->index < tb->index ? -1 : ta->index > tb->index;
+}
+
+static int cmd_gc_debt(const int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: gc-debt <cf> [-j threads] [--top N]\n");
+    printf("Reports tombstone, expired TTL and shadowed-version debt per "
+           "SSTable.\n");
+    return -1;
+  }
+
+  char cf_dir[4096];
+  if (resolve_cf_dir(argv[1], cf_dir, sizeof(cf_dir)) != 0) {
+    printf("Column family directory not found: %s\n", argv[1]);
+    return -1;
+  }
+
+  int threads = default_thread_count();
+  int top = 10;
+  for (int i = 2; i < argc; i++) {
+    if ((strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0) &&
+        i + 1 < argc) {
+      threads = parse_thread_count(argv[++i]);
+    } else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+      top = atoi(argv[++i]);
+    }
+  }
+
+  gc_debt_ctx_t ctx;
+  memset(&ctx, 0, sizeof(ctx));
+  ctx.now = (int64_t)time(NULL);
+  const uint64_t start = now_us();
+
+  if (sstable_set_load(&ctx.set, cf_dir, threads, 1) != 0) {
+    printf("Failed to load SSTables from %s\n", cf_dir);
+    sstable_set_free(&ctx.set);
+    return -1;
+  }
+  if (ctx.set.count == 0) {
+    printf("No SSTables found in %s\n", cf_dir);
+    sstable_set_free(&ctx.set);
+    return 0;
+  }
+
+  ctx.debt = calloc((size_t)ctx.set.count, sizeof(*ctx.debt));
+  gc_target_t *order = calloc((size_t)ctx.set.count, sizeof(*order));
+  if (!ctx.debt || !order) {
+    printf("Out of memory\n");
+    free(ctx.debt);
+    free(order);
+    sstable_set_free(&ctx.set);
+    return -1;
+  }
+
+  run_parallel(ctx.set.count, threads, gc_debt_worker, &ctx);
+
+  /* compacting a file rewrites it together with the overlapping files of
+   * the next level */
+  int max_level = 0;
+  for (int i = 0; i < ctx.set.count; i++) {
+    const cf_file_t *f = &ctx.set.files[i];
+    if (f->level > max_level)
+      max_level = f->level;
+    ctx.debt[i].rewrite_bytes = f->file_size;
+    for (int j = 0; j < ctx.set.count && ctx.set.bounds[i].min_key; j++) {
+      const klog_bounds_t *bj = &ctx.set.bounds[j];
+      if (ctx.set.files[j].level != f->level + 1 || !bj->min_key)
+        continue;
+      if (compare_keys(bj->max_key, bj->max_key_size,
+                       ctx.set.bounds[i].min_key,
+                       ctx.set.bounds[i].min_key_size) < 0 ||
+          compare_keys(bj->min_key, bj->min_key_size,
+                       ctx.set.bounds[i].max_key,
+                       ctx.set.bounds[i].max_key_size) > 0)
+        continue;
+      ctx.debt[i].rewrite_bytes += ctx.set.files[j].file_size;
+    }
+  }
+
+  printf("GC Debt Report: %s\n", cf_dir);
+  printf("  SSTables: %d, threads: %d, now: %" PRId64 "\n\n", ctx.set.count,
+         threads, ctx.now);
+  printf("  %-24s %5s %12s %10s %8s %8s %8s %8s\n", "File", "Level", "Bytes",
+         "Entries", "Tomb%", "Expir%", "Shadow%~", "Reclaim%~");
+
+  gc_debt_t *level_totals =
+      calloc((size_t)max_level + 1, sizeof(*level_totals));
+  gc_debt_t total;
+  memset(&total, 0, sizeof(total));
+
+  for (int i = 0; i < ctx.set.count; i++) {
+    const gc_debt_t *d = &ctx.debt[i];
+    const cf_file_t *f = &ctx.set.files[i];
+    order[i].index = i;
+    order[i].score = d->rewrite_bytes > 0 ? (double)gc_reclaimable(d) /
+                                                (double)d->rewrite_bytes
+                                          : 0;
+    printf("  %-24s %5d %12" PRIu64 " %10" PRIu64
+           " %7.1f%% %7.1f%% %7.1f%% %7.1f%%\n",
+           f->name, f->level, d->total_bytes, d->entries,
+           percent_of(d->tombstone_bytes, d->total_bytes),
+           percent_of(d->expired_bytes, d->total_bytes),
+           percent_of(d->shadowed_bytes, d->total_bytes),
+           percent_of(gc_reclaimable(d), d->total_bytes));
+    if (d->failed)
+      printf("  %-24s (read error, partial results)\n", "");
+
+    gc_debt_t *targets[2] = {level_totals ? &level_totals[f->level] : NULL,
+                             &total};
+    for (int t = 0; t < 2; t++) {
+      if (!targets[t])
+        continue;
+      targets[t]->entries += d->entries;
+      targets[t]->total_bytes += d->total_bytes;
+      targets[t]->tombstones += d->tombstones;
+      targets[t]->tombstone_bytes += d->tombstone_bytes;
+      targets[t]->expired += d->expired;
+      targets[t]->expired_bytes += d->expired_bytes;
+      targets[t]->shadowed += d->shadowed;
+      targets[t]->shadowed_bytes += d->shadowed_bytes;
+    }
+  }
+
+  printf("\n  Per Level:\n");
+  for (int l = 0; l <= max_level && level_totals; l++) {
+    const gc_debt_t *d = &level_totals[l];
+    if (d->entries == 0)
+      continue;
+    printf("    Level %d: %" PRIu64 " bytes, tombstones %.1f%%, expired "
+           "%.1f%%, shadowed ~%.1f%%, reclaimable ~%.1f%%\n",
+           l, d->total_bytes, percent_of(d->tombstone_bytes, d->total_bytes),
+           percent_of(d->expired_bytes, d->total_bytes),
+           percent_of(d->shadowed_bytes, d->total_bytes),
+           percent_of(gc_reclaimable(d), d->total_bytes));
+  }
+
+  printf("\n  Total: %" PRIu64 " entries, %" PRIu64 " bytes\n", total.entries,
+         total.total_bytes);
+  printf("    Tombstones: %" PRIu64 " (%" PRIu64 " bytes, %.1f%%)\n",
+         total.tombstones, total.tombstone_bytes,
+         percent_of(total.tombstone_bytes, total.total_bytes));
+  printf("    Expired TTL: %" PRIu64 " (%" PRIu64 " bytes, %.1f%%)\n",
+         total.expired, total.expired_bytes,
+         percent_of(total.expired_bytes, total.total_bytes));
+  printf("    Shadowed (est.): %" PRIu64 " (%" PRIu64 " bytes, %.1f%%)\n",
+         total.shadowed, total.shadowed_bytes,
+         percent_of(total.shadowed_bytes, total.total_bytes));
+  printf("    Reclaimable (upper bound): %" PRIu64 " bytes (%.1f%%)\n",
+         gc_reclaimable(&total),
+         percent_of(gc_reclaimable(&total), total.total_bytes));
+  printf("  (~ shadowed entries are found with newer SSTables' bloom filters; "
+         "false\n   positives make them, and everything that includes them, "
+         "an upper bound)\n");
+
+  qsort(order, (size_t)ctx.set.count, sizeof(*order), gc_target_compare);
+
+  printf("\n  Compaction Targets (reclaimable bytes per byte rewritten):\n");
+  int shown = 0;
+  for (int i = 0; i < ctx.set.count && shown < top; i++) {
+    const int idx = order[i].index;
+    const gc_debt_t *d = &ctx.debt[idx];
+    if (gc_reclaimable(d) == 0)
+      break;
+    const klog_bounds_t *b = &ctx.set.bounds[idx];
+    printf("    %d) %s (L%d) reclaims up to %" PRIu64 " of %" PRIu64
+           " bytes rewritten (%.3f)\n",
+           ++shown, ctx.set.files[idx].name, ctx.set.files[idx].level,
+           gc_reclaimable(d), d->rewrite_bytes,
+           (double)gc_reclaimable(d) / (double)d->rewrite_bytes);
+    if (b->min_key) {
+      printf("       key range [");
+      print_key_preview(b->min_key, b->min_key_size, 32);
+      printf(" .. ");
+      print_key_preview(b->max_key, b->max_key_size, 32);
+      printf("]\n");
+    }
+  }
+  if (shown == 0)
+    printf("    (nothing to reclaim)\n");
+
+  printf("\n  Elapsed: %.2f s\n", (double)(now_us() - start) / 1e6);
+
+  free(level_totals);
+  free(order);
+  free(ctx.debt);
+  sstable_set_free(&ctx.set);
+  return 0;
+}
+
+typedef int (*heap_less_fn)(const void *ctx, int a, int b);
+
+typedef struct {
+  int *items;
+  int size;
+  heap_less_fn less;
+  const void *ctx;
+} index_heap_t;
+
+static void index_heap_sift_down(index_heap_t *h, int i) {
+  while (1) {
+    const int l = 2 * i + 1;
+    const int r = l + 1;
+    int smallest = i;
+    if (l < h->size && h->less(h->ctx, h->items[l], h->items[smallest]))
+      smallest = l;
+    if (r < h->size && h->less(h->ctx, h->items[r], h->items[smallest]))
+      smallest = r;
+    if (smallest == i)
+      return;
+    const int tmp = h->items[i];
+    h->items[i] = h->items[smallest];
+    h->items[smallest] = tmp;
+    i = smallest;
+  }
+}
+
+static void index_heap_push(index_heap_t *h, const int item) {
+  int i = h->size++;
+  h->items[i] = item;
+  while (i > 0) {
+    const int parent = (i - 1) / 2;
+    if (!h->less(h->ctx, h->items[i], h->items[parent]))
+      break;
+    const int tmp = h->items[i];
+    h->items[i] = h->items[parent];
+    h->items[parent] = tmp;
+    i = parent;
+  }
+}
+
+static void index_heap_pop(index_heap_t *h) {
+  h->items[0] = h->items[--h->size];
+  index_heap_sift_down(h, 0);
+}
+
+typedef struct {
+  klog_iter_t it;
+  int level;
+} merge_source_t;
+
+/* newest version first: key ascending, then seq descending, then the
+ * lower (newer) level */
+static int merge_source_less(const void *ctx, const int a, const int b) {
+  const merge_source_t *sources = ctx;
+  const klog_entry_t *ea = &sources[a].it.entry;
+  const klog_entry_t *eb = &sources[b].it.entry;
+  const int cmp = compare_keys(ea->key, (size_t)ea->key_size, eb->key,
+                               (size_t)eb->key_size);
+  if (cmp != 0)
+    return cmp < 0;
+  if (ea->seq != eb->seq)
+    return ea->seq > eb->seq;
+  return sources[a].level < sources[b].level;
+}
+
+typedef struct {
+  uint64_t entries;
+  uint64_t total_bytes;
+  uint64_t live_bytes;
+  uint64_t shadowed_bytes;
+  uint64_t tombstone_bytes;
+  uint64_t expired_bytes;
+} space_amp_level_t;
+
+static int cmd_space_amp(const int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: space-amp <cf-dir>\n");
+    printf("Merges all SSTables offline and measures live vs. obsolete "
+           "bytes.\n");
+    return -1;
+  }
+
+  char cf_dir[4096];
+  if (resolve_cf_dir(argv[1], cf_dir, sizeof(cf_dir)) != 0) {
+    printf("Column family directory not found: %s\n", argv[1]);
+    return -1;
+  }
+
+  cf_file_t *files = NULL;
+  int file_count = 0;
+  if (list_cf_files(cf_dir, ".klog", &files, &file_count) != 0) {
+    printf("Cannot open column family directory: %s\n", strerror(errno));
+    return -1;
+  }
+  if (file_count == 0) {
+    printf("No SSTables found in %s\n", cf_dir);
+    free(files);
+    return 0;
+  }
+
+  int max_level = 0;
+  for (int i = 0; i < file_count; i++) {
+    if (files[i].level > max_level)
+      max_level = files[i].level;
+  }
+
+  merge_source_t *sources = calloc((size_t)file_count, sizeof(*sources));
+  int *heap_items = calloc((size_t)file_count, sizeof(int));
+  space_amp_level_t *levels =
+      calloc((size_t)max_level + 1, sizeof(*levels));
+  if (!sources || !heap_items || !levels) {
+    printf("Out of memory\n");
+    free(sources);
+    free(heap_items);
+    free(levels);
+    free(files);
+    return -1;
+  }
+
+  const uint64_t start = now_us();
+  const int64_t now = (int64_t)time(NULL);
+  index_heap_t heap = {.items = heap_items, .less = merge_source_less,
+                       .ctx = sources};
+  int read_errors = 0;
+
+  for (int i = 0; i < file_count; i++) {
+    sources[i].level = files[i].level;
+    if (klog_iter_open(&sources[i].it, files[i].path) != 0) {
+      printf("  Cannot open SSTable: %s\n", files[i].name);
+      read_errors++;
+      continue;
+    }
+    const int rc = klog_iter_next(&sources[i].it);
+    if (rc == 1)
+      index_heap_push(&heap, i);
+    else if (rc < 0)
+      read_errors++;
+  }
+
+  uint8_t *prev_key = NULL;
+  size_t prev_key_size = 0;
+  size_t prev_key_cap = 0;
+  int have_prev = 0;
+  uint64_t unique_keys = 0;
+  uint64_t input_bytes = 0;
+
+  while (heap.size > 0) {
+    const int top = heap.items[0];
+    merge_source_t *src = &sources[top];
+    const klog_entry_t *e = &src->it.entry;
+    space_amp_level_t *lvl = &levels[src->level];
+    const uint64_t bytes = klog_entry_bytes(e);
+
+    lvl->entries++;
+    lvl->total_bytes += bytes;
+    input_bytes += bytes;
+
+    const int same_key = have_prev && compare_keys(prev_key, prev_key_size,
+                                                   e->key,
+                                                   (size_t)e->key_size) == 0;
+    if (same_key) {
+      lvl->shadowed_bytes += bytes;
+    } else {
+      unique_keys++;
+      if (e->key_size > prev_key_cap) {
+        uint8_t *grown = realloc(prev_key, (size_t)e->key_size);
+        if (!grown) {
+          printf("Out of memory\n");
+          break;
+        }
+        prev_key = grown;
+        prev_key_cap = (size_t)e->key_size;
+      }
+      if (e->key_size > 0)
+        memcpy(prev_key, e->key, (size_t)e->key_size);
+      prev_key_size = (size_t)e->key_size;
+      have_prev = 1;
+
+      if (e->flags & TDB_KV_FLAG_TOMBSTONE) {
+        lvl->tombstone_bytes += bytes;
+      } else if ((e->flags & TDB_KV_FLAG_HAS_TTL) && e->ttl > 0 &&
+                 e->ttl <= now) {
+        lvl->expired_bytes += bytes;
+      } else {
+        lvl->live_bytes += bytes;
+      }
+    }
+
+    const int rc = klog_iter_next(&src->it);
+    if (rc == 1) {
+      index_heap_sift_down(&heap, 0);
+    } else {
+      if (rc < 0) {
+        printf("  Read error in %s, stopping that file early\n",
+               files[top].name);
+        read_errors++;
+      }
+      index_heap_pop(&heap);
+    }
+  }
+
+  const uint64_t elapsed = now_us() - start;
+
+  printf("Space Amplification: %s\n", cf_dir);
+  printf("  SSTables: %d, Unique Keys: %" PRIu64 "\n\n", file_count,
+         unique_keys);
+  printf("  %-6s %10s %14s %14s %14s %14s %14s %7s\n", "Level", "Entries",
+         "Total", "Live", "Shadowed", "Tombstones", "Expired", "Live%");
+
+  space_amp_level_t total;
+  memset(&total, 0, sizeof(total));
+  for (int l = 0; l <= max_level; l++) {
+    const space_amp_level_t *lvl = &levels[l];
+    if (lvl->entries == 0)
+      continue;
+    printf("  L%-5d %10" PRIu64 " %14" PRIu64 " %14" PRIu64 " %14" PRIu64
+           " %14" PRIu64 " %14" PRIu64 " %6.1f%%\n",
+           l, lvl->entries, lvl->total_bytes, lvl->live_bytes,
+           lvl->shadowed_bytes, lvl->tombstone_bytes, lvl->expired_bytes,
+           percent_of(lvl->live_bytes, lvl->total_bytes));
+    total.entries += lvl->entries;
+    total.total_bytes += lvl->total_bytes;
+    total.live_bytes += lvl->live_bytes;
+    total.shadowed_bytes += lvl->shadowed_bytes;
+    total.tombstone_bytes += lvl->tombstone_bytes;
+    total.expired_bytes += lvl->expired_bytes;
+  }
+  printf("  %-6s %10" PRIu64 " %14" PRIu64 " %14" PRIu64 " %14" PRIu64
+         " %14" PRIu64 " %14" PRIu64 " %6.1f%%\n",
+         "Total", total.entries, total.total_bytes, total.live_bytes,
+         total.shadowed_bytes, total.tombstone_bytes, total.expired_bytes,
+         percent_of(total.live_bytes, total.total_bytes));
+
+  if (total.live_bytes > 0) {
+    printf("\n  Space Amplification: %.2fx (%" PRIu64
+           " bytes stored for %" PRIu64 " live bytes)\n",
+           (double)total.total_bytes / (double)total.live_bytes,
+           total.total_bytes, total.live_bytes);
+  } else {
+    printf("\n  Space Amplification: n/a (no live data)\n");
+  }
+  printf("  Merge Time: %.2f s (%.1f MB/s)\n", (double)elapsed / 1e6,
+         elapsed > 0 ? (double)input_bytes / (1024.0 * 1024.0) /
+                           ((double)elapsed / 1e6)
+                     : 0);
+  if (read_errors > 0)
+    printf("  Warning: %d read errors, results are partial\n", read_errors);
+
+  for (int i = 0; i < file_count; i++)
+    klog_iter_close(&sources[i].it);
+  free(prev_key);
+  free(levels);
+  free(heap_items);
+  free(sources);
+  free(files);
+  return read_errors > 0 ? -1 : 0;
+}
+
+typedef struct {
+  char vlog_path[4096];
+  int has_vlog;
+  uint64_t vlog_size;
+  uint64_t references;
+  uint64_t live_refs;
+  uint64_t blocks;
+  uint64_t live_blocks;
+  uint64_t live_bytes;
+  uint64_t dead_blocks;
+  uint64_t dead_bytes;
+  uint64_t shadowed_blocks; /* only referenced by entries that a newer */
+  uint64_t shadowed_bytes;  /* SSTable's bloom filter claims to replace */
+  uint64_t dangling;
+  int failed;
+} vlog_gc_t;
+
+typedef struct {
+  sstable_set_t set;
+  vlog_gc_t *results;
+  int64_t now;
+} vlog_gc_ctx_t;
+
+static void vlog_gc_worker(void *arg, const int index) {
+  vlog_gc_ctx_t *ctx = arg;
+  vlog_gc_t *r = &ctx->results[index];
+  const uint64_t file_start = trace_now();
+
+  vlog_path_for_klog(ctx->set.files[index].path, r->vlog_path,
+                     sizeof(r->vlog_path));
+  struct stat st;
+  if (stat(r->vlog_path, &st) != 0)
+    return;
+  r->has_vlog = 1;
+  r->vlog_size = (uint64_t)st.st_size;
+
+  offset_set_t live;
+  offset_set_t shadowed;
+  memset(&live, 0, sizeof(live));
+  memset(&shadowed, 0, sizeof(shadowed));
+
+  klog_iter_t it;
+  if (klog_iter_open(&it, ctx->set.files[index].path) != 0) {
+    r->failed = 1;
+    return;
+  }
+  int rc;
+  while ((rc = klog_iter_next(&it)) == 1) {
+    const klog_entry_t *e = &it.entry;
+    if (!(e->flags & TDB_KV_FLAG_HAS_VLOG))
+      continue;
+    r->references++;
+    if (e->flags & TDB_KV_FLAG_TOMBSTONE)
+      continue;
+    if ((e->flags & TDB_KV_FLAG_HAS_TTL) && e->ttl > 0 && e->ttl <= ctx->now)
+      continue;
+    /* a bloom false positive makes a live value look shadowed, so these
+     * are kept apart from the values that are certainly dead */
+    if (sstable_set_shadowed(&ctx->set, index, e->key,
+                             (size_t)e->key_size)) {
+      if (offset_set_add(&shadowed, e->vlog_offset) != 0) {
+        r->failed = 1;
+        break;
+      }
+      continue;
+    }
+    r->live_refs++;
+    if (offset_set_add(&live, e->vlog_offset) != 0) {
+      r->failed = 1;
+      break;
+    }
+  }
+  if (rc < 0)
+    r->failed = 1;
+  klog_iter_close(&it);
+  offset_set_finish(&live);
+  offset_set_finish(&shadowed);
+
+  block_stream_t stream;
+  if (block_stream_open(&stream, r->vlog_path, 8, 0,
+                        ADMINTOOL_HEADER_WALK_BUFFER_SIZE) != 0) {
+    r->failed = 1;
+    offset_set_free(&live);
+    offset_set_free(&shadowed);
+    return;
+  }
+
+  uint64_t found_live = 0;
+  uint64_t pos;
+  uint32_t block_size;
+  while ((rc = block_stream_skip(&stream, &pos, &block_size)) == 1) {
+    const uint64_t span = 8 + (uint64_t)block_size + 8;
+    r->blocks++;
+    if (offset_set_contains(&live, pos)) {
+      r->live_blocks++;
+      r->live_bytes += span;
+      found_live++;
+    } else if (offset_set_contains(&shadowed, pos)) {
+      r->shadowed_blocks++;
+      r->shadowed_bytes += span;
+    } else {
+      r->dead_blocks++;
+      r->dead_bytes += span;
+    }
+  }
+  if (rc < 0)
+    r->failed = 1;
+  block_stream_close(&stream);
+
+  r->dangling = live.count > found_live ? live.count - found_live : 0;
+  offset_set_free(&live);
+  offset_set_free(&shadowed);
+  trace_span("vlog-gc", ctx->set.files[index].name, file_start,
+             "blocks=%" PRIu64, r->blocks);
+}
+
+static int cmd_vlog_gc_report(const int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: vlog-gc-report <cf> [-j threads]\n");
+    printf("Reports live and dead bytes in every vlog of a column family.\n");
+    return -1;
+  }
+
+  char cf_dir[4096];
+  if (resolve_cf_dir(argv[1], cf_dir, sizeof(cf_dir)) != 0) {
+    printf("Column family directory not found: %s\n", argv[1]);
+    return -1;
+  }
+
+  int threads = default_thread_count();
+  for (int i = 2; i < argc; i++) {
+    if ((strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0) &&
+        i + 1 < argc)
+      threads = parse_thread_count(argv[++i]);
+  }
+
+  vlog_gc_ctx_t ctx;
+  memset(&ctx, 0, sizeof(ctx));
+  ctx.now = (int64_t)time(NULL);
+  const uint64_t start = now_us();
+
+  if (sstable_set_load(&ctx.set, cf_dir, threads, 1) != 0) {
+    printf("Failed to load SSTables from %s\n", cf_dir);
+    sstable_set_free(&ctx.set);
+    return -1;
+  }
+
+  ctx.results = calloc((size_t)(ctx.set.count ? ctx.set.count : 1),
+                       sizeof(*ctx.results));
+  if (!ctx.results) {
+    printf("Out of memory\n");
+    sstable_set_free(&ctx.set);
+    return -1;
+  }
+
+  run_parallel(ctx.set.count, threads, vlog_gc_worker, &ctx);
+
+  printf("VLog GC Report: %s\n\n", cf_dir);
+  printf("  %-24s %12s %10s %14s %14s %14s %7s\n", "VLog", "Size", "Blocks",
+         "Live Bytes", "Dead Bytes", "Shadowed~", "Dead%~");
+
+  uint64_t total_size = 0;
+  uint64_t total_live = 0;
+  uint64_t total_dead = 0;
+  uint64_t total_shadowed = 0;
+  int vlog_count = 0;
+  int issues = 0;
+  for (int i = 0; i < ctx.set.count; i++) {
+    const vlog_gc_t *r = &ctx.results[i];
+    if (!r->has_vlog)
+      continue;
+    vlog_count++;
+    const char *name = strrchr(r->vlog_path, '/');
+    name = name ? name + 1 : r->vlog_path;
+    const uint64_t reclaimable = r->dead_bytes + r->shadowed_bytes;
+    printf("  %-24s %12" PRIu64 " %10" PRIu64 " %14" PRIu64 " %14" PRIu64
+           " %14" PRIu64 " %6.1f%%\n",
+           name, r->vlog_size, r->blocks, r->live_bytes, r->dead_bytes,
+           r->shadowed_bytes,
+           percent_of(reclaimable, r->live_bytes + reclaimable));
+    if (r->dangling > 0) {
+      printf("  %-24s %" PRIu64 " live references do not start a block\n", "",
+             r->dangling);
+      issues++;
+    }
+    if (r->failed) {
+      printf("  %-24s read error, results are partial\n", "");
+      issues++;
+    }
+    total_size += r->vlog_size;
+    total_live += r->live_bytes;
+    total_dead += r->dead_bytes;
+    total_shadowed += r->shadowed_bytes;
+  }
+
+  cf_file_t *vlogs = NULL;
+  int vlog_files = 0;
+  if (list_cf_files(cf_dir, ".vlog", &vlogs, &vlog_files) == 0) {
+    for (int v = 0; v < vlog_files; v++) {
+      int paired = 0;
+      for (int i = 0; i < ctx.set.count && !paired; i++)
+        paired = ctx.results[i].has_vlog &&
+                 strcmp(ctx.results[i].vlog_path, vlogs[v].path) == 0;
+      if (paired)
+        continue;
+      printf("  %-24s %12" PRIu64 " (orphan: no matching klog, all dead)\n",
+             vlogs[v].name, vlogs[v].file_size);
+      vlog_count++;
+      total_size += vlogs[v].file_size;
+      if (vlogs[v].file_size > 8)
+        total_dead += vlogs[v].file_size - 8;
+    }
+    free(vlogs);
+  }
+
+  if (vlog_count == 0) {
+    printf("  (no vlog files found)\n");
+  } else {
+    printf("\n  Total: %d vlogs, %" PRIu64 " bytes\n", vlog_count, total_size);
+    const uint64_t reclaimable = total_dead + total_shadowed;
+    printf("    Live: %" PRIu64 " bytes\n", total_live);
+    printf("    Dead: %" PRIu64 " bytes (unreferenced)\n", total_dead);
+    printf("    Shadowed (est.): %" PRIu64 " bytes\n", total_shadowed);
+    printf("    Reclaimable by a rewrite: %.1f%% to %.1f%%\n",
+           percent_of(total_dead, total_live + reclaimable),
+           percent_of(reclaimable, total_live + reclaimable));
+    printf("  (~ includes values a newer SSTable's bloom filter claims; "
+           "false\n   positives make it an upper bound)\n");
+  }
+  printf("  Elapsed: %.2f s\n", (double)(now_us() - start) / 1e6);
+
+  free(ctx.results);
+  sstable_set_free(&ctx.set);
+  return issues > 0 ? -1 : 0;
+}
+
+typedef struct {
+  int level;
+  uint64_t *keys;
+  uint64_t *bytes;
+  uint64_t total_keys;
+  uint64_t ttl_keys;
+  uint64_t expired_keys;
+  uint64_t expired_bytes;
+  uint64_t later_keys;
+  uint64_t later_bytes;
+  int failed;
+} ttl_forecast_t;
+
+typedef struct {
+  cf_file_t *files;
+  ttl_forecast_t *results;
+  int64_t now;
+  int64_t bucket_secs;
+  int buckets;
+} ttl_forecast_ctx_t;
+
+static void ttl_forecast_worker(void *arg, const int index) {
+  ttl_forecast_ctx_t *ctx = arg;
+  ttl_forecast_t *r = &ctx->results[index];
+  const uint64_t file_start = trace_now();
+
+  klog_iter_t it;
+  if (klog_iter_open(&it, ctx->files[index].path) != 0) {
+    r->failed = 1;
+    return;
+  }
+  int rc;
+  while ((rc = klog_iter_next(&it)) == 1) {
+    const klog_entry_t *e = &it.entry;
+    r->total_keys++;
+    if (!(e->flags & TDB_KV_FLAG_HAS_TTL) || e->ttl <= 0)
+      continue;
+    r->ttl_keys++;
+    const uint64_t bytes = klog_entry_bytes(e);
+    if (e->ttl <= ctx->now) {
+      r->expired_keys++;
+      r->expired_bytes += bytes;
+      continue;
+    }
+    const int64_t bucket = (e->ttl - ctx->now) / ctx->bucket_secs;
+    if (bucket >= ctx->buckets) {
+      r->later_keys++;
+      r->later_bytes += bytes;
+      continue;
+    }
+    r->keys[bucket]++;
+    r->bytes[bucket] += bytes;
+  }
+  if (rc < 0)
+    r->failed = 1;
+  klog_iter_close(&it);
+  trace_span("ttl-forecast", ctx->files[index].name, file_start,
+             "ttl_keys=%" PRIu64, r->ttl_keys);
+}
+
+static int cmd_ttl_forecast(const int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: ttl-forecast <cf> [--bucket hour|day] [--buckets N] "
+           "[-j threads]\n");
+    printf("Forecasts bytes and keys expiring over time, per level.\n");
+    return -1;
+  }
+
+  char cf_dir[4096];
+  if (resolve_cf_dir(argv[1], cf_dir, sizeof(cf_dir)) != 0) {
+    printf("Column family directory not found: %s\n", argv[1]);
+    return -1;
+  }
+
+  ttl_forecast_ctx_t ctx;
+  memset(&ctx, 0, sizeof(ctx));
+  ctx.bucket_secs = 3600;
+  ctx.buckets = 0;
+  int threads = default_thread_count();
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--bucket") == 0 && i + 1 < argc) {
+      i++;
+      if (strcmp(argv[i], "day") == 0) {
+        ctx.bucket_secs = 86400;
+      } else if (strcmp(argv[i], "hour") != 0) {
+        printf("Unknown bucket '%s' (use hour or day)\n", argv[i]);
+        return -1;
+      }
+    } else if (strcmp(argv[i], "--buckets") == 0 && i + 1 < argc) {
+      ctx.buckets = atoi(argv[++i]);
+    } else if ((strcmp(argv[i], "-j") == 0 ||
+                strcmp(argv[i], "--jobs") == 0) &&
+               i + 1 < argc) {
+      threads = parse_thread_count(argv[++i]);
+    }
+  }
+  if (ctx.buckets <= 0)
+    ctx.buckets = ctx.bucket_secs == 86400 ? 30 : 48;
+
+  int file_count = 0;
+  if (list_cf_files(cf_dir, ".klog", &ctx.files, &file_count) != 0) {
+    printf("Failed to list SSTables in %s\n", cf_dir);
+    return -1;
+  }
+
+  const size_t slots = (size_t)file_count * (size_t)ctx.buckets;
+  ctx.results = calloc((size_t)(file_count ? file_count : 1),
+                       sizeof(*ctx.results));
+  uint64_t *counters = calloc(slots ? slots * 2 : 1, sizeof(uint64_t));
+  if (!ctx.results || !counters) {
+    printf("Out of memory\n");
+    free(ctx.results);
+    free(counters);
+    free(ctx.files);
+    return -1;
+  }
+  int max_level = 0;
+  for (int i = 0; i < file_count; i++) {
+    ctx.results[i].level = ctx.files[i].level;
+    ctx.results[i].keys = counters + (size_t)i * (size_t)ctx.buckets;
+    ctx.results[i].bytes = counters + slots + (size_t)i * (size_t)ctx.buckets;
+    if (ctx.files[i].level > max_level)
+      max_level = ctx.files[i].level;
+  }
+
+  ctx.now = (int64_t)time(NULL);
+  const uint64_t start = now_us();
+  run_parallel(file_count, threads, ttl_forecast_worker, &ctx);
+
+  uint64_t total_keys = 0;
+  uint64_t ttl_keys = 0;
+  uint64_t expired_keys = 0;
+  uint64_t expired_bytes = 0;
+  uint64_t later_keys = 0;
+  uint64_t later_bytes = 0;
+  int failed = 0;
+  for (int i = 0; i < file_count; i++) {
+    const ttl_forecast_t *r = &ctx.results[i];
+    total_keys += r->total_keys;
+    ttl_keys += r->ttl_keys;
+    expired_keys += r->expired_keys;
+    expired_bytes += r->expired_bytes;
+    later_keys += r->later_keys;
+    later_bytes += r->later_bytes;
+    if (r->failed) {
+      printf("Warning: failed to read %s, results are partial\n",
+             ctx.files[i].name);
+      failed++;
+    }
+  }
+
+  printf("TTL Forecast: %s\n", cf_dir);
+  printf("  SSTables: %d, Entries: %" PRIu64 ", With TTL: %" PRIu64
+         " (%.1f%%)\n",
+         file_count, total_keys, ttl_keys, percent_of(ttl_keys, total_keys));
+  printf("  Already Expired: %" PRIu64 " keys, %" PRIu64
+         " bytes (awaiting compaction)\n",
+         expired_keys, expired_bytes);
+  for (int level = 0; level <= max_level; level++) {
+    uint64_t level_bytes = 0;
+    for (int i = 0; i < file_count; i++) {
+      if (ctx.results[i].level == level)
+        level_bytes += ctx.results[i].expired_bytes;
+    }
+    if (level_bytes > 0)
+      printf("    L%-3d %" PRIu64 " bytes\n", level, level_bytes);
+  }
+
+  printf("\n  Expiring per %s:\n", ctx.bucket_secs == 86400 ? "day" : "hour");
+  printf("  %-18s %10s %14s %14s  %s\n", "Starting", "Keys", "Bytes",
+         "Cumulative", "Bytes by Level");
+  uint64_t cumulative = 0;
+  int printed = 0;
+  for (int b = 0; b < ctx.buckets; b++) {
+    uint64_t keys = 0;
+    uint64_t bytes = 0;
+    for (int i = 0; i < file_count; i++) {
+      keys += ctx.results[i].keys[b];
+      bytes += ctx.results[i].bytes[b];
+    }
+    if (keys == 0)
+      continue;
+    cumulative += bytes;
+
+    const time_t bucket_start = (time_t)(ctx.now + b * ctx.bucket_secs);
+    char when[32];
+    const struct tm *tm = localtime(&bucket_start);
+    if (!tm || strftime(when, sizeof(when), "%Y-%m-%d %H:%M", tm) == 0)
+      snprintf(when, sizeof(when), "+%d", b);
+    printf("  %-18s %10" PRIu64 " %14" PRIu64 " %14" PRIu64 " ", when, keys,
+           bytes, cumulative);
+    for (int level = 0; level <= max_level; level++) {
+      uint64_t level_bytes = 0;
+      for (int i = 0; i < file_count; i++) {
+        if (ctx.results[i].level == level)
+          level_bytes += ctx.results[i].bytes[b];
+      }
+      if (level_bytes > 0)
+        printf(" L%d=%" PRIu64, level, level_bytes);
+    }
+    printf("\n");
+    printed++;
+  }
+  if (printed == 0)
+    printf("  (nothing expires in the next %d %ss)\n", ctx.buckets,
+           ctx.bucket_secs == 86400 ? "day" : "hour");
+  if (later_keys > 0)
+    printf("  %-18s %10" PRIu64 " %14" PRIu64 "\n", "later", later_keys,
+           later_bytes);
+
+  printf("\n  Elapsed: %.2f s\n", (double)(now_us() - start) / 1e6);
+
+  free(counters);
+  free(ctx.results);
+  free(ctx.files);
+  return failed > 0 ? -1 : 0;
+}
+
+typedef struct {
+  cf_file_t file;
+  int is_wal;
+  uint64_t entries;
+  uint64_t min_seq;
+  uint64_t max_seq;
+  int failed;
+} seq_range_t;
+
+typedef struct {
+  uint64_t lo;
+  uint64_t hi;
+} seq_interval_t;
+
+static void seq_range_worker(void *arg, const int index) {
+  seq_range_t *r = &((seq_range_t *)arg)[index];
+  const uint64_t file_start = trace_now();
+  r->min_seq = UINT64_MAX;
+
+  int rc;
+  if (r->is_wal) {
+    block_stream_t stream;
+    if (block_stream_open(&stream, r->file.path, 8, 0, 0) != 0) {
+      r->failed = 1;
+      return;
+    }
+    stream_block_t block;
+    klog_entry_t entry;
+    while ((rc = block_stream_next(&stream, &block)) == 1) {
+      if (wal_decode_entry(block.data, block.size, &entry) != 0)
+        continue;
+      r->entries++;
+      if (entry.seq < r->min_seq)
+        r->min_seq = entry.seq;
+      if (entry.seq > r->max_seq)
+        r->max_seq = entry.seq;
+    }
+    block_stream_close(&stream);
+  } else {
+    klog_iter_t it;
+    if (klog_iter_open(&it, r->file.path) != 0) {
+      r->failed = 1;
+      return;
+    }
+    while ((rc = klog_iter_next(&it)) == 1) {
+      r->entries++;
+      if (it.entry.seq < r->min_seq)
+        r->min_seq = it.entry.seq;
+      if (it.entry.seq > r->max_seq)
+        r->max_seq = it.entry.seq;
+    }
+    klog_iter_close(&it);
+  }
+  if (rc < 0)
+    r->failed = 1;
+  trace_span("seq-timeline", r->file.name, file_start,
+             "entries=%" PRIu64, r->entries);
+}
+
+static int seq_interval_compare(const void *a, const void *b) {
+  const seq_interval_t *ia = a;
+  const seq_interval_t *ib = b;
+  if (ia->lo != ib->lo)
+    return ia->lo < ib->lo ? -1 : 1;
+  return ia->hi < ib->hi ? -1 : (ia->hi > ib->hi);
+}
+
+/* sorts and merges intervals in place, returning the merged count */
+static int seq_interval_merge(seq_interval_t *iv, const int count) {
+  if (count == 0)
+    return 0;
+  qsort(iv, (size_t)count, sizeof(*iv), seq_interval_compare);
+  int merged = 0;
+  for (int i = 1; i < count; i++) {
+    if (iv[i].lo <= iv[merged].hi + 1) {
+      if (iv[i].hi > iv[merged].hi)
+        iv[merged].hi = iv[i].hi;
+    } else {
+      iv[++merged] = iv[i];
+    }
+  }
+  return merged + 1;
+}
+
+static int cmd_seq_timeline(const int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: seq-timeline <cf> [-j threads]\n");
+    printf("Reports sequence ranges, level overlaps, gaps and write-amp.\n");
+    return -1;
+  }
+
+  char cf_dir[4096];
+  if (resolve_cf_dir(argv[1], cf_dir, sizeof(cf_dir)) != 0) {
+    printf("Column family directory not found: %s\n", argv[1]);
+    return -1;
+  }
+
+  int threads = default_thread_count();
+  for (int i = 2; i < argc; i++) {
+    if ((strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0) &&
+        i + 1 < argc)
+      threads = parse_thread_count(argv[++i]);
+  }
+
+  cf_file_t *klogs = NULL;
+  cf_file_t *wals = NULL;
+  int klog_count = 0;
+  int wal_count = 0;
+  if (list_cf_files(cf_dir, ".klog", &klogs, &klog_count) != 0 ||
+      list_cf_files(cf_dir, ".log", &wals, &wal_count) != 0) {
+    printf("Failed to list files in %s\n", cf_dir);
+    free(klogs);
+    return -1;
+  }
+
+  const int count = klog_count + wal_count;
+  seq_range_t *ranges = calloc((size_t)(count ? count : 1), sizeof(*ranges));
+  seq_interval_t *intervals =
+      calloc((size_t)(count ? count : 1), sizeof(*intervals));
+  if (!ranges || !intervals) {
+    printf("Out of memory\n");
+    free(ranges);
+    free(intervals);
+    free(klogs);
+    free(wals);
+    return -1;
+  }
+  for (int i = 0; i < wal_count; i++) {
+    ranges[i].file = wals[i];
+    ranges[i].is_wal = 1;
+  }
+  for (int i = 0; i < klog_count; i++)
+    ranges[wal_count + i].file = klogs[i];
+  free(klogs);
+  free(wals);
+
+  const uint64_t start = now_us();
+  run_parallel(count, threads, seq_range_worker, ranges);
+
+  printf("Sequence Timeline: %s\n\n", cf_dir);
+  printf("  %-24s %6s %10s %14s %14s\n", "File", "Level", "Entries",
+         "Min Seq", "Max Seq");
+
+  int max_level = 0;
+  int interval_count = 0;
+  uint64_t span_total = 0;
+  int failed = 0;
+  for (int i = 0; i < count; i++) {
+    const seq_range_t *r = &ranges[i];
+    char level[16];
+    if (r->is_wal)
+      snprintf(level, sizeof(level), "WAL");
+    else
+      snprintf(level, sizeof(level), "L%d", r->file.level);
+    if (r->failed)
+      failed++;
+    if (r->entries == 0) {
+      printf("  %-24s %6s %10s%s\n", r->file.name, level, "empty",
+             r->failed ? " (read error)" : "");
+      continue;
+    }
+    printf("  %-24s %6s %10" PRIu64 " %14" PRIu64 " %14" PRIu64 "%s\n",
+           r->file.name, level, r->entries, r->min_seq, r->max_seq,
+           r->failed ? " (partial)" : "");
+    intervals[interval_count].lo = r->min_seq;
+    intervals[interval_count].hi = r->max_seq;
+    interval_count++;
+    span_total += r->max_seq - r->min_seq + 1;
+    if (!r->is_wal && r->file.level > max_level)
+      max_level = r->file.level;
+  }
+
+  /* level -1 stands for the WALs */
+  printf("\n  Ranges by Level:\n");
+  seq_interval_t *level_range =
+      calloc((size_t)max_level + 2, sizeof(*level_range));
+  uint64_t *level_entries = calloc((size_t)max_level + 2, sizeof(uint64_t));
+  if (level_range && level_entries) {
+    for (int l = 0; l <= max_level + 1; l++)
+      level_range[l].lo = UINT64_MAX;
+    for (int i = 0; i < count; i++) {
+      const seq_range_t *r = &ranges[i];
+      if (r->entries == 0)
+        continue;
+      const int slot = r->is_wal ? 0 : r->file.level + 1;
+      if (r->min_seq < level_range[slot].lo)
+        level_range[slot].lo = r->min_seq;
+      if (r->max_seq > level_range[slot].hi)
+        level_range[slot].hi = r->max_seq;
+      level_entries[slot] += r->entries;
+    }
+    for (int a = 0; a <= max_level + 1; a++) {
+      if (level_entries[a] == 0)
+        continue;
+      char name[16];
+      snprintf(name, sizeof(name), a == 0 ? "WAL" : "L%d", a - 1);
+      printf("    %-5s %14" PRIu64 " .. %-14" PRIu64 " %10" PRIu64
+             " entries\n",
+             name, level_range[a].lo, level_range[a].hi, level_entries[a]);
+    }
+
+    int overlaps = 0;
+    printf("\n  Overlaps Between Levels:\n");
+    for (int a = 0; a <= max_level + 1; a++) {
+      for (int b = a + 1; b <= max_level + 1; b++) {
+        if (level_entries[a] == 0 || level_entries[b] == 0)
+          continue;
+        const uint64_t lo = level_range[a].lo > level_range[b].lo
+                                ? level_range[a].lo
+                                : level_range[b].lo;
+        const uint64_t hi = level_range[a].hi < level_range[b].hi
+                                ? level_range[a].hi
+                                : level_range[b].hi;
+        if (lo > hi)
+          continue;
+        char name_a[16];
+        char name_b[16];
+        snprintf(name_a, sizeof(name_a), a == 0 ? "WAL" : "L%d", a - 1);
+        snprintf(name_b, sizeof(name_b), "L%d", b - 1);
+        printf("    %s / %s: %" PRIu64 " .. %" PRIu64 " (%" PRIu64
+               " seqs)\n",
+               name_a, name_b, lo, hi, hi - lo + 1);
+        overlaps++;
+      }
+    }
+    if (overlaps == 0)
+      printf("    (none)\n");
+  }
+  free(level_range);
+  free(level_entries);
+
+  const int merged = seq_interval_merge(intervals, interval_count);
+  uint64_t unique = 0;
+  for (int i = 0; i < merged; i++)
+    unique += intervals[i].hi - intervals[i].lo + 1;
+
+  printf("\n  Gaps (seqs held by no file):\n");
+  uint64_t gap_total = 0;
+  for (int i = 1; i < merged; i++) {
+    const uint64_t lo = intervals[i - 1].hi + 1;
+    const uint64_t hi = intervals[i].lo - 1;
+    gap_total += hi - lo + 1;
+    if (i <= 10)
+      printf("    %" PRIu64 " .. %" PRIu64 " (%" PRIu64 " seqs)\n", lo, hi,
+             hi - lo + 1);
+  }
+  if (merged > 11)
+    printf("    ... %d more gaps\n", merged - 11);
+  if (merged <= 1)
+    printf("    (none)\n");
+  else
+    printf("    Total: %" PRIu64 " seqs in %d gaps\n", gap_total, merged - 1);
+
+  printf("\n  Seq Spans: %" PRIu64 " across files, %" PRIu64 " unique\n",
+         span_total, unique);
+  printf("  Write Amplification (estimate): %.2fx\n",
+         unique > 0 ? (double)span_total / (double)unique : 0.0);
+  printf("  Elapsed: %.2f s\n", (double)(now_us() - start) / 1e6);
+
+  free(intervals);
+  free(ranges);
+  return failed > 0 ? -1 : 0;
+}
+
+static int remove_tree(const char *path) {
+  DIR *dir = opendir(path);
+  if (dir == NULL)
+    return remove(path);
+
+  int rc = 0;
+  struct dirent *ent;
+  while ((ent = readdir(dir)) != NULL) {
+    if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
+      continue;
+    char child[4096];
+    snprintf(child, sizeof(child), "%s/%s", path, ent->d_name);
+    struct stat st;
+    if (lstat(child, &st) == 0 && S_ISDIR(st.st_mode)) {
+      if (remove_tree(child) != 0)
+        rc = -1;
+    } else if (remove(child) != 0) {
+      rc = -1;
+    }
+  }
+  closedir(dir);
+  if (rmdir(path) != 0)
+    rc = -1;
+  return rc;
+}
+
+static int dir_is_empty(const char *path) {
+  DIR *dir = opendir(path);
+  if (dir == NULL)
+    return errno == ENOENT;
+  int empty = 1;
+  struct dirent *ent;
+  while ((ent = readdir(dir)) != NULL) {
+    if (strcmp(ent->d_name, ".") != 0 && strcmp(ent->d_name, "..") != 0) {
+      empty = 0;
+      break;
+    }
+  }
+  closedir(dir);
+  return empty;
+}
+
+typedef struct {
+  tidesdb_t *db;
+  tidesdb_column_family_t *cf;
+  tidesdb_txn_t *txn;
+  int pending;
+  uint64_t pending_bytes;
+  uint64_t commits;
+  uint64_t failures;
+  uint64_t applied; /* entries in committed transactions only */
+  uint64_t applied_bytes;
+} recovery_sink_t;
+
+static int recovery_sink_commit(recovery_sink_t *sink) {
+  if (sink->txn == NULL)
+    return 0;
+  int ret = TDB_SUCCESS;
+  if (sink->pending > 0) {
+    ret = tidesdb_txn_commit(sink->txn);
+    if (ret == TDB_SUCCESS) {
+      sink->commits++;
+      sink->applied += (uint64_t)sink->pending;
+      sink->applied_bytes += sink->pending_bytes;
+    } else {
+      sink->failures += (uint64_t)sink->pending;
+    }
+  } else {
+    tidesdb_txn_rollback(sink->txn);
+  }
+  tidesdb_txn_free(sink->txn);
+  sink->txn = NULL;
+  sink->pending = 0;
+  sink->pending_bytes = 0;
+  return ret;
+}
+
+static int recovery_sink_apply(recovery_sink_t *sink, const klog_entry_t *e,
+                               const int batch) {
+  if (sink->txn == NULL) {
+    const int ret = tidesdb_txn_begin(sink->db, &sink->txn);
+    if (ret != TDB_SUCCESS)
+      return ret;
+  }
+
+  int ret;
+  if (e->flags & TDB_KV_FLAG_TOMBSTONE)
+    ret = tidesdb_txn_delete(sink->txn, sink->cf, e->key,
+                             (size_t)e->key_size);
+  else
+    ret = tidesdb_txn_put(sink->txn, sink->cf, e->key, (size_t)e->key_size,
+                          e->value, (size_t)e->value_size,
+                          (e->flags & TDB_KV_FLAG_HAS_TTL) ? (time_t)e->ttl
+                                                           : 0);
+  if (ret != TDB_SUCCESS) {
+    sink->failures++;
+    return 0;
+  }
+  sink->pending_bytes += e->key_size + e->value_size;
+  if (++sink->pending >= batch)
+    return recovery_sink_commit(sink);
+  return 0;
+}
+
+static int cmd_bench_recovery(const int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: bench-recovery <wal_path|dir|glob>... [--into dir] "
+           "[--batch N]\n");
+    printf("Replays WAL entries into a scratch database and times it.\n");
+    return -1;
+  }
+
+  const char *into = NULL;
+  int batch = 1000;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--into") == 0 && i + 1 < argc) {
+      into = argv[++i];
+    } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+      batch = atoi(argv[++i]);
+      if (batch < 1)
+        batch = 1;
+    }
+  }
+
+  static const char *const value_flags[] = {"--into", "--batch", NULL};
+  cf_file_t *files = NULL;
+  int count = 0;
+  if (collect_target_files(argv + 1, argc - 1, value_flags, ".log", &files,
+                           &count) != 0) {
+    free(files);
+    return -1;
+  }
+  if (count == 0) {
+    printf("No WAL files found\n");
+    return -1;
+  }
+  qsort(files, (size_t)count, sizeof(*files), wal_id_compare);
+
+  /* the scratch database must never be a live one, so an existing --into
+   * directory has to be empty; a directory we create ourselves is removed
+   * again once the run is over */
+  char scratch[4096];
+  int owned = 0;
+  if (into != NULL) {
+    if (!dir_is_empty(into)) {
+      printf("Scratch directory '%s' is not empty\n", into);
+      free(files);
+      return -1;
+    }
+    snprintf(scratch, sizeof(scratch), "%s", into);
+  } else {
+#ifndef _WIN32
+    const char *tmp = getenv("TMPDIR");
+    snprintf(scratch, sizeof(scratch), "%s/admintool-recovery-XXXXXX",
+             tmp && *tmp ? tmp : "/tmp");
+    if (mkdtemp(scratch) == NULL) {
+      printf("Failed to create scratch directory: %s\n", strerror(errno));
+      free(files);
+      return -1;
+    }
+    owned = 1;
+#else
+    printf("--into <dir> is required on this platform\n");
+    free(files);
+    return -1;
+#endif
+  }
+
+  const uint64_t open_start = now_us();
+  tidesdb_config_t config = tidesdb_default_config();
+  config.db_path = scratch;
+  config.log_level = TDB_LOG_NONE;
+  recovery_sink_t sink;
+  memset(&sink, 0, sizeof(sink));
+  int ret = tidesdb_open(&config, &sink.db);
+  if (ret != TDB_SUCCESS) {
+    printf("Failed to open scratch database: %s\n", error_to_string(ret));
+    if (owned)
+      remove_tree(scratch);
+    free(files);
+    return ret;
+  }
+  tidesdb_column_family_config_t cf_config =
+      tidesdb_default_column_family_config();
+  ret = tidesdb_create_column_family(sink.db, "recovery", &cf_config);
+  sink.cf = ret == TDB_SUCCESS
+                ? tidesdb_get_column_family(sink.db, "recovery")
+                : NULL;
+  if (sink.cf == NULL) {
+    printf("Failed to create scratch column family: %s\n",
+           error_to_string(ret));
+    tidesdb_close(sink.db);
+    if (owned)
+      remove_tree(scratch);
+    free(files);
+    return ret != TDB_SUCCESS ? ret : -1;
+  }
+  const uint64_t open_us = now_us() - open_start;
+
+  uint64_t decoded = 0;
+  uint64_t wal_bytes = 0;
+  uint64_t bad_blocks = 0;
+  uint64_t read_us = 0;
+  uint64_t decode_us = 0;
+  uint64_t apply_us = 0;
+  ret = 0;
+  const uint64_t replay_start = now_us();
+
+  for (int f = 0; f < count && ret == 0 && !g_interrupted; f++) {
+    const uint64_t file_start = trace_now();
+    block_stream_t stream;
+    if (block_stream_open(&stream, files[f].path, 8, 0, 0) != 0) {
+      printf("Failed to open WAL file: %s\n", files[f].path);
+      bad_blocks++;
+      continue;
+    }
+    wal_bytes += stream.end > 8 ? stream.end - 8 : 0;
+
+    stream_block_t block;
+    klog_entry_t entry;
+    int rc;
+    uint64_t t0 = now_us();
+    for (;;) {
+      rc = block_stream_next(&stream, &block);
+      const uint64_t t1 = now_us();
+      read_us += t1 - t0;
+      if (rc != 1)
+        break;
+      const int bad = wal_decode_entry(block.data, block.size, &entry);
+      const uint64_t t2 = now_us();
+      decode_us += t2 - t1;
+      t0 = t2;
+      if (bad != 0) {
+        bad_blocks++;
+        continue;
+      }
+      ret = recovery_sink_apply(&sink, &entry, batch);
+      t0 = now_us();
+      apply_us += t0 - t2;
+      if (ret != 0)
+        break;
+      if ((++decoded & 0xffff) == 0 && g_interrupted)
+        break;
+    }
+    if (rc < 0)
+      bad_blocks++;
+    block_stream_close(&stream);
+    trace_span("bench-recovery", files[f].name, file_start, NULL);
+  }
+
+  uint64_t t = now_us();
+  if (ret == 0)
+    ret = recovery_sink_commit(&sink);
+  else
+    recovery_sink_commit(&sink);
+  apply_us += now_us() - t;
+  const uint64_t replay_us = now_us() - replay_start;
+
+  t = now_us();
+  tidesdb_close(sink.db);
+  const uint64_t close_us = now_us() - t;
+
+  /* failed puts and entries of a failed commit never reached the engine,
+   * so they count as failures rather than replayed work */
+  const uint64_t entries = sink.applied;
+  const uint64_t payload_bytes = sink.applied_bytes;
+  const double replay_secs = (double)replay_us / 1e6;
+  printf("Recovery Benchmark: %d WAL files into '%s'\n", count, scratch);
+  printf("  Entries Replayed: %" PRIu64 " (batch %d, %" PRIu64
+         " commits)\n",
+         entries, batch, sink.commits);
+  if (sink.failures > 0)
+    printf("  Failed Writes: %" PRIu64 "\n", sink.failures);
+  if (bad_blocks > 0)
+    printf("  Unreadable Blocks: %" PRIu64 " (run wal-verify)\n", bad_blocks);
+  if (ret != 0)
+    printf("  Stopped early: %s\n", error_to_string(ret));
+  else if (g_interrupted)
+    printf("  Interrupted; figures cover the entries replayed so far\n");
+  printf("  WAL Bytes: %" PRIu64 " (%.2f MB), Payload Bytes: %" PRIu64
+         " (%.2f MB)\n",
+         wal_bytes, (double)wal_bytes / (1024 * 1024), payload_bytes,
+         (double)payload_bytes / (1024 * 1024));
+  printf("\n  Time:\n");
+  printf("    Open + create CF: %9.3f s\n", (double)open_us / 1e6);
+  printf("    Read:             %9.3f s (%5.1f%%)\n", (double)read_us / 1e6,
+         percent_of(read_us, replay_us));
+  printf("    Decode:           %9.3f s (%5.1f%%)\n",
+         (double)decode_us / 1e6, percent_of(decode_us, replay_us));
+  printf("    Apply:            %9.3f s (%5.1f%%)\n", (double)apply_us / 1e6,
+         percent_of(apply_us, replay_us));
+  printf("    Replay total:     %9.3f s\n", replay_secs);
+  printf("    Close:            %9.3f s\n", (double)close_us / 1e6);
+  if (replay_secs > 0) {
+    printf("\n  Throughput:\n");
+    printf("    %.0f entries/sec\n", (double)entries / replay_secs);
+    printf("    %.2f MB/sec of WAL, %.2f MB/sec of payload\n",
+           (double)wal_bytes / (1024 * 1024) / replay_secs,
+           (double)payload_bytes / (1024 * 1024) / replay_secs);
+  }
+
+  if (owned && remove_tree(scratch) != 0)
+    printf("  Warning: could not remove scratch directory '%s'\n", scratch);
+  free(files);
+  return ret;
+}
+
+/* what a flush or compaction changes, so the wait can tell that it ran */
+typedef struct {
+  int sstables;
+  size_t memtable_size;
+} cf_progress_t;
+
+static int cf_progress(tidesdb_column_family_t *cf, cf_progress_t *out) {
+  tidesdb_stats_t *stats = NULL;
+  if (tidesdb_get_stats(cf, &stats) != TDB_SUCCESS || stats == NULL)
+    return -1;
+  out->sstables = 0;
+  for (int i = 0; i < stats->num_levels; i++)
+    out->sstables += stats->level_num_sstables[i];
+  out->memtable_size = stats->memtable_size;
+  tidesdb_free_stats(stats);
+  return 0;
+}
+
+/* the engine runs flushes and compactions on background threads, so right
+ * after the trigger the op may not be active yet; polling for idle straight
+ * away would report it finished before it started.  The wait first sees
+ * the op become active or the SSTable count change, then polls for idle */
+static void wait_until_idle(tidesdb_column_family_t *cf, const int compaction,
+                            const char *cf_name, const cf_progress_t *before) {
+  const char *cat = compaction ? "compaction" : "flush";
+  const uint64_t wait_start = now_us();
+  const uint64_t trace_wait_start = trace_now();
+  int polls = 0;
+  int idle_polls = 0;
+  int started = 0;
+
+  void (*prev_int)(int) = signal(SIGINT, handle_interrupt);
+  g_interrupted = 0;
+
+  while (!g_interrupted && idle_polls < 2) {
+    const uint64_t poll_start = trace_now();
+    const int busy =
+        compaction ? tidesdb_is_compacting(cf) : tidesdb_is_flushing(cf);
+    cf_progress_t now;
+    if (!started && (busy || (before != NULL && cf_progress(cf, &now) == 0 &&
+                              (now.sstables != before->sstables ||
+                               now.memtable_size < before->memtable_size))))
+      started = 1;
+    polls++;
+    if (started)
+      idle_polls = busy ? 0 : idle_polls + 1;
+    else if (now_us() - wait_start >= ADMINTOOL_WAIT_START_TIMEOUT_US)
+      break;
+    usleep(ADMINTOOL_POLL_INTERVAL_US);
+    trace_span(cat, "poll", poll_start, "cf=%s busy=%d started=%d", cf_name,
+               busy, started);
+  }
+
+  trace_span(cat, compaction ? "compaction wait" : "flush wait",
+             trace_wait_start, "cf=%s polls=%d", cf_name, polls);
+
+  printf("%s %s for '%s' (waited %.2f s, %d polls)\n",
+         compaction ? "Compaction" : "Flush",
+         g_interrupted ? "wait interrupted"
+         : started     ? "finished"
+                       : "did not start",
+         cf_name, (double)(now_us() - wait_start) / 1e6, polls);
+
+  signal(SIGINT, prev_int);
+  g_interrupted = 0;
+}
+
+static int cmd_compact(const int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: compact <cf> [--wait]\n");
+    return -1;
+  }
+
+  if (g_db == NULL) {
+    printf("No database is open.\n");
+    return -1;
+  }
+
+  tidesdb_column_family_t *cf = tidesdb_get_column_family(g_db, argv[1]);
+  if (cf == NULL) {
+    printf("Column family '%s' not found.\n", argv[1]);
+    return -1;
+  }
+
+  const int wait = argc >= 3 && strcmp(argv[2], "--wait") == 0;
+  cf_progress_t before;
+  const int have_before = wait && cf_progress(cf, &before) == 0;
+
+  const int ret = tidesdb_compact(cf);
+  if (ret != TDB_SUCCESS) {
+    printf("Failed to trigger compaction: %s\n", error_to_string(ret));
+    return ret;
+  }
+
+  printf("Compaction triggered for '%s'\n", argv[1]);
+  if (wait)
+    wait_until_idle(cf, 1, argv[1], have_before ? &before : NULL);
+  return 0;
+}
+
+static int cmd_flush(const int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: flush <cf> [--wait]\n");
+    return -1;
+  }
+
+  if (g_db == NULL) {
+    printf("No database is open.\n");
+    return -1;
+  }
+
+  tidesdb_column_family_t *cf = tidesdb_get_column_family(g_db, argv[1]);
+  if (cf == NULL) {
+    printf("Column family '%s' not found.\n", argv[1]);
+    return -1;
+  }
+
+  const int wait = argc >= 3 && strcmp(argv[2], "--wait") == 0;
+  cf_progress_t before;
+  const int have_before = wait && cf_progress(cf, &before) == 0;
+
+  const int ret = tidesdb_flush_memtable(cf);
+  if (ret != TDB_SUCCESS) {
+    printf("Failed to flush memtable: %s\n", error_to_string(ret));
+    return ret;
+  }
+
+  printf("Memtable flushed for '%s'\n", argv[1]);
+  if (wait && have_before && before.memtable_size == 0)
+    printf("Nothing to wait for: the memtable was empty\n");
+  else if (wait)
+    wait_until_idle(cf, 0, argv[1], have_before ? &before : NULL);
+  return 0;
+}
+
+#ifndef _WIN32
+typedef struct {
+  const char *name;
+  tidesdb_stats_t *stats;
+  int flushing;
+  int compacting;
+} metrics_cf_sample_t;
+
+typedef struct {
+  const char *name;
+  const char *type;
+  const char *help;
+} metrics_family_t;
+
+enum {
+  METRIC_CF_MEMTABLE_SIZE,
+  METRIC_CF_LEVELS,
+  METRIC_CF_KEYS,
+  METRIC_CF_DATA_SIZE,
+  METRIC_CF_AVG_KEY_SIZE,
+  METRIC_CF_AVG_VALUE_SIZE,
+  METRIC_CF_READ_AMP,
+  METRIC_CF_HIT_RATIO,
+  METRIC_CF_FLUSHING,
+  METRIC_CF_COMPACTING,
+  METRIC_CF_COUNT
+};
+
+static const metrics_family_t k_cf_metrics[METRIC_CF_COUNT] = {
+    {"tidesdb_cf_memtable_size_bytes", "gauge", "Active memtable size"},
+    {"tidesdb_cf_levels", "gauge", "Number of levels"},
+    {"tidesdb_cf_keys", "gauge", "Total keys across levels"},
+    {"tidesdb_cf_data_size_bytes", "gauge", "Total data size"},
+    {"tidesdb_cf_avg_key_size_bytes", "gauge", "Average key size"},
+    {"tidesdb_cf_avg_value_size_bytes", "gauge", "Average value size"},
+    {"tidesdb_cf_read_amplification", "gauge", "Read amplification"},
+    {"tidesdb_cf_cache_hit_ratio", "gauge", "Block cache hit ratio"},
+    {"tidesdb_cf_flushing", "gauge", "1 if a flush is in progress"},
+    {"tidesdb_cf_compacting", "gauge", "1 if a compaction is in progress"},
+};
+
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  strbuf_t text;
+  uint64_t interval_ms;
+  uint64_t refreshes;
+  int stop;
+} metrics_state_t;
+
+static double metrics_cf_value(const metrics_cf_sample_t *s, const int which) {
+  switch (which) {
+  case METRIC_CF_MEMTABLE_SIZE:
+    return (double)s->stats->memtable_size;
+  case METRIC_CF_LEVELS:
+    return (double)s->stats->num_levels;
+  case METRIC_CF_KEYS:
+    return (double)s->stats->total_keys;
+  case METRIC_CF_DATA_SIZE:
+    return (double)s->stats->total_data_size;
+  case METRIC_CF_AVG_KEY_SIZE:
+    return s->stats->avg_key_size;
+  case METRIC_CF_AVG_VALUE_SIZE:
+    return s->stats->avg_value_size;
+  case METRIC_CF_READ_AMP:
+    return s->stats->read_amp;
+  case METRIC_CF_HIT_RATIO:
+    return s->stats->hit_rate;
+  case METRIC_CF_FLUSHING:
+    return (double)s->flushing;
+  case METRIC_CF_COMPACTING:
+    return (double)s->compacting;
+  default:
+    return 0;
+  }
+}
+
+static void metrics_append_label(strbuf_t *sb, const char *value) {
+  for (const char *p = value; *p; p++) {
+    if (*p == '\\' || *p == '"') {
+      strbuf_printf(sb, "\\%c", *p);
+    } else if (*p == '\n') {
+      strbuf_append(sb, "\\n", 2);
+    } else {
+      strbuf_append(sb, p, 1);
+    }
+  }
+}
+
+static void metrics_family_header(strbuf_t *sb, const char *name,
+                                  const char *type, const char *help) {
+  strbuf_printf(sb, "# TYPE %s %s\n# HELP %s %s\n", name, type, name, help);
+}
+
+static void metrics_build_snapshot(strbuf_t *sb, const uint64_t duration_us) {
+  char **cf_names = NULL;
+  int cf_count = 0;
+  if (tidesdb_list_column_families(g_db, &cf_names, &cf_count) !=
+      TDB_SUCCESS) {
+    cf_names = NULL;
+    cf_count = 0;
+  }
+
+  metrics_cf_sample_t *samples =
+      cf_count > 0 ? calloc((size_t)cf_count, sizeof(*samples)) : NULL;
+  int sample_count = 0;
+  for (int i = 0; i < cf_count && samples; i++) {
+    tidesdb_column_family_t *cf = tidesdb_get_column_family(g_db, cf_names[i]);
+    if (cf == NULL)
+      continue;
+    tidesdb_stats_t *stats = NULL;
+    if (tidesdb_get_stats(cf, &stats) != TDB_SUCCESS || stats == NULL)
+      continue;
+    samples[sample_count].name = cf_names[i];
+    samples[sample_count].stats = stats;
+    samples[sample_count].flushing = tidesdb_is_flushing(cf) ? 1 : 0;
+    samples[sample_count].compacting = tidesdb_is_compacting(cf) ? 1 : 0;
+    sample_count++;
+  }
+
+  for (int m = 0; m < METRIC_CF_COUNT; m++) {
+    metrics_family_header(sb, k_cf_metrics[m].name, k_cf_metrics[m].type,
+                          k_cf_metrics[m].help);
+    for (int i = 0; i < sample_count; i++) {
+      strbuf_printf(sb, "%s{cf=\"", k_cf_metrics[m].name);
+      metrics_append_label(sb, samples[i].name);
+      strbuf_printf(sb, "\"} %.15g\n", metrics_cf_value(&samples[i], m));
+    }
   }
 
-  printf("WAL files in '%s':\n", argv[1]);
-  int count = 0;
-  struct dirent *entry;
-  while ((entry = readdir(dir)) != NULL) {
-    if (strstr(entry->d_name, ".log") != NULL) {
-      char full_path[4096];
-      snprintf(full_path, sizeof(full_path), "%s/%s", cf_path, entry->d_name);
+  metrics_family_header(sb, "tidesdb_cf_level_size_bytes", "gauge",
+                        "Bytes stored per level");
+  for (int i = 0; i < sample_count; i++) {
+    for (int l = 0; l < samples[i].stats->num_levels; l++) {
+      strbuf_printf(sb, "tidesdb_cf_level_size_bytes{cf=\"");
+      metrics_append_label(sb, samples[i].name);
+      strbuf_printf(sb, "\",level=\"%d\"} %zu\n", l + 1,
+                    samples[i].stats->level_sizes[l]);
+    }
+  }
 
-      struct stat st;
-      if (stat(full_path, &st) == 0) {
-        printf("  %s (%ld bytes)\n", entry->d_name, (long)st.st_size);
-        count++;
-      }
+  metrics_family_header(sb, "tidesdb_cf_level_sstables", "gauge",
+                        "SSTables per level");
+  for (int i = 0; i < sample_count; i++) {
+    for (int l = 0; l < samples[i].stats->num_levels; l++) {
+      strbuf_printf(sb, "tidesdb_cf_level_sstables{cf=\"");
+      metrics_append_label(sb, samples[i].name);
+      strbuf_printf(sb, "\",level=\"%d\"} %d\n", l + 1,
+                    samples[i].stats->level_num_sstables[l]);
     }
   }
-  closedir(dir);
 
-  if (count == 0) {
-    printf("  (no WAL files found)\n");
-  } else {
-    printf("(%d WAL files)\n", count);
+  metrics_family_header(sb, "tidesdb_cf_level_keys", "gauge", "Keys per level");
+  for (int i = 0; i < sample_count; i++) {
+    if (!samples[i].stats->level_key_counts)
+      continue;
+    for (int l = 0; l < samples[i].stats->num_levels; l++) {
+      strbuf_printf(sb, "tidesdb_cf_level_keys{cf=\"");
+      metrics_append_label(sb, samples[i].name);
+      strbuf_printf(sb, "\",level=\"%d\"} %" PRIu64 "\n", l + 1,
+                    samples[i].stats->level_key_counts[l]);
+    }
   }
 
-  return 0;
+  tidesdb_cache_stats_t cache_stats;
+  if (tidesdb_get_cache_stats(g_db, &cache_stats) == TDB_SUCCESS) {
+    metrics_family_header(sb, "tidesdb_block_cache_enabled", "gauge",
+                          "1 if the block cache is enabled");
+    strbuf_printf(sb, "tidesdb_block_cache_enabled %d\n",
+                  cache_stats.enabled ? 1 : 0);
+    metrics_family_header(sb, "tidesdb_block_cache_entries", "gauge",
+                          "Entries in the block cache");
+    strbuf_printf(sb, "tidesdb_block_cache_entries %zu\n",
+                  cache_stats.total_entries);
+    metrics_family_header(sb, "tidesdb_block_cache_size_bytes", "gauge",
+                          "Bytes held by the block cache");
+    strbuf_printf(sb, "tidesdb_block_cache_size_bytes %zu\n",
+                  cache_stats.total_bytes);
+    metrics_family_header(sb, "tidesdb_block_cache_hits", "counter",
+                          "Block cache hits");
+    strbuf_printf(sb, "tidesdb_block_cache_hits_total %" PRIu64 "\n",
+                  cache_stats.hits);
+    metrics_family_header(sb, "tidesdb_block_cache_misses", "counter",
+                          "Block cache misses");
+    strbuf_printf(sb, "tidesdb_block_cache_misses_total %" PRIu64 "\n",
+                  cache_stats.misses);
+    metrics_family_header(sb, "tidesdb_block_cache_hit_ratio", "gauge",
+                          "Block cache hit ratio");
+    strbuf_printf(sb, "tidesdb_block_cache_hit_ratio %.15g\n",
+                  cache_stats.hit_rate);
+  }
+
+  metrics_family_header(sb, "tidesdb_admintool_snapshot_timestamp_seconds",
+                        "gauge", "Unix time the snapshot was taken");
+  strbuf_printf(sb, "tidesdb_admintool_snapshot_timestamp_seconds %ld\n",
+                (long)time(NULL));
+  metrics_family_header(sb, "tidesdb_admintool_snapshot_duration_seconds",
+                        "gauge", "Time spent collecting the previous snapshot");
+  strbuf_printf(sb, "tidesdb_admintool_snapshot_duration_seconds %.6f\n",
+                (double)duration_us / 1e6);
+
+  for (int i = 0; i < sample_count; i++)
+    tidesdb_free_stats(samples[i].stats);
+  free(samples);
+  for (int i = 0; i < cf_count; i++)
+    free(cf_names[i]);
+  free(cf_names);
 }
 
-static int cmd_wal_info(const int argc, char **argv) {
-  if (argc < 2) {
-    printf("Usage: wal-info <wal_path>\n");
-    return -1;
-  }
+static void metrics_refresh(metrics_state_t *state, uint64_t *last_duration) {
+  const uint64_t start = now_us();
+  strbuf_t fresh = {0};
+  metrics_build_snapshot(&fresh, *last_duration);
+  *last_duration = now_us() - start;
+
+  pthread_mutex_lock(&state->lock);
+  strbuf_t old = state->text;
+  state->text = fresh;
+  state->refreshes++;
+  pthread_mutex_unlock(&state->lock);
+  strbuf_free(&old);
+}
 
-  block_manager_t *bm = NULL;
-  if (block_manager_open(&bm, argv[1], BLOCK_MANAGER_SYNC_NONE) != 0) {
-    printf("Failed to open WAL file: %s\n", argv[1]);
-    return -1;
+static void *metrics_refresh_thread(void *arg) {
+  metrics_state_t *state = arg;
+  uint64_t last_duration = 0;
+
+  pthread_mutex_lock(&state->lock);
+  while (!state->stop) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += (time_t)(state->interval_ms / 1000);
+    deadline.tv_nsec += (long)(state->interval_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000L;
+    }
+    while (!state->stop &&
+           pthread_cond_timedwait(&state->cond, &state->lock, &deadline) !=
+               ETIMEDOUT) {
+    }
+    if (state->stop)
+      break;
+    pthread_mutex_unlock(&state->lock);
+    metrics_refresh(state, &last_duration);
+    pthread_mutex_lock(&state->lock);
   }
+  pthread_mutex_unlock(&state->lock);
+  return NULL;
+}
 
-  uint64_t file_size = 0;
-  block_manager_get_size(bm, &file_size);
-
-  const int block_count = block_manager_count_blocks(bm);
+/* the request target must be exactly want, optionally with a query */
+static int metrics_path_is(const char *path, const char *want) {
+  const size_t n = strlen(want);
+  return strncmp(path, want, n) == 0 && (path[n] == ' ' || path[n] == '?');
+}
 
-  printf("WAL: %s\n", argv[1]);
-  printf("  File Size: %" PRIu64 " bytes\n", file_size);
-  printf("  Block Count (entries): %d\n", block_count);
-  printf("  Last Modified: %ld\n", (long)block_manager_last_modified(bm));
+static void metrics_handle_client(metrics_state_t *state, const int fd) {
+  char request[ADMINTOOL_METRICS_MAX_REQUEST];
+  size_t used = 0;
 
-  block_manager_close(bm);
-  return 0;
+  /* scrapes are served one at a time, so the whole request has to arrive
+   * within the timeout, however slowly a client trickles it in */
+  const uint64_t deadline = now_us() + ADMINTOOL_METRICS_IO_TIMEOUT_MS * 1000;
+  while (used < sizeof(request) - 1) {
+    const uint64_t now = now_us();
+    if (now >= deadline)
+      break;
+    struct pollfd pfd = {.fd = fd, .events = POLLIN};
+    if (poll(&pfd, 1, (int)((deadline - now + 999) / 1000)) <= 0)
+      break;
+    const ssize_t n = read(fd, request + used, sizeof(request) - 1 - used);
+    if (n <= 0)
+      break;
+    used += (size_t)n;
+    request[used] = '\0';
+    if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n"))
+      break;
+  }
+  request[used] = '\0';
+
+  const int is_get = strncmp(request, "GET ", 4) == 0;
+  const char *path = is_get ? request + 4 : "";
+  const int is_metrics =
+      metrics_path_is(path, "/metrics") || metrics_path_is(path, "/");
+
+  if (!is_get || !is_metrics) {
+    static const char not_found[] =
+        "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\n"
+        "Content-Length: 10\r\nConnection: close\r\n\r\nnot found\n";
+    write_all(fd, not_found, sizeof(not_found) - 1);
+    return;
+  }
+
+  const int openmetrics =
+      strstr(request, "application/openmetrics-text") != NULL;
+
+  pthread_mutex_lock(&state->lock);
+  strbuf_t body = {0};
+  strbuf_append(&body, state->text.data ? state->text.data : "",
+                state->text.len);
+  pthread_mutex_unlock(&state->lock);
+  /* the terminator is part of OpenMetrics only; the Prometheus text format
+   * has no such line */
+  if (openmetrics)
+    strbuf_append(&body, "# EOF\n", 6);
+
+  char header[256];
+  const int header_len = snprintf(
+      header, sizeof(header),
+      "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+      "Connection: close\r\n\r\n",
+      openmetrics ? "application/openmetrics-text; version=1.0.0; "
+                    "charset=utf-8"
+                  : "text/plain; version=0.0.4; charset=utf-8",
+      body.len);
+  if (write_all(fd, header, (size_t)header_len) == 0 && body.len > 0)
+    write_all(fd, body.data, body.len);
+  strbuf_free(&body);
 }
 
-static int cmd_wal_dump(const int argc, char **argv) {
-  if (argc < 2) {
-    printf("Usage: wal-dump <wal_path> [limit]\n");
+static int listen_tcp(const char *bind_addr, const int port) {
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+
+  const int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons((uint16_t)port);
+  if (inet_pton(AF_INET, bind_addr, &addr.sin_addr) != 1 ||
+      bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+      listen(fd, 64) != 0) {
+    close(fd);
     return -1;
   }
+  return fd;
+}
 
-  int limit = ADMINTOOL_DEFAULT_DUMP_LIMIT;
-  if (argc >= 3) {
-    char *endptr;
-    const long parsed = strtol(argv[2], &endptr, 10);
-    if (*endptr == '\0' && parsed > 0) {
-      limit = (int)parsed;
-    }
+static int listen_unix(const char *path) {
+  struct sockaddr_un addr;
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    errno = ENAMETOOLONG;
+    return -1;
   }
 
   struct stat st;
-  if (stat(argv[1], &st) == 0 && st.st_size > ADMINTOOL_LARGE_FILE_THRESHOLD) {
-    printf("Warning: Large WAL file (%" PRId64 " MB). ",
-           (int64_t)(st.st_size / (1024 * 1024)));
-    printf("Limiting to %d entries.\n", limit);
-  }
+  if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+    unlink(path);
 
-  block_manager_t *bm = NULL;
-  if (block_manager_open(&bm, argv[1], BLOCK_MANAGER_SYNC_NONE) != 0) {
-    printf("Failed to open WAL file: %s\n", argv[1]);
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+      listen(fd, 64) != 0) {
+    close(fd);
     return -1;
   }
+  return fd;
+}
 
-  block_manager_cursor_t *cursor = NULL;
-  if (block_manager_cursor_init(&cursor, bm) != 0) {
-    printf("Failed to create cursor\n");
-    block_manager_close(bm);
+static int cmd_serve_metrics(const int argc, char **argv) {
+  if (g_db == NULL) {
+    printf("No database is open.\n");
     return -1;
   }
 
-  if (block_manager_cursor_goto_first(cursor) != 0) {
-    printf("(empty WAL)\n");
-    block_manager_cursor_free(cursor);
-    block_manager_close(bm);
-    return 0;
+  int port = 0;
+  const char *bind_addr = "0.0.0.0";
+  const char *socket_path = NULL;
+  uint64_t interval_ms = ADMINTOOL_METRICS_DEFAULT_INTERVAL_MS;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--metrics-port") == 0 && i + 1 < argc) {
+      port = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--bind") == 0 && i + 1 < argc) {
+      bind_addr = argv[++i];
+    } else if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+      socket_path = argv[++i];
+    } else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+      const long parsed = strtol(argv[++i], NULL, 10);
+      if (parsed > 0)
+        interval_ms = (uint64_t)parsed;
+    }
   }
 
-  printf("WAL Entries (limit: %d):\n", limit);
-  int entry_num = 0;
+  if ((port <= 0 || port > 65535) && socket_path == NULL) {
+    printf("Usage: serve-metrics [--metrics-port <port>] [--bind <addr>] "
+           "[--socket <path>] [--interval <ms>]\n");
+    return -1;
+  }
 
-  while (entry_num < limit) {
-    block_manager_block_t *block = block_manager_cursor_read(cursor);
-    if (!block)
-      break;
+  int listen_fds[2];
+  int listen_count = 0;
+  if (port > 0) {
+    const int fd = listen_tcp(bind_addr, port);
+    if (fd < 0) {
+      printf("Failed to listen on %s:%d: %s\n", bind_addr, port,
+             strerror(errno));
+      return -1;
+    }
+    listen_fds[listen_count++] = fd;
+  }
+  if (socket_path != NULL) {
+    const int fd = listen_unix(socket_path);
+    if (fd < 0) {
+      printf("Failed to listen on %s: %s\n", socket_path, strerror(errno));
+      for (int i = 0; i < listen_count; i++)
+        close(listen_fds[i]);
+      return -1;
+    }
+    listen_fds[listen_count++] = fd;
+  }
+
+  metrics_state_t state;
+  memset(&state, 0, sizeof(state));
+  pthread_mutex_init(&state.lock, NULL);
+  pthread_cond_init(&state.cond, NULL);
+  state.interval_ms = interval_ms;
+
+  uint64_t first_duration = 0;
+  metrics_refresh(&state, &first_duration);
+
+  pthread_t refresher;
+  if (pthread_create(&refresher, NULL, metrics_refresh_thread, &state) != 0) {
+    printf("Failed to start metrics refresh thread\n");
+    for (int i = 0; i < listen_count; i++)
+      close(listen_fds[i]);
+    strbuf_free(&state.text);
+    pthread_cond_destroy(&state.cond);
+    pthread_mutex_destroy(&state.lock);
+    return -1;
+  }
 
-    if (block->size < 1) {
-      block_manager_block_release(block);
-      if (block_manager_cursor_next(cursor) != 0)
-        break;
+  void (*prev_int)(int) = signal(SIGINT, handle_interrupt);
+  void (*prev_pipe)(int) = signal(SIGPIPE, SIG_IGN);
+  g_interrupted = 0;
+
+  printf("Serving metrics (refresh every %" PRIu64 " ms)", interval_ms);
+  if (port > 0)
+    printf(" on http://%s:%d/metrics", bind_addr, port);
+  if (socket_path != NULL)
+    printf("%s unix:%s", port > 0 ? " and" : " on", socket_path);
+  printf("\nPress Ctrl-C to stop.\n");
+  fflush(stdout);
+
+  uint64_t scrapes = 0;
+  while (!g_interrupted) {
+    struct pollfd pfds[2];
+    for (int i = 0; i < listen_count; i++) {
+      pfds[i].fd = listen_fds[i];
+      pfds[i].events = POLLIN;
+      pfds[i].revents = 0;
+    }
+    const int ready = poll(pfds, (nfds_t)listen_count, 250);
+    if (ready <= 0)
       continue;
+
+    for (int i = 0; i < listen_count; i++) {
+      if (!(pfds[i].revents & POLLIN))
+        continue;
+      const int client = accept(listen_fds[i], NULL, NULL);
+      if (client < 0)
+        continue;
+      /* a scraper that stops reading the response must not stall the
+       * ones queued behind it */
+      const struct timeval timeout = {
+          .tv_sec = ADMINTOOL_METRICS_IO_TIMEOUT_MS / 1000,
+          .tv_usec = (ADMINTOOL_METRICS_IO_TIMEOUT_MS % 1000) * 1000};
+      setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+      setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+      metrics_handle_client(&state, client);
+      close(client);
+      scrapes++;
     }
+  }
 
-    const uint8_t *ptr = (const uint8_t *)block->data;
-    size_t remaining = block->size;
+  pthread_mutex_lock(&state.lock);
+  state.stop = 1;
+  pthread_cond_signal(&state.cond);
+  pthread_mutex_unlock(&state.lock);
+  pthread_join(refresher, NULL);
 
-    if (remaining < 1) {
-      block_manager_block_release(block);
-      if (block_manager_cursor_next(cursor) != 0)
-        break;
-      continue;
-    }
+  for (int i = 0; i < listen_count; i++)
+    close(listen_fds[i]);
+  if (socket_path != NULL)
+    unlink(socket_path);
 
-    const uint8_t flags = *ptr++;
-    remaining--;
+  signal(SIGINT, prev_int);
+  signal(SIGPIPE, prev_pipe);
+  g_interrupted = 0;
 
-    uint64_t key_size, value_size, seq;
+  printf("\nMetrics server stopped (%" PRIu64 " scrapes, %" PRIu64
+         " snapshots).\n",
+         scrapes, state.refreshes);
 
-    int bytes_read = decode_varint_safe(ptr, &key_size, remaining);
-    if (bytes_read < 0 || (size_t)bytes_read > remaining) {
-      block_manager_block_release(block);
-      if (block_manager_cursor_next(cursor) != 0)
-        break;
-      continue;
-    }
-    ptr += bytes_read;
-    remaining -= bytes_read;
+  strbuf_free(&state.text);
+  pthread_cond_destroy(&state.cond);
+  pthread_mutex_destroy(&state.lock);
+  return 0;
+}
+#else
+static int cmd_serve_metrics(const int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  printf("serve-metrics is not supported on this platform.\n");
+  return -1;
+}
+#endif
 
-    bytes_read = decode_varint_safe(ptr, &value_size, remaining);
-    if (bytes_read < 0 || (size_t)bytes_read > remaining) {
-      block_manager_block_release(block);
-      if (block_manager_cursor_next(cursor) != 0)
-        break;
-      continue;
-    }
-    ptr += bytes_read;
-    remaining -= bytes_read;
+#ifndef _WIN32
+static int dispatch_command(const int argc, char **argv);
+
+typedef struct {
+  int fd;
+  int busy;
+  int closed;
+  strbuf_t in;
+  strbuf_t out;
+} serve_client_t;
+
+typedef struct {
+  tidesdb_column_family_t *cf;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  serve_client_t **queue;
+  int queue_head;
+  int queue_count;
+  int wake[2];
+  int stop;
+  pthread_mutex_t admin_lock;
+  uint64_t commands;
+  uint64_t errors;
+} serve_state_t;
+
+typedef struct {
+  const char **argv;
+  size_t *lens;
+  int argc;
+  int cap;
+} serve_args_t;
+
+static int serve_args_push(serve_args_t *a, const char *p, const size_t len) {
+  if (a->argc == a->cap) {
+    const int cap = a->cap ? a->cap * 2 : 16;
+    const char **argv = realloc(a->argv, sizeof(*argv) * (size_t)cap);
+    if (argv == NULL)
+      return -1;
+    a->argv = argv;
+    size_t *lens = realloc(a->lens, sizeof(*lens) * (size_t)cap);
+    if (lens == NULL)
+      return -1;
+    a->lens = lens;
+    a->cap = cap;
+  }
+  a->argv[a->argc] = p;
+  a->lens[a->argc] = len;
+  a->argc++;
+  return 0;
+}
 
-    bytes_read = decode_varint_safe(ptr, &seq, remaining);
-    if (bytes_read < 0 || (size_t)bytes_read > remaining) {
-      block_manager_block_release(block);
-      if (block_manager_cursor_next(cursor) != 0)
-        break;
-      continue;
-    }
-    ptr += bytes_read;
-    remaining -= bytes_read;
+/* parses a decimal RESP header line ("*3\r\n", "$5\r\n") starting at pos;
+ * returns 1 with *next past the CRLF, 0 if incomplete, -1 if malformed */
+static int resp_parse_header(const char *buf, const size_t len, size_t pos,
+                             long long *value, size_t *next) {
+  const char *nl = memchr(buf + pos, '\n', len - pos);
+  if (nl == NULL)
+    return len - pos > 32 ? -1 : 0;
+  char *end;
+  *value = strtoll(buf + pos + 1, &end, 10);
+  if (end == buf + pos + 1 || (*end != '\r' && *end != '\n'))
+    return -1;
+  *next = (size_t)(nl - buf) + 1;
+  return 1;
+}
 
-    int64_t ttl = 0;
-    if (flags & TDB_KV_FLAG_HAS_TTL) {
-      if (remaining >= sizeof(int64_t)) {
-        memcpy(&ttl, ptr, sizeof(int64_t));
-        ptr += sizeof(int64_t);
-        remaining -= sizeof(int64_t);
-      }
-    }
+/* parses one command from buf, either a RESP array of bulk strings or an
+ * inline space-separated line; argument pointers refer into buf */
+static int resp_parse_command(const char *buf, const size_t len,
+                              size_t *consumed, serve_args_t *args) {
+  args->argc = 0;
+  if (len == 0)
+    return 0;
 
-    if (remaining < key_size) {
-      block_manager_block_release(block);
-      if (block_manager_cursor_next(cursor) != 0)
-        break;
-      continue;
+  if (buf[0] != '*') {
+    const char *nl = memchr(buf, '\n', len);
+    if (nl == NULL)
+      return len > ADMINTOOL_SERVE_MAX_INLINE ? -1 : 0;
+    size_t end = (size_t)(nl - buf);
+    if (end > 0 && buf[end - 1] == '\r')
+      end--;
+    size_t i = 0;
+    while (i < end) {
+      while (i < end && buf[i] == ' ')
+        i++;
+      const size_t start = i;
+      while (i < end && buf[i] != ' ')
+        i++;
+      if (i > start && serve_args_push(args, buf + start, i - start) != 0)
+        return -1;
     }
-    const uint8_t *key = ptr;
-    ptr += key_size;
-    remaining -= key_size;
+    *consumed = (size_t)(nl - buf) + 1;
+    return 1;
+  }
 
-    const uint8_t *value = NULL;
-    if (value_size > 0 && remaining >= value_size) {
-      value = ptr;
-    }
+  long long count;
+  size_t pos;
+  int rc = resp_parse_header(buf, len, 0, &count, &pos);
+  if (rc <= 0)
+    return rc;
+  if (count > ADMINTOOL_SERVE_MAX_ARGS)
+    return -1;
+  for (long long i = 0; i < count; i++) {
+    if (pos >= len)
+      return 0;
+    if (buf[pos] != '$')
+      return -1;
+    long long size;
+    rc = resp_parse_header(buf, len, pos, &size, &pos);
+    if (rc <= 0)
+      return rc;
+    if (size < 0 || size > ADMINTOOL_SERVE_MAX_BULK)
+      return -1;
+    if (len - pos < (size_t)size + 2)
+      return 0;
+    if (serve_args_push(args, buf + pos, (size_t)size) != 0)
+      return -1;
+    pos += (size_t)size + 2;
+  }
+  *consumed = pos;
+  return 1;
+}
 
-    entry_num++;
-    printf("%d) ", entry_num);
+static void resp_simple(strbuf_t *out, const char *s) {
+  strbuf_printf(out, "+%s\r\n", s);
+}
 
-    if (flags & TDB_KV_FLAG_TOMBSTONE)
-      printf("[DELETE] ");
-    else
-      printf("[PUT] ");
+static void resp_error(strbuf_t *out, const char *s) {
+  strbuf_printf(out, "-ERR %s\r\n", s);
+}
 
-    if (flags & TDB_KV_FLAG_HAS_TTL)
-      printf("[TTL:%" PRId64 "] ", ttl);
+static void resp_int(strbuf_t *out, const long long v) {
+  strbuf_printf(out, ":%lld\r\n", v);
+}
 
-    printf("seq=%" PRIu64 " key=\"%.*s\"", seq, (int)key_size, (char *)key);
+static void resp_bulk(strbuf_t *out, const void *data, const size_t size) {
+  strbuf_printf(out, "$%zu\r\n", size);
+  strbuf_append(out, data, size);
+  strbuf_append(out, "\r\n", 2);
+}
 
-    if (value && value_size > 0) {
-      if (value_size <= 64) {
-        printf(" value=\"%.*s\"", (int)value_size, (char *)value);
-      } else {
-        printf(" value=(%zu bytes)", (size_t)value_size);
-      }
-    }
-    printf("\n");
+static void resp_null(strbuf_t *out) { strbuf_append(out, "$-1\r\n", 5); }
 
-    block_manager_block_release(block);
-    if (block_manager_cursor_next(cursor) != 0)
-      break;
-  }
+static void resp_array(strbuf_t *out, const size_t n) {
+  strbuf_printf(out, "*%zu\r\n", n);
+}
 
-  printf("\n(%d WAL entries dumped)\n", entry_num);
+static int resp_is(const serve_args_t *a, const int i, const char *name) {
+  const size_t n = strlen(name);
+  return a->lens[i] == n && strncasecmp(a->argv[i], name, n) == 0;
+}
 
-  block_manager_cursor_free(cursor);
-  block_manager_close(bm);
-  return 0;
+static void serve_cmd_get(serve_state_t *s, const serve_args_t *a,
+                          strbuf_t *out, const int multi) {
+  tidesdb_txn_t *txn = NULL;
+  const int ret = tidesdb_txn_begin(g_db, &txn);
+  if (ret != TDB_SUCCESS) {
+    resp_error(out, error_to_string(ret));
+    return;
+  }
+  if (multi)
+    resp_array(out, (size_t)(a->argc - 1));
+  for (int i = 1; i < a->argc; i++) {
+    uint8_t *value = NULL;
+    size_t value_size = 0;
+    const int rc =
+        tidesdb_txn_get(txn, s->cf, (const uint8_t *)a->argv[i], a->lens[i],
+                        &value, &value_size);
+    if (rc == TDB_SUCCESS) {
+      resp_bulk(out, value, value_size);
+      free(value);
+    } else if (rc == TDB_ERR_NOT_FOUND || multi) {
+      resp_null(out);
+    } else {
+      resp_error(out, error_to_string(rc));
+    }
+  }
+  tidesdb_txn_rollback(txn);
+  tidesdb_txn_free(txn);
 }
 
-static int cmd_wal_verify(const int argc, char **argv) {
-  if (argc < 2) {
-    printf("Usage: wal-verify <wal_path>\n");
-    return -1;
+static void serve_cmd_set(serve_state_t *s, const serve_args_t *a,
+                          strbuf_t *out) {
+  time_t ttl = 0;
+  for (int i = 3; i < a->argc; i++) {
+    if (i + 1 < a->argc && (resp_is(a, i, "EX") || resp_is(a, i, "PX"))) {
+      const long long n = strtoll(a->argv[i + 1], NULL, 10);
+      if (n <= 0) {
+        resp_error(out, "invalid expire time");
+        return;
+      }
+      ttl = time(NULL) + (time_t)(resp_is(a, i, "EX") ? n : (n + 999) / 1000);
+      i++;
+    } else {
+      resp_error(out, "syntax error");
+      return;
+    }
   }
 
-  block_manager_t *bm = NULL;
-  if (block_manager_open(&bm, argv[1], BLOCK_MANAGER_SYNC_NONE) != 0) {
-    printf("Failed to open WAL file: %s\n", argv[1]);
-    return -1;
+  tidesdb_txn_t *txn = NULL;
+  int ret = tidesdb_txn_begin(g_db, &txn);
+  if (ret == TDB_SUCCESS) {
+    ret = tidesdb_txn_put(txn, s->cf, (const uint8_t *)a->argv[1], a->lens[1],
+                          (const uint8_t *)a->argv[2], a->lens[2], ttl);
+    if (ret == TDB_SUCCESS)
+      ret = tidesdb_txn_commit(txn);
+    else
+      tidesdb_txn_rollback(txn);
+    tidesdb_txn_free(txn);
   }
+  if (ret == TDB_SUCCESS)
+    resp_simple(out, "OK");
+  else
+    resp_error(out, error_to_string(ret));
+}
 
-  uint64_t file_size = 0;
-  block_manager_get_size(bm, &file_size);
+static void serve_cmd_del(serve_state_t *s, const serve_args_t *a,
+                          strbuf_t *out) {
+  tidesdb_txn_t *txn = NULL;
+  int ret = tidesdb_txn_begin(g_db, &txn);
+  if (ret != TDB_SUCCESS) {
+    resp_error(out, error_to_string(ret));
+    return;
+  }
+  long long removed = 0;
+  for (int i = 1; i < a->argc && ret == TDB_SUCCESS; i++) {
+    uint8_t *value = NULL;
+    size_t value_size = 0;
+    const uint8_t *key = (const uint8_t *)a->argv[i];
+    if (tidesdb_txn_get(txn, s->cf, key, a->lens[i], &value, &value_size) !=
+        TDB_SUCCESS)
+      continue;
+    free(value);
+    ret = tidesdb_txn_delete(txn, s->cf, key, a->lens[i]);
+    removed++;
+  }
+  if (ret == TDB_SUCCESS)
+    ret = tidesdb_txn_commit(txn);
+  else
+    tidesdb_txn_rollback(txn);
+  tidesdb_txn_free(txn);
+  if (ret == TDB_SUCCESS)
+    resp_int(out, removed);
+  else
+    resp_error(out, error_to_string(ret));
+}
 
-  printf("Verifying WAL: %s\n", argv[1]);
-  printf("  File Size: %" PRIu64 " bytes\n", file_size);
+/* SCAN cursors are the hex encoding of the last key returned, so a scan
+ * resumes correctly across writes without any server-side state */
+static void serve_cmd_scan(serve_state_t *s, const serve_args_t *a,
+                           strbuf_t *out) {
+  long long count = 10;
+  strbuf_t pattern = {0};
+  for (int i = 2; i + 1 < a->argc; i += 2) {
+    if (resp_is(a, i, "COUNT")) {
+      count = strtoll(a->argv[i + 1], NULL, 10);
+      if (count < 1)
+        count = 1;
+    } else if (resp_is(a, i, "MATCH")) {
+      pattern.len = 0;
+      strbuf_append(&pattern, a->argv[i + 1], a->lens[i + 1]);
+    }
+  }
 
-  block_manager_cursor_t *cursor = NULL;
-  if (block_manager_cursor_init(&cursor, bm) != 0) {
-    printf("  Status: FAILED (cannot create cursor)\n");
-    block_manager_close(bm);
-    return -1;
+  arg_bytes_t cursor = {0};
+  const int from_start = a->lens[1] == 1 && a->argv[1][0] == '0';
+  if (!from_start) {
+    strbuf_t hex = {0};
+    strbuf_append(&hex, "hex:", 4);
+    strbuf_append(&hex, a->argv[1], a->lens[1]);
+    const int bad = arg_bytes_decode(hex.data, &cursor);
+    strbuf_free(&hex);
+    if (bad) {
+      resp_error(out, "invalid cursor");
+      strbuf_free(&pattern);
+      return;
+    }
   }
 
-  if (block_manager_cursor_goto_first(cursor) != 0) {
-    printf("  Status: OK (empty WAL)\n");
-    block_manager_cursor_free(cursor);
-    block_manager_close(bm);
-    return 0;
+  tidesdb_txn_t *txn = NULL;
+  tidesdb_iter_t *iter = NULL;
+  int ret = tidesdb_txn_begin(g_db, &txn);
+  if (ret == TDB_SUCCESS)
+    ret = tidesdb_iter_new(txn, s->cf, &iter);
+  if (ret != TDB_SUCCESS) {
+    resp_error(out, error_to_string(ret));
+    if (txn != NULL)
+      tidesdb_txn_free(txn);
+    arg_bytes_free(&cursor);
+    strbuf_free(&pattern);
+    return;
+  }
+  const int positioned =
+      from_start ? tidesdb_iter_seek_to_first(iter)
+                 : tidesdb_iter_seek(iter, cursor.data, cursor.size);
+
+  strbuf_t keys = {0};
+  strbuf_t last = {0};
+  strbuf_t key_copy = {0};
+  long long found = 0;
+  long long visited = 0;
+  int more = 0;
+  while (positioned == TDB_SUCCESS && tidesdb_iter_valid(iter)) {
+    uint8_t *key = NULL;
+    size_t key_size = 0;
+    if (tidesdb_iter_key(iter, &key, &key_size) == TDB_SUCCESS) {
+      const int is_cursor = !from_start && key_size == cursor.size &&
+                            memcmp(key, cursor.data, key_size) == 0;
+      if (!is_cursor) {
+        if (visited == count) {
+          more = 1;
+          break;
+        }
+        visited++;
+        last.len = 0;
+        strbuf_append(&last, (const char *)key, key_size);
+        key_copy.len = 0;
+        strbuf_append(&key_copy, (const char *)key, key_size);
+        if (pattern.len == 0 || fnmatch(pattern.data, key_copy.data, 0) == 0) {
+          resp_bulk(&keys, key, key_size);
+          found++;
+        }
+      }
+    }
+    if (tidesdb_iter_next(iter) != TDB_SUCCESS)
+      break;
+  }
+  tidesdb_iter_free(iter);
+  tidesdb_txn_rollback(txn);
+  tidesdb_txn_free(txn);
+
+  resp_array(out, 2);
+  if (more && last.len > 0) {
+    strbuf_t next = {0};
+    for (size_t i = 0; i < last.len; i++)
+      strbuf_printf(&next, "%02x", (uint8_t)last.data[i]);
+    resp_bulk(out, next.data, next.len);
+    strbuf_free(&next);
+  } else {
+    resp_bulk(out, "0", 1);
   }
+  resp_array(out, (size_t)found);
+  strbuf_append(out, keys.data ? keys.data : "", keys.len);
 
-  int valid_entries = 0;
-  int corrupted_entries = 0;
-  uint64_t min_seq = UINT64_MAX;
-  uint64_t max_seq = 0;
-  uint64_t last_valid_pos = 0;
+  strbuf_free(&keys);
+  strbuf_free(&last);
+  strbuf_free(&key_copy);
+  strbuf_free(&pattern);
+  arg_bytes_free(&cursor);
+}
 
-  while (1) {
-    const uint64_t current_pos = cursor->current_pos;
-    block_manager_block_t *block = block_manager_cursor_read(cursor);
-    if (!block) {
-      corrupted_entries++;
+/* any other command is run through the regular admintool dispatcher; its
+ * output is captured into a buffer for the reply, and admin_lock serialises
+ * commands that were never written to run concurrently */
+static void serve_cmd_admin(serve_state_t *s, const serve_args_t *a,
+                            strbuf_t *out) {
+  /* the cf commands would free or rename column families that the RESP
+   * commands on other workers hold without admin_lock */
+  static const char *const refused[] = {
+      "open",     "close",     "quit",    "exit",      "serve", "trace",
+      "serve-metrics", "wal-tail", "cf-create", "cf-drop", "cf-rename",
+      NULL};
+  char **argv = calloc((size_t)a->argc + 1, sizeof(char *));
+  if (argv == NULL) {
+    resp_error(out, "out of memory");
+    return;
+  }
+  int ok = 1;
+  for (int i = 0; i < a->argc && ok; i++) {
+    argv[i] = malloc(a->lens[i] + 1);
+    if (argv[i] == NULL) {
+      ok = 0;
       break;
     }
-
-    if (block->size < 1) {
-      block_manager_block_release(block);
-      if (block_manager_cursor_next(cursor) != 0)
+    memcpy(argv[i], a->argv[i], a->lens[i]);
+    argv[i][a->lens[i]] = '\0';
+  }
+  if (ok) {
+    for (char *p = argv[0]; *p; p++)
+      *p = (char)tolower((unsigned char)*p);
+    for (int i = 0; refused[i] != NULL; i++) {
+      if (strcmp(argv[0], refused[i]) == 0) {
+        resp_error(out, "command not allowed while serving");
+        ok = -1;
         break;
-      continue;
+      }
     }
-
-    const uint8_t *ptr = (const uint8_t *)block->data;
-    size_t remaining = block->size;
-
-    int entry_valid = 1;
-
-    if (remaining < 1) {
-      entry_valid = 0;
-    } else {
-      const uint8_t flags = *ptr++;
-      remaining--;
-
-      uint64_t key_size, value_size, seq;
-
-      int bytes_read = decode_varint_safe(ptr, &key_size, remaining);
-      if (bytes_read < 0 || (size_t)bytes_read > remaining) {
-        entry_valid = 0;
-      } else {
-        ptr += bytes_read;
-        remaining -= bytes_read;
-
-        bytes_read = decode_varint_safe(ptr, &value_size, remaining);
-        if (bytes_read < 0 || (size_t)bytes_read > remaining) {
-          entry_valid = 0;
-        } else {
-          ptr += bytes_read;
-          remaining -= bytes_read;
-
-          bytes_read = decode_varint_safe(ptr, &seq, remaining);
-          if (bytes_read < 0 || (size_t)bytes_read > remaining) {
-            entry_valid = 0;
-          } else {
-            ptr += bytes_read;
-            remaining -= bytes_read;
-
-            if (flags & TDB_KV_FLAG_HAS_TTL) {
-              if (remaining < sizeof(int64_t)) {
-                entry_valid = 0;
-              } else {
-                ptr += sizeof(int64_t);
-                remaining -= sizeof(int64_t);
-              }
-            }
-
-            if (entry_valid && remaining < key_size) {
-              entry_valid = 0;
-            } else if (entry_valid) {
-              ptr += key_size;
-              remaining -= key_size;
-
-              if (value_size > 0 && remaining < value_size) {
-                entry_valid = 0;
-              }
-            }
-
-            if (entry_valid) {
-              if (seq < min_seq)
-                min_seq = seq;
-              if (seq > max_seq)
-                max_seq = seq;
-            }
-          }
-        }
+    /* --wait installs its own SIGINT handler and would swallow the
+     * server's Ctrl-C */
+    for (int i = 1; i < a->argc && ok == 1; i++) {
+      if (strcmp(argv[i], "--wait") == 0) {
+        resp_error(out, "--wait is not allowed while serving");
+        ok = -1;
       }
     }
+  }
 
-    if (entry_valid) {
-      valid_entries++;
-      last_valid_pos = current_pos;
+  if (ok == 1) {
+    char *text = NULL;
+    size_t text_len = 0;
+    FILE *capture = open_memstream(&text, &text_len);
+    if (capture == NULL) {
+      resp_error(out, "failed to capture command output");
     } else {
-      corrupted_entries++;
+      pthread_mutex_lock(&s->admin_lock);
+      g_cmd_out = capture;
+      const int ret = dispatch_command(a->argc, argv);
+      g_cmd_out = NULL;
+      pthread_mutex_unlock(&s->admin_lock);
+      const int failed = fclose(capture) != 0;
+
+      if (failed || text == NULL) {
+        resp_error(out, "failed to capture command output");
+      } else if (ret == 0 || ret == 1) {
+        resp_bulk(out, text, text_len);
+      } else {
+        /* a RESP error is a single line */
+        for (size_t i = 0; i < text_len; i++)
+          if (text[i] == '\r' || text[i] == '\n')
+            text[i] = ' ';
+        strbuf_printf(out, "-ERR %s\r\n",
+                      text_len ? trim_whitespace(text) : "failed");
+      }
+      free(text);
     }
-
-    block_manager_block_release(block);
-    if (block_manager_cursor_next(cursor) != 0)
-      break;
+  } else if (ok == 0) {
+    resp_error(out, "out of memory");
   }
 
-  printf("  Valid Entries: %d\n", valid_entries);
-  printf("  Corrupted Entries: %d\n", corrupted_entries);
-  if (valid_entries > 0) {
-    printf("  Sequence Range: %" PRIu64 " - %" PRIu64 "\n",
-           min_seq == UINT64_MAX ? 0 : min_seq, max_seq);
-    printf("  Last Valid Position: %" PRIu64 "\n", last_valid_pos);
-  }
+  for (int i = 0; i < a->argc; i++)
+    free(argv[i]);
+  free(argv);
+}
 
-  if (corrupted_entries == 0) {
-    printf("  Status: OK\n");
+/* returns 1 when the client asked to disconnect */
+static int serve_execute(serve_state_t *s, const serve_args_t *a,
+                         strbuf_t *out) {
+  if (a->argc == 0)
+    return 0;
+  const size_t before = out->len;
+  int quit = 0;
+
+  if (resp_is(a, 0, "PING")) {
+    if (a->argc > 1)
+      resp_bulk(out, a->argv[1], a->lens[1]);
+    else
+      resp_simple(out, "PONG");
+  } else if (resp_is(a, 0, "GET")) {
+    if (a->argc != 2)
+      resp_error(out, "wrong number of arguments for 'get' command");
+    else
+      serve_cmd_get(s, a, out, 0);
+  } else if (resp_is(a, 0, "MGET")) {
+    if (a->argc < 2)
+      resp_error(out, "wrong number of arguments for 'mget' command");
+    else
+      serve_cmd_get(s, a, out, 1);
+  } else if (g_db_shadow &&
+             (resp_is(a, 0, "SET") || resp_is(a, 0, "DEL"))) {
+    resp_error(out, "database is open as a shadow copy");
+  } else if (resp_is(a, 0, "SET")) {
+    if (a->argc < 3)
+      resp_error(out, "wrong number of arguments for 'set' command");
+    else
+      serve_cmd_set(s, a, out);
+  } else if (resp_is(a, 0, "DEL")) {
+    if (a->argc < 2)
+      resp_error(out, "wrong number of arguments for 'del' command");
+    else
+      serve_cmd_del(s, a, out);
+  } else if (resp_is(a, 0, "SCAN")) {
+    if (a->argc < 2)
+      resp_error(out, "wrong number of arguments for 'scan' command");
+    else
+      serve_cmd_scan(s, a, out);
+  } else if (resp_is(a, 0, "COMMAND")) {
+    resp_array(out, 0);
+  } else if (resp_is(a, 0, "CONFIG")) {
+    if (a->argc >= 2 && resp_is(a, 1, "GET"))
+      resp_array(out, 0);
+    else
+      resp_error(out, "CONFIG only supports GET");
+  } else if (resp_is(a, 0, "QUIT")) {
+    resp_simple(out, "OK");
+    quit = 1;
   } else {
-    printf("  Status: CORRUPTED (recovery possible up to position %" PRIu64
-           ")\n",
-           last_valid_pos);
+    serve_cmd_admin(s, a, out);
   }
 
-  block_manager_cursor_free(cursor);
-  block_manager_close(bm);
-  return corrupted_entries > 0 ? -1 : 0;
+  pthread_mutex_lock(&s->lock);
+  s->commands++;
+  if (out->len > before && out->data[before] == '-')
+    s->errors++;
+  pthread_mutex_unlock(&s->lock);
+  return quit;
 }
 
-static int cmd_level_info(const int argc, char **argv) {
-  if (argc < 2) {
-    printf("Usage: level-info <cf>\n");
-    return -1;
+/* handles one readable event: reads what is available, runs every complete
+ * command in it, and writes all the replies back in one go (pipelining) */
+static void serve_client_process(serve_state_t *s, serve_client_t *c,
+                                 serve_args_t *args) {
+  if (strbuf_reserve(&c->in, ADMINTOOL_SERVE_READ_CHUNK) != 0) {
+    c->closed = 1;
+    return;
+  }
+  const ssize_t n = read(c->fd, c->in.data + c->in.len,
+                         c->in.cap - c->in.len - 1);
+  if (n <= 0) {
+    if (n == 0 || (errno != EINTR && errno != EAGAIN))
+      c->closed = 1;
+    return;
+  }
+  c->in.len += (size_t)n;
+
+  size_t pos = 0;
+  int quit = 0;
+  while (pos < c->in.len && !quit) {
+    size_t consumed = 0;
+    const int rc =
+        resp_parse_command(c->in.data + pos, c->in.len - pos, &consumed, args);
+    if (rc == 0)
+      break;
+    if (rc < 0) {
+      resp_error(&c->out, "Protocol error");
+      quit = 1;
+      break;
+    }
+    quit = serve_execute(s, args, &c->out);
+    pos += consumed;
   }
 
-  if (g_db == NULL) {
-    printf("No database is open.\n");
-    return -1;
+  if (pos > 0) {
+    memmove(c->in.data, c->in.data + pos, c->in.len - pos);
+    c->in.len -= pos;
   }
-
-  tidesdb_column_family_t *cf = tidesdb_get_column_family(g_db, argv[1]);
-  if (cf == NULL) {
-    printf("Column family '%s' not found.\n", argv[1]);
-    return -1;
+  if (c->out.len > 0) {
+    if (write_all(c->fd, c->out.data, c->out.len) != 0)
+      quit = 1;
+    c->out.len = 0;
   }
+  if (quit)
+    c->closed = 1;
+}
 
-  tidesdb_stats_t *stats = NULL;
-  const int ret = tidesdb_get_stats(cf, &stats);
-  if (ret != TDB_SUCCESS) {
-    printf("Failed to get stats: %s\n", error_to_string(ret));
-    return ret;
+static void *serve_worker(void *arg) {
+  serve_state_t *s = arg;
+  serve_args_t args = {0};
+  for (;;) {
+    pthread_mutex_lock(&s->lock);
+    while (!s->stop && s->queue_count == 0)
+      pthread_cond_wait(&s->cond, &s->lock);
+    if (s->stop) {
+      pthread_mutex_unlock(&s->lock);
+      break;
+    }
+    serve_client_t *c = s->queue[s->queue_head];
+    s->queue_head = (s->queue_head + 1) % ADMINTOOL_SERVE_MAX_CLIENTS;
+    s->queue_count--;
+    pthread_mutex_unlock(&s->lock);
+
+    serve_client_process(s, c, &args);
+
+    pthread_mutex_lock(&s->lock);
+    c->busy = 0;
+    pthread_mutex_unlock(&s->lock);
+    const char token = 1;
+    if (write(s->wake[1], &token, 1) < 0) {
+      /* the poll timeout picks the client up again */
+    }
   }
+  free(args.argv);
+  free(args.lens);
+  return NULL;
+}
 
-  printf("Level Information for '%s':\n", argv[1]);
-  printf("  Memtable Size: %zu bytes (%.2f MB)\n", stats->memtable_size,
-         (double)stats->memtable_size / (1024 * 1024));
-  printf("  Number of Levels: %d\n\n", stats->num_levels);
-
-  uint64_t total_size = 0;
-  int total_sstables = 0;
-
-  for (int i = 0; i < stats->num_levels; i++) {
-    printf("  Level %d:\n", i + 1);
-    printf("    SSTables: %d\n", stats->level_num_sstables[i]);
-    printf("    Size: %zu bytes (%.2f MB)\n", stats->level_sizes[i],
-           (double)stats->level_sizes[i] / (1024 * 1024));
+static void serve_client_free(serve_client_t *c) {
+  close(c->fd);
+  strbuf_free(&c->in);
+  strbuf_free(&c->out);
+  free(c);
+}
 
-    total_size += stats->level_sizes[i];
-    total_sstables += stats->level_num_sstables[i];
+static int cmd_serve(const int argc, char **argv) {
+  const char *socket_path = NULL;
+  const char *cf_name = NULL;
+  int threads = default_thread_count();
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc)
+      socket_path = argv[++i];
+    else if (strcmp(argv[i], "--cf") == 0 && i + 1 < argc)
+      cf_name = argv[++i];
+    else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+      threads = parse_thread_count(argv[++i]);
   }
 
-  printf("\n  Total SSTables: %d\n", total_sstables);
-  printf("  Total Disk Size: %" PRIu64 " bytes (%.2f MB)\n", total_size,
-         (double)total_size / (1024 * 1024));
-
-  tidesdb_free_stats(stats);
-  return 0;
-}
-
-static int cmd_verify(const int argc, char **argv) {
-  if (argc < 2) {
-    printf("Usage: verify <cf>\n");
+  if (socket_path == NULL || cf_name == NULL) {
+    printf("Usage: serve --socket <path> --cf <cf> [--threads N]\n");
+    printf("Serves GET/SET/DEL/MGET/SCAN and admin commands over RESP.\n");
     return -1;
   }
 
@@ -2509,147 +10215,223 @@ static int cmd_verify(const int argc, char **argv) {
     return -1;
   }
 
-  const tidesdb_column_family_t *cf = tidesdb_get_column_family(g_db, argv[1]);
-  if (cf == NULL) {
-    printf("Column family '%s' not found.\n", argv[1]);
+  serve_state_t state;
+  memset(&state, 0, sizeof(state));
+  state.cf = tidesdb_get_column_family(g_db, cf_name);
+  if (state.cf == NULL) {
+    printf("Column family '%s' not found.\n", cf_name);
     return -1;
   }
 
-  printf("Verifying column family '%s'...\n", argv[1]);
-
-  char cf_path[2048];
-  snprintf(cf_path, sizeof(cf_path), "%s/%s", g_db_path, argv[1]);
-
-  DIR *dir = opendir(cf_path);
-  if (dir == NULL) {
-    printf("  Status: FAILED (cannot open directory)\n");
+  const int listen_fd = listen_unix(socket_path);
+  if (listen_fd < 0) {
+    printf("Failed to listen on %s: %s\n", socket_path, strerror(errno));
+    return -1;
+  }
+  state.queue = calloc(ADMINTOOL_SERVE_MAX_CLIENTS, sizeof(*state.queue));
+  serve_client_t **clients =
+      calloc(ADMINTOOL_SERVE_MAX_CLIENTS, sizeof(*clients));
+  struct pollfd *pfds =
+      calloc(ADMINTOOL_SERVE_MAX_CLIENTS + 2, sizeof(*pfds));
+  serve_client_t **polled =
+      calloc(ADMINTOOL_SERVE_MAX_CLIENTS, sizeof(*polled));
+  pthread_t *workers = calloc((size_t)threads, sizeof(*workers));
+  if (state.queue == NULL || clients == NULL || pfds == NULL ||
+      polled == NULL || workers == NULL || pipe(state.wake) != 0) {
+    printf("Failed to set up server\n");
+    free(state.queue);
+    free(clients);
+    free(pfds);
+    free(polled);
+    free(workers);
+    close(listen_fd);
+    unlink(socket_path);
     return -1;
   }
+  fcntl(state.wake[0], F_SETFL, O_NONBLOCK);
+  fcntl(state.wake[1], F_SETFL, O_NONBLOCK);
+  pthread_mutex_init(&state.lock, NULL);
+  pthread_cond_init(&state.cond, NULL);
+  pthread_mutex_init(&state.admin_lock, NULL);
+
+  int started = 0;
+  while (started < threads &&
+         pthread_create(&workers[started], NULL, serve_worker, &state) == 0)
+    started++;
+
+  void (*prev_int)(int) = signal(SIGINT, handle_interrupt);
+  void (*prev_pipe)(int) = signal(SIGPIPE, SIG_IGN);
+  g_interrupted = 0;
+
+  printf("Serving '%s' over RESP on unix:%s (%d workers)\n", cf_name,
+         socket_path, started);
+  printf("Press Ctrl-C to stop.\n");
+  fflush(stdout);
+
+  int client_count = 0;
+  uint64_t accepted = 0;
+  while (!g_interrupted && started > 0) {
+    int nfds = 0;
+    pfds[nfds].fd = listen_fd;
+    pfds[nfds++].events = POLLIN;
+    pfds[nfds].fd = state.wake[0];
+    pfds[nfds++].events = POLLIN;
+
+    /* reap finished clients and poll only those no worker owns */
+    int polled_count = 0;
+    pthread_mutex_lock(&state.lock);
+    for (int i = 0; i < client_count;) {
+      serve_client_t *c = clients[i];
+      if (!c->busy && c->closed) {
+        serve_client_free(c);
+        clients[i] = clients[--client_count];
+        continue;
+      }
+      if (!c->busy) {
+        pfds[nfds].fd = c->fd;
+        pfds[nfds++].events = POLLIN;
+        polled[polled_count++] = c;
+      }
+      i++;
+    }
+    pthread_mutex_unlock(&state.lock);
 
-  int sstable_count = 0;
-  int sstable_valid = 0;
-  int sstable_invalid = 0;
-  int wal_count = 0;
-  int wal_valid = 0;
-  int wal_invalid = 0;
+    const int ready = poll(pfds, (nfds_t)nfds, 250);
+    if (ready <= 0)
+      continue;
 
-  struct dirent *entry;
-  while ((entry = readdir(dir)) != NULL) {
-    char full_path[4096];
-    snprintf(full_path, sizeof(full_path), "%s/%s", cf_path, entry->d_name);
+    if (pfds[1].revents & POLLIN) {
+      char drain[256];
+      while (read(state.wake[0], drain, sizeof(drain)) > 0) {
+      }
+    }
 
-    if (strstr(entry->d_name, ".klog") != NULL) {
-      sstable_count++;
-      block_manager_t *bm = NULL;
-      if (block_manager_open(&bm, full_path, BLOCK_MANAGER_SYNC_NONE) == 0) {
-        const int block_count = block_manager_count_blocks(bm);
-        if (block_count >= 0) {
-          sstable_valid++;
-        } else {
-          sstable_invalid++;
-          printf("  Invalid SSTable: %s\n", entry->d_name);
-        }
-        block_manager_close(bm);
-      } else {
-        sstable_invalid++;
-        printf("  Cannot open SSTable: %s\n", entry->d_name);
+    pthread_mutex_lock(&state.lock);
+    for (int i = 0; i < polled_count; i++) {
+      if (!(pfds[i + 2].revents & (POLLIN | POLLHUP | POLLERR)))
+        continue;
+      polled[i]->busy = 1;
+      const int tail = (state.queue_head + state.queue_count) %
+                       ADMINTOOL_SERVE_MAX_CLIENTS;
+      state.queue[tail] = polled[i];
+      state.queue_count++;
+    }
+    pthread_cond_broadcast(&state.cond);
+    pthread_mutex_unlock(&state.lock);
+
+    if (pfds[0].revents & POLLIN) {
+      const int fd = accept(listen_fd, NULL, NULL);
+      if (fd >= 0) {
+        /* replies are written by pool workers; a client that stops reading
+         * is dropped after the timeout instead of holding a worker */
+        const struct timeval timeout = {
+            .tv_sec = ADMINTOOL_SERVE_SEND_TIMEOUT_MS / 1000,
+            .tv_usec = (ADMINTOOL_SERVE_SEND_TIMEOUT_MS % 1000) * 1000};
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
       }
-    } else if (strstr(entry->d_name, ".log") != NULL) {
-      wal_count++;
-      block_manager_t *bm = NULL;
-      if (block_manager_open(&bm, full_path, BLOCK_MANAGER_SYNC_NONE) == 0) {
-        const int block_count = block_manager_count_blocks(bm);
-        if (block_count >= 0) {
-          wal_valid++;
+      if (fd >= 0 && client_count < ADMINTOOL_SERVE_MAX_CLIENTS) {
+        serve_client_t *c = calloc(1, sizeof(*c));
+        if (c != NULL) {
+          c->fd = fd;
+          pthread_mutex_lock(&state.lock);
+          clients[client_count++] = c;
+          pthread_mutex_unlock(&state.lock);
+          accepted++;
         } else {
-          wal_invalid++;
-          printf("  Invalid WAL: %s\n", entry->d_name);
+          close(fd);
         }
-        block_manager_close(bm);
-      } else {
-        wal_invalid++;
-        printf("  Cannot open WAL: %s\n", entry->d_name);
+      } else if (fd >= 0) {
+        static const char busy[] = "-ERR max number of clients reached\r\n";
+        write_all(fd, busy, sizeof(busy) - 1);
+        close(fd);
       }
     }
   }
-  closedir(dir);
-
-  printf("\nVerification Results:\n");
-  printf("  SSTables: %d total, %d valid, %d invalid\n", sstable_count,
-         sstable_valid, sstable_invalid);
-  printf("  WAL Files: %d total, %d valid, %d invalid\n", wal_count, wal_valid,
-         wal_invalid);
 
-  if (sstable_invalid == 0 && wal_invalid == 0) {
-    printf("  Status: OK\n");
-    return 0;
-  } else {
-    printf("  Status: ISSUES FOUND\n");
-    return -1;
-  }
+  pthread_mutex_lock(&state.lock);
+  state.stop = 1;
+  pthread_cond_broadcast(&state.cond);
+  pthread_mutex_unlock(&state.lock);
+  for (int i = 0; i < started; i++)
+    pthread_join(workers[i], NULL);
+
+  for (int i = 0; i < client_count; i++)
+    serve_client_free(clients[i]);
+  close(listen_fd);
+  unlink(socket_path);
+  close(state.wake[0]);
+  close(state.wake[1]);
+
+  signal(SIGINT, prev_int);
+  signal(SIGPIPE, prev_pipe);
+  g_interrupted = 0;
+
+  printf("\nServer stopped (%" PRIu64 " clients, %" PRIu64 " commands, %" PRIu64
+         " errors).\n",
+         accepted, state.commands, state.errors);
+
+  free(state.queue);
+  free(clients);
+  free(pfds);
+  free(polled);
+  free(workers);
+  pthread_cond_destroy(&state.cond);
+  pthread_mutex_destroy(&state.lock);
+  pthread_mutex_destroy(&state.admin_lock);
+  return started > 0 ? 0 : -1;
+}
+#else
+static int cmd_serve(const int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  printf("serve is not supported on this platform.\n");
+  return -1;
 }
+#endif
 
-static int cmd_compact(const int argc, char **argv) {
+static int cmd_trace(const int argc, char **argv) {
   if (argc < 2) {
-    printf("Usage: compact <cf>\n");
+    printf("Usage: trace <file>|off\n");
+    printf("Tracing is %s.\n", g_trace_file ? "on" : "off");
     return -1;
   }
 
-  if (g_db == NULL) {
-    printf("No database is open.\n");
-    return -1;
+  if (strcmp(argv[1], "off") == 0) {
+    if (!g_trace_file) {
+      printf("Tracing is not active.\n");
+      return -1;
+    }
+    const uint64_t events = g_trace_events;
+    trace_stop();
+    printf("Trace stopped (%" PRIu64 " events).\n", events);
+    return 0;
   }
 
-  tidesdb_column_family_t *cf = tidesdb_get_column_family(g_db, argv[1]);
-  if (cf == NULL) {
-    printf("Column family '%s' not found.\n", argv[1]);
+  trace_stop();
+  if (trace_start(argv[1]) != 0) {
+    printf("Failed to open trace file '%s': %s\n", argv[1], strerror(errno));
     return -1;
   }
-
-  const int ret = tidesdb_compact(cf);
-  if (ret != TDB_SUCCESS) {
-    printf("Failed to trigger compaction: %s\n", error_to_string(ret));
-    return ret;
-  }
-
-  printf("Compaction triggered for '%s'\n", argv[1]);
+  printf("Tracing to '%s'\n", argv[1]);
   return 0;
 }
 
-static int cmd_flush(const int argc, char **argv) {
-  if (argc < 2) {
-    printf("Usage: flush <cf>\n");
-    return -1;
-  }
-
-  if (g_db == NULL) {
-    printf("No database is open.\n");
-    return -1;
-  }
+static int dispatch_command(const int argc, char **argv);
 
-  tidesdb_column_family_t *cf = tidesdb_get_column_family(g_db, argv[1]);
-  if (cf == NULL) {
-    printf("Column family '%s' not found.\n", argv[1]);
+static int execute_command(char *line) {
+  char **argv = NULL;
+  const int argc = parse_args(line, &argv);
+  if (argc < 0) {
+    printf("Out of memory\n");
     return -1;
   }
 
-  const int ret = tidesdb_flush_memtable(cf);
-  if (ret != TDB_SUCCESS) {
-    printf("Failed to flush memtable: %s\n", error_to_string(ret));
-    return ret;
-  }
-
-  printf("Memtable flushed for '%s'\n", argv[1]);
-  return 0;
+  const int ret = argc > 0 ? dispatch_command(argc, argv) : 0;
+  free(argv);
+  return ret;
 }
 
-static int execute_command(const char *line) {
-  char *argv[ADMINTOOL_MAX_ARGS];
-  const int argc = parse_args((char *)line, argv);
-
-  if (argc == 0)
-    return 0;
-
+static int dispatch_command(const int argc, char **argv) {
   const char *cmd = argv[0];
 
   if (strcmp(cmd, "help") == 0 || strcmp(cmd, "?") == 0) {
@@ -2663,7 +10445,24 @@ static int execute_command(const char *line) {
   if (strcmp(cmd, "quit") == 0 || strcmp(cmd, "exit") == 0) {
     return 1;
   }
+  if (strcmp(cmd, "trace") == 0) {
+    return cmd_trace(argc, argv);
+  }
+  static const char *const mutating[] = {"put",       "delete",  "cf-create",
+                                         "cf-drop",   "cf-rename", "compact",
+                                         "flush",     NULL};
+  if (g_db_shadow) {
+    for (int i = 0; mutating[i] != NULL; i++) {
+      if (strcmp(cmd, mutating[i]) == 0) {
+        printf("Database is open as a shadow copy; '%s' is not allowed.\n",
+               cmd);
+        return -1;
+      }
+    }
+  }
+
   int ret = 0;
+  const uint64_t command_start = trace_now();
 
   if (strcmp(cmd, "open") == 0) {
     ret = cmd_open(argc, argv);
@@ -2711,12 +10510,30 @@ static int execute_command(const char *line) {
     ret = cmd_sstable_dump_full(argc, argv);
   } else if (strcmp(cmd, "bloom-stats") == 0) {
     ret = cmd_bloom_stats(argc, argv);
+  } else if (strcmp(cmd, "fingerprint") == 0) {
+    ret = cmd_fingerprint(argc, argv);
+  } else if (strcmp(cmd, "bloom-audit") == 0) {
+    ret = cmd_bloom_audit(argc, argv);
+  } else if (strcmp(cmd, "vlog-stats") == 0) {
+    ret = cmd_vlog_stats(argc, argv);
+  } else if (strcmp(cmd, "vlog-dump") == 0) {
+    ret = cmd_vlog_dump(argc, argv);
+  } else if (strcmp(cmd, "vlog-checksum") == 0) {
+    ret = cmd_vlog_checksum(argc, argv);
   } else if (strcmp(cmd, "wal-list") == 0) {
     ret = cmd_wal_list(argc, argv);
   } else if (strcmp(cmd, "wal-info") == 0) {
     ret = cmd_wal_info(argc, argv);
   } else if (strcmp(cmd, "wal-dump") == 0) {
     ret = cmd_wal_dump(argc, argv);
+  } else if (strcmp(cmd, "wal-tail") == 0) {
+    ret = cmd_wal_tail(argc, argv);
+  } else if (strcmp(cmd, "wal-stats") == 0) {
+    ret = cmd_wal_stats(argc, argv);
+  } else if (strcmp(cmd, "wal-repair") == 0) {
+    ret = cmd_wal_repair(argc, argv);
+  } else if (strcmp(cmd, "bench-recovery") == 0) {
+    ret = cmd_bench_recovery(argc, argv);
   } else if (strcmp(cmd, "wal-verify") == 0) {
     ret = cmd_wal_verify(argc, argv);
   } else if (strcmp(cmd, "wal-checksum") == 0) {
@@ -2725,22 +10542,40 @@ static int execute_command(const char *line) {
     ret = cmd_level_info(argc, argv);
   } else if (strcmp(cmd, "verify") == 0) {
     ret = cmd_verify(argc, argv);
+  } else if (strcmp(cmd, "read-amp-map") == 0) {
+    ret = cmd_read_amp_map(argc, argv);
+  } else if (strcmp(cmd, "gc-debt") == 0) {
+    ret = cmd_gc_debt(argc, argv);
+  } else if (strcmp(cmd, "space-amp") == 0) {
+    ret = cmd_space_amp(argc, argv);
+  } else if (strcmp(cmd, "vlog-gc-report") == 0) {
+    ret = cmd_vlog_gc_report(argc, argv);
+  } else if (strcmp(cmd, "ttl-forecast") == 0) {
+    ret = cmd_ttl_forecast(argc, argv);
+  } else if (strcmp(cmd, "seq-timeline") == 0) {
+    ret = cmd_seq_timeline(argc, argv);
   } else if (strcmp(cmd, "compact") == 0) {
     ret = cmd_compact(argc, argv);
   } else if (strcmp(cmd, "flush") == 0) {
     ret = cmd_flush(argc, argv);
   } else if (strcmp(cmd, "backup") == 0) {
     ret = cmd_backup(argc, argv);
+  } else if (strcmp(cmd, "serve-metrics") == 0) {
+    ret = cmd_serve_metrics(argc, argv);
+  } else if (strcmp(cmd, "serve") == 0) {
+    ret = cmd_serve(argc, argv);
   } else {
     printf("Unknown command: %s. Type 'help' for available commands.\n", cmd);
     ret = -1;
   }
 
+  trace_span("command", cmd, command_start, "argc=%d ret=%d", argc, ret);
+  trace_flush();
   return ret;
 }
 
 static void interactive_mode(void) {
-  char input[ADMINTOOL_MAX_INPUT];
+  strbuf_t input = {0};
   printf("Type 'help' for available commands, 'quit' to exit.\n\n");
 
   while (1) {
@@ -2751,12 +10586,12 @@ static void interactive_mode(void) {
     }
     fflush(stdout);
 
-    if (fgets(input, sizeof(input), stdin) == NULL) {
+    if (strbuf_read_line(&input, stdin) <= 0) {
       printf("\n");
       break;
     }
 
-    const char *line = trim_whitespace(input);
+    char *line = trim_whitespace(input.data);
     if (*line == '\0')
       continue;
 
@@ -2764,18 +10599,90 @@ static void interactive_mode(void) {
       break;
     }
   }
+  strbuf_free(&input);
 
-  if (g_db != NULL) {
-    tidesdb_close(g_db);
-    g_db = NULL;
+  close_database();
+}
+
+/* runs one command per line from `in` against the current database; each
+ * failure is reported on stderr with its line number and exit code, and the
+ * return value is the number of failed commands */
+static int run_script(FILE *in, const char *name, const int stop_on_error) {
+  strbuf_t input = {0};
+  strbuf_t echo = {0};
+  uint64_t line_no = 0;
+  uint64_t executed = 0;
+  int failed = 0;
+  int rc;
+  while ((rc = strbuf_read_line(&input, in)) == 1) {
+    line_no++;
+    char *line = trim_whitespace(input.data);
+    if (*line == '\0' || *line == '#')
+      continue;
+
+    /* parse_args splits the line in place, so keep a copy for the report */
+    echo.len = 0;
+    strbuf_append(&echo, line, strlen(line));
+    const int ret = execute_command(line);
+    executed++;
+    if (ret == 1)
+      break;
+    if (ret != 0) {
+      failed++;
+      fflush(stdout);
+      fprintf(stderr, "%s:%" PRIu64 ": exit %d: %.200s\n", name, line_no,
+              ret, echo.data ? echo.data : "");
+      if (stop_on_error)
+        break;
+    }
+  }
+  if (rc < 0) {
+    fprintf(stderr, "%s:%" PRIu64 ": out of memory reading line\n", name,
+            line_no + 1);
+    failed++;
   }
+  strbuf_free(&input);
+  strbuf_free(&echo);
+
+  fflush(stdout);
+  if (failed > 0)
+    fprintf(stderr, "%s: %" PRIu64 " commands, %d failed\n", name, executed,
+            failed);
+  return failed;
 }
 
 int main(const int argc, char **argv) {
   char *db_path = NULL;
   char *command = NULL;
+  char *metrics_port = NULL;
+  char *trace_path = NULL;
+  char *script_path = NULL;
+  int batch = 0;
+  int stop_on_error = 0;
+  /* open tuning flags given next to -d are passed on to 'open' */
+  static const char *const open_flags[] = {
+      "--cache-bytes", "--flush-threads", "--compaction-threads",
+      "--max-open-sstables", "--log-level", "--config", "--shadow-dir", NULL};
+  char *open_argv[2 + 2 * 7 + 2];
+  int open_argc = 2;
 
   for (int i = 1; i < argc; i++) {
+    int is_open_flag = 0;
+    for (int f = 0; open_flags[f] != NULL; f++)
+      if (strcmp(argv[i], open_flags[f]) == 0)
+        is_open_flag = 1;
+    if (is_open_flag && i + 1 < argc &&
+        open_argc + 2 <= (int)(sizeof(open_argv) / sizeof(open_argv[0]))) {
+      open_argv[open_argc++] = argv[i];
+      open_argv[open_argc++] = argv[++i];
+      continue;
+    }
+    if ((strcmp(argv[i], "--shadow") == 0 ||
+         strcmp(argv[i], "--no-wal-replay") == 0) &&
+        open_argc < (int)(sizeof(open_argv) / sizeof(open_argv[0]))) {
+      open_argv[open_argc++] = argv[i];
+      continue;
+    }
     if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
       print_usage();
       return 0;
@@ -2791,28 +10698,83 @@ int main(const int argc, char **argv) {
                 strcmp(argv[i], "--command") == 0) &&
                i + 1 < argc) {
       command = argv[++i];
+    } else if (strcmp(argv[i], "--metrics-port") == 0 && i + 1 < argc) {
+      metrics_port = argv[++i];
+    } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      trace_path = argv[++i];
+    } else if ((strcmp(argv[i], "-f") == 0 ||
+                strcmp(argv[i], "--file") == 0) &&
+               i + 1 < argc) {
+      script_path = argv[++i];
+    } else if (strcmp(argv[i], "--batch") == 0) {
+      batch = 1;
+    } else if (strcmp(argv[i], "--stop-on-error") == 0) {
+      stop_on_error = 1;
     }
   }
 
+  if (trace_path != NULL && trace_start(trace_path) != 0) {
+    fprintf(stderr, "Failed to open trace file '%s': %s\n", trace_path,
+            strerror(errno));
+    return 1;
+  }
+  atexit(trace_stop);
+
+  /* scripts may print a lot; buffer stdout in large blocks instead of per
+   * line (must happen before anything is written) */
+  static char script_out[1 << 20];
+  if (script_path != NULL || batch)
+    setvbuf(stdout, script_out, _IOFBF, sizeof(script_out));
+
   if (db_path != NULL) {
-    char open_cmd[1024];
-    snprintf(open_cmd, sizeof(open_cmd), "open %s", db_path);
-    if (execute_command(open_cmd) < 0) {
+    open_argv[0] = "open";
+    open_argv[1] = db_path;
+    if (dispatch_command(open_argc, open_argv) < 0) {
       return 1;
     }
+  } else if (open_argc > 2) {
+    fprintf(stderr, "%s requires -d <path>\n", open_argv[2]);
+    return 1;
+  }
+
+  if (metrics_port != NULL && command == NULL) {
+    char *serve_argv[] = {"serve-metrics", "--metrics-port", metrics_port};
+    const int ret = cmd_serve_metrics(3, serve_argv);
+    close_database();
+
+    return (ret < 0) ? 1 : 0;
   }
 
   if (command != NULL) {
-    char cmd_copy[ADMINTOOL_MAX_INPUT];
-    strncpy(cmd_copy, command, sizeof(cmd_copy) - 1);
-    cmd_copy[sizeof(cmd_copy) - 1] = '\0';
+    char *cmd_copy = strdup(command);
+    if (cmd_copy == NULL)
+      return 1;
     const int ret = execute_command(cmd_copy);
+    free(cmd_copy);
+    close_database();
 
-    if (g_db != NULL) {
-      tidesdb_close(g_db);
+    return (ret < 0) ? 1 : 0;
+  }
+
+  if (script_path != NULL || batch) {
+    FILE *in = stdin;
+    const char *name = "stdin";
+    if (script_path != NULL && strcmp(script_path, "-") != 0) {
+      in = fopen(script_path, "r");
+      if (in == NULL) {
+        fprintf(stderr, "Failed to open script '%s': %s\n", script_path,
+                strerror(errno));
+        close_database();
+        return 1;
+      }
+      name = script_path;
     }
+    const int failed = run_script(in, name, stop_on_error);
+    if (in != stdin)
+      fclose(in);
+    close_database();
 
-    return (ret < 0) ? 1 : 0;
+    return failed > 0 ? 1 : 0;
   }
 
   interactive_mode();